@@ -197,6 +197,23 @@ export const onNewScan = functions.database
     await sendNotification(message);
   });
 
+// Índice {bikeId: version} lido pelas centrais para baixar só as configs que mudaram
+export const onBikeConfigWrite = functions.database
+  .ref("/bike_configs/{bikeId}")
+  .onWrite(async (change, context) => {
+    const bikeId = context.params.bikeId;
+    const versionRef = db.ref(`bike_config_versions/${bikeId}`);
+
+    if (!change.after.exists()) {
+      await versionRef.remove();
+      return;
+    }
+
+    const version = change.after.child("version").val() || 1;
+    console.log(`⚙️ Config ${bikeId} -> v${version}`);
+    await versionRef.set(version);
+  });
+
 bot.start((ctx) => {
   console.log("📱 Comando /start recebido de:", ctx.from?.username || ctx.from?.id);
   const welcomeMessage = "🚴 *Bot de Monitoramento de Bicicletas*\n\n" +
@@ -1,4 +1,5 @@
 const firebaseService = require('../config/firebase');
+const { formatEpoch } = require('../../../shared/utils/timeFormat');
 
 class StationMonitor {
   constructor(bot) {
@@ -38,8 +39,9 @@ class StationMonitor {
       const snapshot = await heartbeatRef.once('value');
       const heartbeat = snapshot.val();
       
+      // A central envia epoch em segundos
       const now = Date.now();
-      const isOnline = heartbeat && (now - heartbeat.timestamp < this.HEARTBEAT_TIMEOUT);
+      const isOnline = heartbeat && (now - heartbeat.timestamp * 1000 < this.HEARTBEAT_TIMEOUT);
       const wasOnline = this.stationStatus.get(baseId);
       
       // Mudança de status
@@ -47,7 +49,7 @@ class StationMonitor {
         this.stationStatus.set(baseId, isOnline);
         
         if (!isOnline) {
-          await this.notifyStationOffline(baseId, baseData);
+          await this.notifyStationOffline(baseId, baseData, heartbeat);
         } else {
           await this.notifyStationOnline(baseId, baseData);
         }
@@ -59,10 +61,12 @@ class StationMonitor {
   }
 
   // Notificar estação offline
-  async notifyStationOffline(baseId, baseData) {
+  async notifyStationOffline(baseId, baseData, heartbeat) {
+    const lastSeen = heartbeat && formatEpoch(heartbeat.timestamp);
     const message = `🚨 *ESTAÇÃO OFFLINE*\n\n` +
       `🏢 ${baseData.name || baseId}\n` +
       `⏰ Sem heartbeat há mais de 30 minutos\n` +
+      (lastSeen ? `🕒 Último heartbeat: ${lastSeen}\n` : '') +
       `📍 ${baseData.location ? `${baseData.location.lat}, ${baseData.location.lng}` : 'Localização não definida'}\n\n` +
       `⚠️ Verificar conexão da central`;
 
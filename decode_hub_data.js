@@ -1,17 +1,33 @@
 // Script para decodificar os dados hexadecimais do hub
+const { decompress } = require('./shared/utils/payloadCompressor');
+const { withHumanTimes } = require('./shared/utils/timeFormat');
+const { wireToObject } = require('./shared/utils/wireFormat');
+
+// Aceita o hex puro ou o item do upload ({ data, compressed, wire }).
+// Uploads novos trazem "encoding": "base64" no documento; os antigos são hex.
+// "wire": true = mensagem binária que a central não conseguiu converter em JSON.
+const encoding = 'hex';
 const data = [
   "7B2274797065223A2262696B655F726567697374726174696F6E222C2262696B655F6964223A2262696B655F303031222C2274696D657374616D70223A3134352C2276657273696F6E223A22322E30227D",
   "7B22756964223A2262696B655F303031222C22737461747573223A22616374697665222C226C6173745F626C655F636F6E74616374223A3134352C226C6173745F776966695F7363616E223A3134357D",
   "7B2274797065223A22737461747573222C2262696B655F6964223A2262696B655F303031222C22626174746572795F766F6C74616765223A302E3638363939363334312C227265636F7264735F636F756E74223A302C2274696D657374616D70223A3134352C2268656170223A3137343234387D"
 ];
 
+function decodeItem(item, encoding = 'hex') {
+  const { data: text, compressed, wire, ts } = typeof item === 'string' ? { data: item, compressed: false } : item;
+  const raw = Buffer.from(text, encoding === 'base64' ? 'base64' : 'hex');
+  if (wire) return JSON.stringify(wireToObject(raw, ts));
+  return (compressed ? decompress(raw) : raw).toString('utf8');
+}
+
 console.log("🔍 Decodificando dados do hub:\n");
 
-data.forEach((hex, index) => {
-  const decoded = Buffer.from(hex, 'hex').toString('utf8');
-  const json = JSON.parse(decoded);
+data.forEach((item, index) => {
+  const decoded = decodeItem(item, encoding);
+  // A central grava só epoch; a forma legível é montada aqui
+  const json = withHumanTimes(JSON.parse(decoded));
   
   console.log(`📦 Pacote ${index + 1}:`);
   console.log(JSON.stringify(json, null, 2));
   console.log();
-});
\ No newline at end of file
+});
@@ -3,6 +3,9 @@
 #include <NimBLEDevice.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include "ble_transfer.h"
+#include "crc32.h"
+#include "wire_format.h"
 
 // Hardware pins
 #define LED_PIN 8
@@ -17,6 +20,19 @@ State currentState = BOOT;
 NimBLEClient* pClient = nullptr;
 bool bleConnected = false;
 
+// Transferência em blocos (firmware/central/include/ble_transfer.h)
+#define BLE_DLE_TX_OCTETS 251
+#define BLE_DLE_TX_TIME 2120
+#define TRANSFER_ACK_TIMEOUT_MS 2000
+#define TRANSFER_MAX_ATTEMPTS 5
+volatile bool transferAckReceived = false;
+uint8_t transferAck[BleTransfer::ACK_SIZE];
+
+// Notificação da característica de config (a central envia só para esta conexão)
+#define CONFIG_RESPONSE_TIMEOUT_MS 2000
+volatile bool configNotified = false;
+std::string configNotification;
+
 // WiFi buffer
 struct WiFiRecord {
     uint32_t timestamp;
@@ -72,8 +88,9 @@ void handleAtBase();
 void handleSleep();
 bool scanForBase();
 bool connectToBase(NimBLEAdvertisedDevice* device);
-void sendStatus();
-void sendWiFiData();
+bool sendStatus();
+bool sendWiFiData();
+bool sendFramed(const uint8_t* payload, size_t total);
 float getBatteryVoltage();
 void saveBuffer();
 void loadBuffer();
@@ -103,6 +120,7 @@ void setup() {
     
     // Inicializar BLE com o bike_id gerado
     NimBLEDevice::init(config.bike_id);
+    NimBLEDevice::setMTU(BleTransfer::MTU_MAX);
     
     // Load config first
     if (!loadConfig()) {
@@ -223,9 +241,9 @@ void handleAtBase() {
     // Send status
     sendStatus();
     
-    // Send WiFi data if available
-    if (bufferCount > 0) {
-        sendWiFiData();
+    // Send WiFi data if available; buffer só é limpo depois do ACK final
+    // (se cair no meio, a próxima conexão retoma do último bloco confirmado)
+    if (bufferCount > 0 && sendWiFiData()) {
         bufferCount = 0; // Clear buffer
     }
     
@@ -279,7 +297,9 @@ bool connectToBase(NimBLEAdvertisedDevice* device) {
     Serial.printf("🔗 Attempting BLE connection (timeout: %dms)...\n", config.ble_connection_timeout_ms);
     if (pClient->connect(device)) {
         bleConnected = true;
-        Serial.println("✅ BLE connection established");
+        // MTU é negociado na conexão (setMTU no setup); DLE libera PDUs de 251 bytes
+        ble_gap_set_data_len(pClient->getConnId(), BLE_DLE_TX_OCTETS, BLE_DLE_TX_TIME);
+        Serial.printf("✅ BLE connection established (MTU %d)\n", pClient->getMTU());
         
         // Always request config on first connection
         if (currentState == CONFIG_REQUEST) {
@@ -298,44 +318,170 @@ bool connectToBase(NimBLEAdvertisedDevice* device) {
     return false;
 }
 
-void sendStatus() {
-    if (!pClient || !bleConnected) return;
+// Mensagens no formato binário da central (firmware/central/include/wire_format.h)
+bool sendStatus() {
+    if (!pClient || !bleConnected) return false;
     
-    DynamicJsonDocument doc(256);
-    doc["bike_id"] = config.bike_id;
-    doc["battery"] = getBatteryVoltage();
-    doc["records"] = bufferCount;
-    doc["timestamp"] = millis() / 1000;
+    float voltage = getBatteryVoltage();
+    float range = config.battery_full_voltage - config.battery_critical_voltage;
+    float percent = range > 0 ? (voltage - config.battery_critical_voltage) * 100 / range : 0;
+    percent = constrain(percent, 0, 100);
+    
+    uint8_t message[64];
+    WireFormat::Writer writer(message, sizeof(message), WireFormat::MSG_STATUS);
+    writer.putString(WireFormat::TAG_BIKE_ID, config.bike_id);
+    writer.putU16(WireFormat::TAG_BATTERY_MV, (uint16_t)(voltage * 1000 + 0.5f));
+    writer.putU8(WireFormat::TAG_BATTERY_PCT, (uint8_t)percent);
+    writer.putU16(WireFormat::TAG_RECORDS, bufferCount);
+    writer.putU32(WireFormat::TAG_HEAP, ESP.getFreeHeap());
+    writer.putU32(WireFormat::TAG_TIMESTAMP, millis() / 1000);
+    
+    Serial.printf("📤 Status: %.2fV (%d%%), %d records (%d bytes)\n",
+                  voltage, (int)percent, bufferCount, (int)writer.length());
+    return writer.length() > 0 && sendFramed(message, writer.length());
+}
+
+bool sendWiFiData() {
+    if (!pClient || !bleConnected || bufferCount == 0) return false;
+    
+    // Sem campos voláteis: o mesmo buffer gera o mesmo payload (e o mesmo
+    // transfer_id), o que permite retomar após reconexão
+    static uint8_t message[WireFormat::HEADER_SIZE + WireFormat::FIELD_HEADER_SIZE + sizeof(config.bike_id) +
+                           (WireFormat::FIELD_HEADER_SIZE + WireFormat::SCAN_SIZE) * 50];
+    WireFormat::Writer writer(message, sizeof(message), WireFormat::MSG_WIFI_SCANS);
+    writer.putString(WireFormat::TAG_BIKE_ID, config.bike_id);
     
-    String json;
-    serializeJson(doc, json);
+    for (int i = 0; i < bufferCount; i++) {
+        WireFormat::Scan scan;
+        scan.timestamp = wifiBuffer[i].timestamp;
+        memcpy(scan.bssid, wifiBuffer[i].bssid, sizeof(scan.bssid));
+        scan.rssi = wifiBuffer[i].rssi;
+        writer.putScan(scan);
+    }
     
-    // Find and write to characteristic (simplified)
-    Serial.printf("📤 Status: %s\n", json.c_str());
+    Serial.printf("📡 WiFi data: %d records (%d bytes)\n", bufferCount, (int)writer.length());
+    return writer.length() > 0 && sendFramed(message, writer.length());
+}
+
+// ACKs da central chegam por notificação (task do NimBLE); o loop só lê o último
+static void onTransferAck(NimBLERemoteCharacteristic* pChar, uint8_t* data, size_t length, bool isNotify) {
+    if (length != BleTransfer::ACK_SIZE) return;
+    memcpy(transferAck, data, length);
+    transferAckReceived = true;
 }
 
-void sendWiFiData() {
-    if (!pClient || !bleConnected || bufferCount == 0) return;
+static bool waitTransferAck(uint16_t transferId, BleTransfer::Frame& ack) {
+    unsigned long start = millis();
+    while (millis() - start < TRANSFER_ACK_TIMEOUT_MS) {
+        if (transferAckReceived) {
+            transferAckReceived = false;
+            if (BleTransfer::decode(transferAck, sizeof(transferAck), ack) &&
+                ack.type == BleTransfer::FRAME_ACK && ack.transferId == transferId) {
+                return true;
+            }
+        }
+        if (!pClient->isConnected()) return false;
+        delay(5);
+    }
+    return false;
+}
+
+// Envia uma mensagem na característica de dados. Cabe num bloco: vai
+// inteira num write. Senão: START + blocos de (MTU - 11) bytes,
+// janela de WINDOW_CHUNKS writes sem resposta por ACK, reenvio a partir do
+// offset confirmado e retomada via novo START após timeout/reconexão.
+bool sendFramed(const uint8_t* payload, size_t total) {
+    NimBLERemoteService* pService = pClient->getService("12345678-1234-1234-1234-123456789abc");
+    NimBLERemoteCharacteristic* pDataChar = pService ? pService->getCharacteristic("87654321-4321-4321-4321-cba987654321") : nullptr;
+    if (!pDataChar) {
+        Serial.println("❌ Data characteristic not found");
+        return false;
+    }
     
-    DynamicJsonDocument doc(2048);
-    JsonArray scans = doc.createNestedArray("scans");
+    uint16_t mtu = pClient->getMTU();
     
-    for (int i = 0; i < bufferCount; i++) {
-        JsonObject scan = scans.createNestedObject();
-        scan["ts"] = wifiBuffer[i].timestamp;
-        
-        char bssid[18];
-        sprintf(bssid, "%02X:%02X:%02X:%02X:%02X:%02X",
-                wifiBuffer[i].bssid[0], wifiBuffer[i].bssid[1], wifiBuffer[i].bssid[2],
-                wifiBuffer[i].bssid[3], wifiBuffer[i].bssid[4], wifiBuffer[i].bssid[5]);
-        scan["bssid"] = bssid;
-        scan["rssi"] = wifiBuffer[i].rssi;
+    size_t chunk = BleTransfer::chunkSize(mtu);
+    
+    if (total <= chunk) {
+        return pDataChar->writeValue(payload, total, true);
+    }
+    
+    if (!pDataChar->canNotify() || !pDataChar->subscribe(true, onTransferAck)) {
+        Serial.println("❌ Central without transfer ACKs - payload too large for MTU");
+        return false;
     }
     
-    String json;
-    serializeJson(doc, json);
+    uint32_t crc = Crc32::compute(payload, total);
+    uint16_t transferId = BleTransfer::transferIdOf(crc, total);
+    uint8_t frame[BleTransfer::MTU_MAX - BleTransfer::ATT_OVERHEAD];
+    BleTransfer::Frame ack;
+    unsigned long startedAt = millis();
+    
+    // Tentativas seguidas sem avanço; cada ACK com offset novo zera a contagem
+    uint32_t confirmed = 0;
+    int failures = 0;
+    
+    while (failures < TRANSFER_MAX_ATTEMPTS && pClient->isConnected()) {
+        size_t length = BleTransfer::encodeStart(frame, sizeof(frame), transferId, total, crc,
+                                                 config.bike_id, strlen(config.bike_id));
+        transferAckReceived = false;
+        if (!pDataChar->writeValue(frame, length, true) || !waitTransferAck(transferId, ack)) {
+            failures++;
+            continue;
+        }
+        if (ack.status == BleTransfer::ACK_REJECT) {
+            Serial.printf("❌ Transfer rejected by central (%lu bytes)\n", (unsigned long)total);
+            return false;
+        }
+        
+        uint32_t offset = ack.offset;
+        if (offset > confirmed) {
+            confirmed = offset;
+            failures = 0;
+        }
+        if (offset > 0) {
+            Serial.printf("↪️ Resuming transfer at %lu/%lu\n", (unsigned long)offset, (unsigned long)total);
+        }
+        
+        for (;;) {
+            transferAckReceived = false;
+            for (uint8_t n = 0; n < BleTransfer::WINDOW_CHUNKS && offset < total; n++) {
+                size_t part = min((size_t)(total - offset), chunk);
+                length = BleTransfer::encodeData(frame, sizeof(frame), transferId, offset, payload + offset, part);
+                if (!pDataChar->writeValue(frame, length, false)) break;
+                offset += part;
+            }
+            
+            // Sem ACK: o próximo START pergunta à central onde ela parou
+            if (!waitTransferAck(transferId, ack)) {
+                failures++;
+                break;
+            }
+            
+            if (ack.status == BleTransfer::ACK_DONE) {
+                unsigned long elapsed = millis() - startedAt;
+                Serial.printf("📶 Sent %lu bytes in %lu ms (MTU %d, %d B/chunk)\n",
+                              (unsigned long)total, elapsed, mtu, (int)chunk);
+                return true;
+            }
+            if (ack.status == BleTransfer::ACK_REJECT) {
+                failures++;
+                break;
+            }
+            if (ack.status == BleTransfer::ACK_RESTART) {
+                Serial.println("⚠️ Transfer CRC mismatch - restarting");
+                failures++;
+            }
+            if (ack.offset > confirmed) {
+                confirmed = ack.offset;
+                failures = 0;
+            }
+            offset = ack.offset;
+        }
+    }
     
-    Serial.printf("📡 WiFi data: %d records\n", bufferCount);
+    Serial.printf("❌ Transfer failed (%lu bytes)\n", (unsigned long)total);
+    return false;
 }
 
 float getBatteryVoltage() {
@@ -512,6 +658,97 @@ void saveConfig() {
     }
 }
 
+// Campos do MSG_CONFIG_PUSH (mesmas chaves do config JSON, ver wire_format.cpp)
+static bool applyWireConfig(const uint8_t* data, size_t length) {
+    WireFormat::Reader reader(data, length);
+    if (!reader.valid() || reader.type() != WireFormat::MSG_CONFIG_PUSH) return false;
+    
+    while (reader.next()) {
+        uint32_t value = reader.asUint();
+        switch (reader.tag()) {
+        case WireFormat::TAG_ERROR:
+            Serial.printf("❌ Config error: %.*s\n", reader.size(), (const char*)reader.value());
+            return false;
+        case WireFormat::TAG_BIKE_NAME: {
+            size_t n = min((size_t)reader.size(), sizeof(config.bike_name) - 1);
+            memcpy(config.bike_name, reader.value(), n);
+            config.bike_name[n] = '\0';
+            break;
+        }
+        case WireFormat::TAG_BASE_NAME: {
+            size_t n = min((size_t)reader.size(), sizeof(config.base_ble_name) - 1);
+            memcpy(config.base_ble_name, reader.value(), n);
+            config.base_ble_name[n] = '\0';
+            break;
+        }
+        case WireFormat::TAG_VERSION: config.version = value; break;
+        case WireFormat::TAG_DEV_MODE: config.dev_mode = value != 0; break;
+        case WireFormat::TAG_SCAN_INTERVAL_SEC: if (value) config.scan_interval_sec = value; break;
+        case WireFormat::TAG_SCAN_TIMEOUT_MS: if (value) config.wifi_scan_timeout_ms = value; break;
+        case WireFormat::TAG_BLE_SCAN_SEC: if (value) config.ble_scan_time_sec = value; break;
+        case WireFormat::TAG_DEEP_SLEEP_SEC: if (value) config.deep_sleep_sec = value; break;
+        case WireFormat::TAG_CRITICAL_MV: if (value) config.battery_critical_voltage = value / 1000.0f; break;
+        case WireFormat::TAG_LOW_MV: if (value) config.min_battery_voltage = value / 1000.0f; break;
+        }
+    }
+    return !reader.error();
+}
+
+// Central antiga: config em JSON
+static bool applyJsonConfig(const std::string& response) {
+    DynamicJsonDocument doc(1024);
+    if (deserializeJson(doc, response) != DeserializationError::Ok) return false;
+    
+    // Central embrulha em {"target_bike", "config": {"type", "bike_id", "config": {...}}}
+    JsonObject cfg = doc.as<JsonObject>();
+    while (cfg.containsKey("config")) {
+        if (cfg["error"]) break;
+        cfg = cfg["config"].as<JsonObject>();
+    }
+    if (cfg["error"]) {
+        Serial.printf("❌ Config error: %s\n", cfg["error"].as<String>().c_str());
+        return false;
+    }
+    
+    // Update config from response
+    if (cfg["bike_name"]) strlcpy(config.bike_name, cfg["bike_name"], sizeof(config.bike_name));
+    if (cfg["version"]) config.version = cfg["version"];
+    if (cfg["dev_mode"]) config.dev_mode = cfg["dev_mode"];
+    
+    if (cfg["wifi"]["scan_interval_sec"]) {
+        config.scan_interval_sec = cfg["wifi"]["scan_interval_sec"];
+    }
+    if (cfg["wifi"]["scan_timeout_ms"]) {
+        config.wifi_scan_timeout_ms = cfg["wifi"]["scan_timeout_ms"];
+    }
+    
+    if (cfg["ble"]["base_name"]) {
+        strlcpy(config.base_ble_name, cfg["ble"]["base_name"], sizeof(config.base_ble_name));
+    }
+    if (cfg["ble"]["scan_time_sec"]) {
+        config.ble_scan_time_sec = cfg["ble"]["scan_time_sec"];
+    }
+    
+    if (cfg["power"]["deep_sleep_duration_sec"]) {
+        config.deep_sleep_sec = cfg["power"]["deep_sleep_duration_sec"];
+    }
+    
+    if (cfg["battery"]["critical_voltage"]) {
+        config.battery_critical_voltage = cfg["battery"]["critical_voltage"];
+    }
+    if (cfg["battery"]["low_voltage"]) {
+        config.min_battery_voltage = cfg["battery"]["low_voltage"];
+    }
+    return true;
+}
+
+// Task do NimBLE: só copia; o loop consome quando configNotified = true
+static void onConfigNotify(NimBLERemoteCharacteristic* pChar, uint8_t* data, size_t length, bool isNotify) {
+    if (configNotified) return;
+    configNotification.assign((const char*)data, length);
+    configNotified = true;
+}
+
 bool requestConfigFromBase() {
     if (!pClient || !bleConnected) {
         Serial.println("❌ No BLE connection to request config");
@@ -534,74 +771,57 @@ bool requestConfigFromBase() {
     }
     
     // Send config request
-    DynamicJsonDocument request(256);
-    request["type"] = "config_request";
-    request["bike_id"] = config.bike_id;
+    uint8_t request[WireFormat::HEADER_SIZE + WireFormat::FIELD_HEADER_SIZE + sizeof(config.bike_id)];
+    WireFormat::Writer writer(request, sizeof(request), WireFormat::MSG_CONFIG_REQUEST);
+    writer.putString(WireFormat::TAG_BIKE_ID, config.bike_id);
     
-    String requestStr;
-    serializeJson(request, requestStr);
+    // Resposta chega por notificação direcionada; central antiga: ler o valor
+    bool subscribed = pConfigChar->canNotify() && pConfigChar->subscribe(true, onConfigNotify);
+    configNotified = false;
     
-    Serial.printf("📤 Config request: %s\n", requestStr.c_str());
-    pConfigChar->writeValue(requestStr.c_str());
+    Serial.printf("📤 Config request (%d bytes)\n", (int)writer.length());
+    pConfigChar->writeValue(request, writer.length());
     
     // Wait for response
-    delay(2000);
-    std::string response = pConfigChar->readValue();
+    std::string response;
+    unsigned long waitStart = millis();
+    while (subscribed && !configNotified && millis() - waitStart < CONFIG_RESPONSE_TIMEOUT_MS) {
+        delay(10);
+    }
+    if (configNotified) {
+        response = configNotification;
+        configNotified = false;
+    } else {
+        if (subscribed) delay(100);
+        else delay(CONFIG_RESPONSE_TIMEOUT_MS);
+        response = pConfigChar->readValue();
+    }
     
     if (response.length() > 0) {
-        Serial.printf("📥 Config response: %s\n", response.c_str());
+        const uint8_t* data = (const uint8_t*)response.data();
+        bool applied;
+        if (WireFormat::isMessage(data, response.length())) {
+            Serial.printf("📥 Config response (%d bytes)\n", (int)response.length());
+            applied = applyWireConfig(data, response.length());
+        } else {
+            Serial.printf("📥 Config response: %s\n", response.c_str());
+            applied = applyJsonConfig(response);
+        }
         
-        DynamicJsonDocument doc(1024);
-        if (deserializeJson(doc, response) == DeserializationError::Ok) {
-            if (doc["error"]) {
-                Serial.printf("❌ Config error: %s\n", doc["error"].as<String>().c_str());
-                return false;
-            }
-            
-            // Update config from response
-            if (doc["bike_name"]) strcpy(config.bike_name, doc["bike_name"]);
-            if (doc["version"]) config.version = doc["version"];
-            if (doc["dev_mode"]) config.dev_mode = doc["dev_mode"];
-            
-            if (doc["wifi"]["scan_interval_sec"]) {
-                config.scan_interval_sec = doc["wifi"]["scan_interval_sec"];
-            }
-            if (doc["wifi"]["scan_timeout_ms"]) {
-                config.wifi_scan_timeout_ms = doc["wifi"]["scan_timeout_ms"];
-            }
-            
-            if (doc["ble"]["base_name"]) {
-                strcpy(config.base_ble_name, doc["ble"]["base_name"]);
-            }
-            if (doc["ble"]["scan_time_sec"]) {
-                config.ble_scan_time_sec = doc["ble"]["scan_time_sec"];
-            }
-            
-            if (doc["power"]["deep_sleep_duration_sec"]) {
-                config.deep_sleep_sec = doc["power"]["deep_sleep_duration_sec"];
-            }
-            
-            if (doc["battery"]["critical_voltage"]) {
-                config.battery_critical_voltage = doc["battery"]["critical_voltage"];
-            }
-            if (doc["battery"]["low_voltage"]) {
-                config.min_battery_voltage = doc["battery"]["low_voltage"];
-            }
-            
+        if (applied) {
             // Send confirmation
-            DynamicJsonDocument confirm(128);
-            confirm["type"] = "config_received";
-            confirm["bike_id"] = config.bike_id;
-            confirm["status"] = "ok";
-            
-            String confirmStr;
-            serializeJson(confirm, confirmStr);
-            pConfigChar->writeValue(confirmStr.c_str());
+            uint8_t confirm[WireFormat::HEADER_SIZE + WireFormat::FIELD_HEADER_SIZE * 3 + sizeof(config.bike_id) + 3];
+            WireFormat::Writer confirmWriter(confirm, sizeof(confirm), WireFormat::MSG_CONFIG_RECEIVED);
+            confirmWriter.putString(WireFormat::TAG_BIKE_ID, config.bike_id);
+            confirmWriter.putU8(WireFormat::TAG_STATUS, WireFormat::STATUS_OK);
+            confirmWriter.putU16(WireFormat::TAG_VERSION, config.version);
+            pConfigChar->writeValue(confirm, confirmWriter.length());
             
             Serial.printf("✅ Config updated: %s v%d\n", config.bike_name, config.version);
             saveConfig();
             return true;
         }
+        return false;
     }
     
     Serial.println("❌ No config response received");
@@ -0,0 +1,141 @@
+// Benchmark de host: transferência em blocos (src/ble_transfer.cpp).
+// Simula o envio da bici (START, janelas de WINDOW_CHUNKS, reenvio a partir
+// do ACK) contra o Reassembler da central para vários MTUs, com perda de
+// writes e uma desconexão no meio (retomada via novo START). Confere o
+// payload remontado e mostra writes, bytes no ar e eficiência por MTU.
+//
+//   g++ -O2 -std=c++17 -Iinclude bench/ble_transfer_bench.cpp src/ble_transfer.cpp src/crc32.cpp -o /tmp/ble_transfer_bench
+//   /tmp/ble_transfer_bench [bytes] [perda_%]
+//
+// Rodar a partir de firmware/central.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "ble_transfer.h"
+#include "crc32.h"
+
+struct Link {
+    BleTransfer::Reassembler rx;
+    uint32_t lossPercent;
+    uint32_t writes;
+    uint32_t airBytes;
+    bool connected;
+    uint32_t disconnectAfter;   // writes até cair (0 = nunca)
+    bool hasAck;
+    BleTransfer::Frame ack;
+    uint8_t ackFrame[BleTransfer::ACK_SIZE];
+};
+
+// Um write da bici; perdido com `lossPercent` (a central nunca o vê)
+static void write(Link& link, const uint8_t* frame, size_t length) {
+    if (!link.connected) return;
+    link.writes++;
+    link.airBytes += length + BleTransfer::ATT_OVERHEAD;
+    if (link.disconnectAfter && link.writes >= link.disconnectAfter) {
+        link.connected = false;
+        link.disconnectAfter = 0;
+        return;
+    }
+    if ((uint32_t)(rand() % 100) < link.lossPercent) return;
+
+    BleTransfer::Frame in;
+    if (!BleTransfer::decode(frame, length, in)) return;
+
+    BleTransfer::Reassembler::Result result;
+    if (in.type == BleTransfer::FRAME_START) {
+        bool resumed;
+        result = link.rx.start(in, resumed);
+    } else {
+        result = link.rx.data(in);
+    }
+    if (!result.ack) return;
+
+    BleTransfer::encodeAck(link.ackFrame, sizeof(link.ackFrame), in.transferId, result.offset, result.status);
+    link.airBytes += BleTransfer::ACK_SIZE + BleTransfer::ATT_OVERHEAD;
+    link.hasAck = BleTransfer::decode(link.ackFrame, sizeof(link.ackFrame), link.ack);
+}
+
+static bool takeAck(Link& link, BleTransfer::Frame& ack) {
+    if (!link.hasAck) return false;
+    link.hasAck = false;
+    ack = link.ack;
+    return true;
+}
+
+// Mesmo algoritmo de sendFramed() em firmware/bici/src/main.cpp
+static bool send(Link& link, const std::vector<uint8_t>& payload, uint16_t mtu, uint32_t& timeouts) {
+    uint32_t total = payload.size();
+    uint32_t crc = Crc32::compute(payload.data(), total);
+    uint16_t id = BleTransfer::transferIdOf(crc, total);
+    size_t chunk = BleTransfer::chunkSize(mtu);
+    uint8_t frame[BleTransfer::MTU_MAX - BleTransfer::ATT_OVERHEAD];
+    BleTransfer::Frame ack;
+    const char* bikeId = "bpr-bench";
+
+    uint32_t confirmed = 0;
+    int failures = 0;
+
+    while (failures < 5) {
+        // Reconecta (a central mantém a remontagem parcial)
+        link.connected = true;
+        size_t length = BleTransfer::encodeStart(frame, sizeof(frame), id, total, crc, bikeId, strlen(bikeId));
+        link.hasAck = false;
+        write(link, frame, length);
+        if (!takeAck(link, ack)) { timeouts++; failures++; continue; }
+        if (ack.status == BleTransfer::ACK_REJECT) return false;
+
+        uint32_t offset = ack.offset;
+        if (offset > confirmed) { confirmed = offset; failures = 0; }
+        for (;;) {
+            link.hasAck = false;
+            for (uint8_t n = 0; n < BleTransfer::WINDOW_CHUNKS && offset < total; n++) {
+                size_t part = total - offset < chunk ? total - offset : chunk;
+                length = BleTransfer::encodeData(frame, sizeof(frame), id, offset, payload.data() + offset, part);
+                write(link, frame, length);
+                offset += part;
+            }
+            if (!takeAck(link, ack)) { timeouts++; failures++; break; }
+            if (ack.status == BleTransfer::ACK_DONE) return true;
+            if (ack.status == BleTransfer::ACK_REJECT) { failures++; break; }
+            if (ack.status == BleTransfer::ACK_RESTART) failures++;
+            if (ack.offset > confirmed) { confirmed = ack.offset; failures = 0; }
+            offset = ack.offset;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    uint32_t bytes = argc > 1 ? (uint32_t)atol(argv[1]) : 6000;
+    uint32_t lossPercent = argc > 2 ? (uint32_t)atol(argv[2]) : 2;
+    if (bytes == 0 || bytes > BleTransfer::MAX_TRANSFER) {
+        printf("bytes deve estar entre 1 e %u\n", (unsigned)BleTransfer::MAX_TRANSFER);
+        return 1;
+    }
+
+    srand(42);
+    std::vector<uint8_t> payload(bytes);
+    for (uint32_t i = 0; i < bytes; i++) payload[i] = (uint8_t)(rand() & 0xFF);
+
+    const uint16_t mtus[] = { BleTransfer::MTU_DEFAULT, 185, 247, BleTransfer::MTU_MAX };
+    int errors = 0;
+
+    printf("payload: %u bytes, perda: %u%%, queda após 1/3 dos writes\n", bytes, lossPercent);
+    printf("%5s %6s %7s %9s %9s %9s\n", "MTU", "bloco", "writes", "timeouts", "no ar", "eficiência");
+    for (uint16_t mtu : mtus) {
+        Link link = {};
+        link.lossPercent = lossPercent;
+        link.connected = true;
+        link.disconnectAfter = (bytes / BleTransfer::chunkSize(mtu)) / 3 + 2;
+
+        uint32_t timeouts = 0;
+        bool ok = send(link, payload, mtu, timeouts) && link.rx.complete() &&
+                  memcmp(link.rx.payload(), payload.data(), bytes) == 0;
+        if (!ok) errors++;
+
+        printf("%5u %6u %7u %9u %9u %8.1f%%%s\n", mtu, (unsigned)BleTransfer::chunkSize(mtu),
+               link.writes, timeouts, link.airBytes, 100.0 * bytes / link.airBytes, ok ? "" : "  FALHOU");
+    }
+    return errors ? 1 : 0;
+}
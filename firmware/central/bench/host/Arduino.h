@@ -0,0 +1,54 @@
+// Arduino mínimo para os benches de host: só Print/Stream/Serial, o bastante
+// para headers como upload_stream.h compilarem fora do ESP32.
+#pragma once
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using std::min;
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(char c) { return write((uint8_t)c); }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t println(const char* s) { return print(s) + write((uint8_t)'\n'); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char text[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        if (n < 0) return 0;
+        return write((const uint8_t*)text, (size_t)n < sizeof(text) ? (size_t)n : sizeof(text) - 1);
+    }
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        for (int c; n < length && (c = read()) >= 0; n++) buffer[n] = (char)c;
+        return n;
+    }
+};
+
+class HostSerial : public Print {
+public:
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+static HostSerial Serial;
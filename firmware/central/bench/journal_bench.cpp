@@ -0,0 +1,122 @@
+// Benchmark de host: bytes gravados em flash por registro ingerido,
+// journal binário vs. caminho JSON antigo (/buffer.json reescrito a cada 5 inserções).
+//
+//   g++ -O2 -std=c++17 -Iinclude bench/journal_bench.cpp src/buffer_journal.cpp -o /tmp/journal_bench
+//   /tmp/journal_bench [registros] [itens_por_sync]
+//
+// Rodar a partir de firmware/central. Não depende de Arduino nem de LittleFS:
+// o tamanho de cada escrita é calculado exatamente como o firmware a faria.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "buffer_journal.h"
+
+struct Item {
+    std::string bikeId;
+    uint32_t ts;
+    std::vector<uint8_t> data;
+    uint32_t crc;
+};
+
+static Item makeItem(int i) {
+    char json[256];
+    int n = snprintf(json, sizeof(json),
+        "{\"bike_id\":\"bpr-%06x\",\"battery\":%d,\"heap\":%d,\"records\":%d,\"timestamp\":%d,"
+        "\"central_receive_timestamp\":%u}",
+        0xa1b2c3 + (i % 7), 60 + i % 40, 150000 + i * 13 % 4000, i % 50, 1000 + i,
+        1733459200u + i * 30);
+    Item item;
+    char id[16];
+    snprintf(id, sizeof(id), "bpr-%06x", 0xa1b2c3 + (i % 7));
+    item.bikeId = id;
+    item.ts = 1733459200u + i * 30;
+    item.data.assign((uint8_t*)json, (uint8_t*)json + n);
+    item.crc = 0xDEADBEEF ^ i;
+    return item;
+}
+
+// Mesmo documento que BufferManager::saveBuffer() serializa (sem espaços)
+static size_t jsonFileSize(const std::vector<Item>& buffer, uint32_t lastSync) {
+    std::string out = "{\"data_count\":" + std::to_string(buffer.size()) +
+                      ",\"last_sync\":" + std::to_string(lastSync) + ",\"buffer\":[";
+    char crc[16];
+    for (size_t i = 0; i < buffer.size(); i++) {
+        const Item& it = buffer[i];
+        if (i) out += ",";
+        snprintf(crc, sizeof(crc), "%x", it.crc);
+        out += "{\"bike_id\":\"" + it.bikeId + "\",\"ts\":" + std::to_string(it.ts) +
+               ",\"size\":" + std::to_string(it.data.size()) + ",\"crc32\":\"" + crc +
+               "\",\"uploaded\":false,\"confirmed\":false,\"compressed\":false,\"data\":\"";
+        out.append(it.data.size() * 2, 'F');
+        out += "\"}";
+    }
+    out += "]}";
+    return out.size();
+}
+
+static size_t journalDataSize(const Item& it) {
+    uint8_t payload[BufferJournal::MAX_PAYLOAD];
+    BufferJournal::DataRecord r;
+    r.seq = 0;
+    r.timestamp = it.ts;
+    r.itemCrc = it.crc;
+    r.flags = 0;
+    r.bikeId = it.bikeId.c_str();
+    r.bikeIdLen = it.bikeId.size();
+    r.data = it.data.data();
+    r.size = it.data.size();
+    return BufferJournal::HEADER_SIZE + BufferJournal::encodeData(payload, sizeof(payload), r);
+}
+
+int main(int argc, char** argv) {
+    int records = argc > 1 ? atoi(argv[1]) : 10000;
+    int perSync = argc > 2 ? atoi(argv[2]) : 50;
+    const size_t segmentSize = 32768;
+
+    // Caminho JSON: rewrite completo a cada 5 inserções e após cada confirmação
+    size_t jsonBytes = 0, jsonWrites = 0;
+    {
+        std::vector<Item> buffer;
+        for (int i = 0; i < records; i++) {
+            buffer.push_back(makeItem(i));
+            if (buffer.size() % 5 == 0) { jsonBytes += jsonFileSize(buffer, 0); jsonWrites++; }
+            if ((int)buffer.size() == perSync) {
+                buffer.clear();
+                jsonBytes += jsonFileSize(buffer, i); jsonWrites++;
+            }
+        }
+    }
+
+    // Journal: append por inserção, trim por confirmação, compactação ao encher o segmento
+    size_t jnlBytes = 0, jnlWrites = 0, compactions = 0;
+    {
+        std::vector<Item> buffer;
+        size_t segment = 0;
+        for (int i = 0; i < records; i++) {
+            buffer.push_back(makeItem(i));
+            size_t n = journalDataSize(buffer.back());
+            jnlBytes += n; segment += n; jnlWrites++;
+            if ((int)buffer.size() == perSync) {
+                buffer.clear();
+                size_t t = BufferJournal::HEADER_SIZE + BufferJournal::TRIM_SIZE;
+                jnlBytes += t; segment += t; jnlWrites++;
+            }
+            if (segment >= segmentSize) {
+                size_t live = 0;
+                for (const Item& it : buffer) live += journalDataSize(it);
+                jnlBytes += live; segment = live; compactions++;
+            }
+        }
+    }
+
+    printf("records=%d items_per_sync=%d payload_avg=%zu bytes\n",
+           records, perSync, makeItem(0).data.size());
+    printf("%-8s %14s %10s %16s\n", "path", "bytes_written", "writes", "bytes_per_record");
+    printf("%-8s %14zu %10zu %16.1f\n", "json", jsonBytes, jsonWrites, (double)jsonBytes / records);
+    printf("%-8s %14zu %10zu %16.1f  (compactions=%zu)\n", "journal", jnlBytes, jnlWrites,
+           (double)jnlBytes / records, compactions);
+    printf("ratio json/journal: %.1fx\n", (double)jsonBytes / jnlBytes);
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Benchmark/checagem de host: corpo do upload do buffer (include/upload_stream.h).
+// Monta uma janela com o mesmo layout de BufferManager::writeUploadRecord (itens
+// JSON pequenos + um item binário renderizado no tamanho máximo), passa pelo
+// UploadStream lendo em pedaços de vários tamanhos como o HTTPClient faria e
+// confere byte a byte com o corpo renderizado direto; também confere que um
+// item maior que o stage aborta antes do envio.
+//
+//   g++ -O2 -std=c++17 -Ibench/host -Iinclude bench/upload_stream_bench.cpp src/base64_codec.cpp -o /tmp/upload_stream_bench
+//   /tmp/upload_stream_bench [itens]
+//
+// Rodar a partir de firmware/central. Sai com código 1 se alguma checagem falhar.
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "base64_codec.h"
+#include "constants.h"
+#include "upload_stream.h"
+
+struct Item {
+    uint32_t seq;
+    std::string bikeId;
+    uint32_t ts;
+    std::vector<uint8_t> data;
+};
+
+// String que também é Print (corpo de referência)
+class StringPrint : public Print {
+public:
+    std::string text;
+    size_t write(uint8_t c) override { text.push_back((char)c); return 1; }
+};
+
+// Janela de upload fake; mesmos limites de BufferManager
+class FakeWindow {
+public:
+    static const size_t MAX_ITEM_SIZE = 256;
+    static const size_t WIRE_JSON_MAX = 2048;
+    static const size_t UPLOAD_ITEM_MAX = Base64Codec::encodedLength(WIRE_JSON_MAX) + 160 + 2 * BIKE_ID_LENGTH;
+
+    std::vector<Item> items;
+
+    void writeUploadHeader(Print& out) {
+        out.printf("{\"%010lu\":{\"timestamp\":%lu,\"base_id\":\"base01\",", (unsigned long)items.front().seq, 1733459200ul);
+        out.printf("\"first_seq\":%lu,\"last_seq\":%lu,\"data_count\":%u,\"encoding\":\"base64\",\"data\":[",
+                   (unsigned long)items.front().seq, (unsigned long)items.back().seq, (unsigned)items.size());
+    }
+
+    void writeUploadItem(int index, Print& out) {
+        const Item& item = items[index];
+        if (index > 0) out.write(',');
+        out.printf("{\"seq\":%lu,\"bike_id\":\"%s\"", (unsigned long)item.seq, item.bikeId.c_str());
+        out.printf(",\"ts\":%lu,\"size\":%u,\"crc32\":\"%x\",\"compressed\":false,",
+                   (unsigned long)item.ts, (unsigned)item.data.size(), 0xDEADBEEFu);
+        out.print("\"data\":\"");
+        char encoded[Base64Codec::encodedLength(MAX_ITEM_SIZE)];
+        const size_t block = MAX_ITEM_SIZE - MAX_ITEM_SIZE % 3;
+        for (size_t offset = 0; offset < item.data.size(); offset += block) {
+            size_t part = item.data.size() - offset;
+            if (part > block) part = block;
+            out.write((const uint8_t*)encoded, Base64Codec::encode(item.data.data() + offset, part, encoded));
+        }
+        out.print("\"}");
+    }
+
+    void writeUploadFooter(Print& out) { out.print("]}}"); }
+};
+
+static Item makeItem(uint32_t i, size_t size) {
+    Item item;
+    item.seq = 1000 + i;
+    char id[16];
+    snprintf(id, sizeof(id), "bpr-%06x", 0xa1b2c3 + (i % 7));
+    item.bikeId = id;
+    item.ts = 1733459200u + i * 30;
+    for (size_t b = 0; b < size; b++) item.data.push_back((uint8_t)('a' + (i + b) % 26));
+    return item;
+}
+
+static std::string render(FakeWindow& window) {
+    StringPrint out;
+    window.writeUploadHeader(out);
+    for (size_t i = 0; i < window.items.size(); i++) window.writeUploadItem((int)i, out);
+    window.writeUploadFooter(out);
+    return out.text;
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) failures++;
+}
+
+// Lê o corpo inteiro em pedaços de `chunk` bytes, como o HTTPClient
+static std::string drain(UploadStream<FakeWindow>& body, size_t chunk) {
+    std::string text;
+    std::vector<char> piece(chunk);
+    while (body.available() > 0) {
+        size_t n = body.readBytes(piece.data(), chunk);
+        if (n == 0) break;
+        text.append(piece.data(), n);
+    }
+    return text;
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 50;
+    if (count < 2) count = 2;
+
+    FakeWindow window;
+    for (int i = 0; i < count; i++) window.items.push_back(makeItem(i, 120 + (i * 37) % 130));
+    // Item binário renderizado no maior JSON possível: a maior parte que o stage aceita
+    window.items[count / 2] = makeItem(count / 2, FakeWindow::WIRE_JSON_MAX);
+
+    std::string expected = render(window);
+    printf("upload window: %d items, %zu bytes, stage %zu bytes\n",
+           count, expected.size(), UploadStream<FakeWindow>::STAGE_SIZE);
+
+    const size_t chunks[] = {1, 7, 128, 1460, 4096};
+    for (size_t chunk : chunks) {
+        UploadStream<FakeWindow> body(window, count);
+        char label[64];
+        snprintf(label, sizeof(label), "Content-Length matches body (chunk %zu)", chunk);
+        check(body.size() == expected.size(), label);
+        std::string streamed = drain(body, chunk);
+        snprintf(label, sizeof(label), "streamed body equals rendered body (chunk %zu)", chunk);
+        check(!body.hasFailed() && streamed == expected, label);
+    }
+
+    // Item maior que o stage: falha na passada de contagem, nada é enviado
+    FakeWindow oversized = window;
+    oversized.items[0] = makeItem(0, FakeWindow::UPLOAD_ITEM_MAX);
+    UploadStream<FakeWindow> body(oversized, count);
+    check(body.hasFailed(), "oversized item fails before send");
+    check(drain(body, 1460).empty(), "failed stream yields no bytes");
+
+    return failures == 0 ? 0 : 1;
+}
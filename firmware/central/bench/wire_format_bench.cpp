@@ -0,0 +1,145 @@
+// Benchmark de host: formato binário das mensagens BLE (src/wire_format.cpp).
+// Monta as mensagens da bici (status e lote de scans WiFi) em JSON, no mesmo
+// formato que o ArduinoJson gerava, e em TLV; mostra bytes no ar, tempo de
+// encode/decode e confere o split em itens do buffer e o JSON do upload.
+//
+//   g++ -O2 -std=c++17 -Iinclude bench/wire_format_bench.cpp src/wire_format.cpp -o /tmp/wire_format_bench
+//   /tmp/wire_format_bench [scans] [iteracoes]
+//
+// Rodar a partir de firmware/central.
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wire_format.h"
+
+static const char* BIKE_ID = "bpr-a1b2c3";
+static const size_t MAX_ITEM_SIZE = 256;   // BufferManager::MAX_ITEM_SIZE
+
+static WireFormat::Scan makeScan(uint32_t i) {
+    WireFormat::Scan scan;
+    scan.timestamp = 1700000000 + i * 300;
+    for (int b = 0; b < 6; b++) scan.bssid[b] = (uint8_t)(i * 31 + b * 17);
+    scan.rssi = (int8_t)(-40 - (int)(i % 50));
+    return scan;
+}
+
+static size_t statusJson(char* out, size_t capacity) {
+    return snprintf(out, capacity, "{\"bike_id\":\"%s\",\"battery\":3.82,\"records\":42,\"heap\":174248,\"timestamp\":1234}",
+                    BIKE_ID);
+}
+
+static size_t statusWire(uint8_t* out, size_t capacity) {
+    WireFormat::Writer writer(out, capacity, WireFormat::MSG_STATUS);
+    writer.putString(WireFormat::TAG_BIKE_ID, BIKE_ID);
+    writer.putU16(WireFormat::TAG_BATTERY_MV, 3820);
+    writer.putU8(WireFormat::TAG_BATTERY_PCT, 62);
+    writer.putU16(WireFormat::TAG_RECORDS, 42);
+    writer.putU32(WireFormat::TAG_HEAP, 174248);
+    writer.putU32(WireFormat::TAG_TIMESTAMP, 1234);
+    return writer.length();
+}
+
+static size_t scansJson(uint32_t scans, char* out, size_t capacity) {
+    size_t used = snprintf(out, capacity, "{\"bike_id\":\"%s\",\"scans\":[", BIKE_ID);
+    for (uint32_t i = 0; i < scans && used < capacity; i++) {
+        WireFormat::Scan s = makeScan(i);
+        used += snprintf(out + used, capacity - used, "%s{\"ts\":%lu,\"bssid\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"rssi\":%d}",
+                         i ? "," : "", (unsigned long)s.timestamp, s.bssid[0], s.bssid[1], s.bssid[2],
+                         s.bssid[3], s.bssid[4], s.bssid[5], s.rssi);
+    }
+    used += snprintf(out + used, capacity - used, "]}");
+    return used;
+}
+
+static size_t scansWire(uint32_t scans, uint8_t* out, size_t capacity) {
+    WireFormat::Writer writer(out, capacity, WireFormat::MSG_WIFI_SCANS);
+    writer.putString(WireFormat::TAG_BIKE_ID, BIKE_ID);
+    for (uint32_t i = 0; i < scans; i++) writer.putScan(makeScan(i));
+    return writer.length();
+}
+
+struct SplitCheck {
+    uint32_t pieces;
+    uint32_t scans;
+    size_t largest;
+    bool ok;
+};
+
+static bool collect(const uint8_t* piece, size_t length, void* context) {
+    SplitCheck& check = *(SplitCheck*)context;
+    check.pieces++;
+    if (length > check.largest) check.largest = length;
+
+    WireFormat::Reader reader(piece, length);
+    bool hasId = false;
+    while (reader.next()) {
+        if (reader.tag() == WireFormat::TAG_SCAN) check.scans++;
+        if (reader.tag() == WireFormat::TAG_BIKE_ID) hasId = true;
+    }
+    if (!reader.valid() || reader.error() || !hasId) check.ok = false;
+
+    // Cada item precisa render JSON para o upload
+    static char json[4096];
+    if (WireFormat::toJson(piece, length, 1700000000, json, sizeof(json)) == 0) check.ok = false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t scans = argc > 1 ? (uint32_t)atol(argv[1]) : 50;
+    uint32_t iterations = argc > 2 ? (uint32_t)atol(argv[2]) : 100000;
+    int errors = 0;
+
+    static char json[16384];
+    static uint8_t wire[16384];
+
+    size_t statusJsonBytes = statusJson(json, sizeof(json));
+    size_t statusWireBytes = statusWire(wire, sizeof(wire));
+    size_t scanJsonBytes = scansJson(scans, json, sizeof(json));
+    size_t scanWireBytes = scansWire(scans, wire, sizeof(wire));
+    if (statusWireBytes == 0 || scanWireBytes == 0) {
+        printf("mensagem não coube no buffer\n");
+        return 1;
+    }
+
+    printf("%-22s %8s %8s %7s\n", "mensagem", "JSON", "binário", "razão");
+    printf("%-22s %8zu %8zu %6.1fx\n", "status", statusJsonBytes, statusWireBytes,
+           (double)statusJsonBytes / statusWireBytes);
+    char label[32];
+    snprintf(label, sizeof(label), "wifi (%u scans)", scans);
+    printf("%-22s %8zu %8zu %6.1fx\n", label, scanJsonBytes, scanWireBytes, (double)scanJsonBytes / scanWireBytes);
+
+    // Encode + decode completo (todos os campos), sem alocação
+    auto start = std::chrono::steady_clock::now();
+    uint32_t checksum = 0;
+    for (uint32_t n = 0; n < iterations; n++) {
+        size_t length = scansWire(scans, wire, sizeof(wire));
+        WireFormat::Reader reader(wire, length);
+        WireFormat::Scan scan;
+        while (reader.next()) {
+            if (reader.asScan(scan)) checksum += scan.timestamp + scan.rssi;
+        }
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("encode+decode wifi: %.2f µs/mensagem (checksum %u)\n", us / iterations, checksum);
+
+    // Split em itens do buffer + JSON do upload para cada item
+    SplitCheck check = { 0, 0, 0, true };
+    static uint8_t piece[MAX_ITEM_SIZE];
+    bool split = WireFormat::split(wire, scanWireBytes, piece, sizeof(piece), collect, &check);
+    printf("split: %u itens (maior %zu/%zu bytes), %u/%u scans\n", check.pieces, check.largest, MAX_ITEM_SIZE,
+           check.scans, scans);
+    if (!split || !check.ok || check.scans != scans || check.largest > MAX_ITEM_SIZE) errors++;
+
+    size_t jsonLength = WireFormat::toJson(wire, statusWire(wire, sizeof(wire)), 1700000000, json, sizeof(json));
+    printf("upload (status): %s\n", jsonLength ? json : "FALHOU");
+    if (!jsonLength) errors++;
+
+    // Mensagem truncada não pode passar
+    size_t length = statusWire(wire, sizeof(wire));
+    WireFormat::Reader truncated(wire, length - 1);
+    while (truncated.next()) {}
+    if (!truncated.error()) errors++;
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Formato compactado dos backups retidos (.bpa).
+// Sem dependências de Arduino para poder ser testado no host.
+//
+// Arquivo: [magic "BPA":3][versão:1] seguido de blocos
+//   [raw_len:2][stored_len:2][crc32:4][stored]   (little-endian)
+// Cada bloco cobre até BLOCK_SIZE bytes do arquivo original e é comprimido
+// com o PayloadCompressor; stored_len == raw_len indica bloco guardado cru.
+// O CRC é do bloco original, para validar a expansão.
+namespace BackupArchive {
+
+    const uint8_t VERSION = 1;
+    const size_t FILE_HEADER_SIZE = 4;
+    const size_t BLOCK_HEADER_SIZE = 8;
+    const size_t BLOCK_SIZE = 1024;   // limite de entrada do PayloadCompressor
+    const size_t MAX_BLOCK = BLOCK_HEADER_SIZE + BLOCK_SIZE;
+
+    struct BlockHeader {
+        uint16_t rawLength;
+        uint16_t storedLength;
+        uint32_t crc;
+    };
+
+    void writeFileHeader(uint8_t* out);
+    bool checkFileHeader(const uint8_t* in);
+
+    // Monta um bloco completo em `out` (MAX_BLOCK bytes); retorna o tamanho
+    size_t encodeBlock(const uint8_t* raw, size_t length, uint32_t crc, uint8_t* out);
+
+    bool parseBlockHeader(const uint8_t* in, BlockHeader& header);
+
+    // Expande `stored` em `raw` (BLOCK_SIZE bytes); retorna rawLength ou 0 se inválido
+    size_t decodeBlock(const BlockHeader& header, const uint8_t* stored, uint8_t* raw);
+}
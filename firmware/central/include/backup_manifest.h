@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Índice persistido dos backups do BufferManager (/backup.idx).
+// Retenção, contagem de espaço e despejo trabalham só com este índice,
+// sem listar o diretório. Sem dependências de Arduino (testável no host).
+//
+// Arquivo: [magic "BIX":3][versão:1][count:2] + count entradas de ENTRY_SIZE bytes
+//   entrada: [id:4][timestamp:4][size:4][first_seq:4][last_seq:4][kind:1]  (little-endian)
+namespace BackupManifest {
+
+    const uint8_t VERSION = 1;
+    const size_t HEADER_SIZE = 6;
+    const size_t ENTRY_SIZE = 21;
+    const size_t MAX_ENTRIES = 64;
+    const size_t MAX_FILE_SIZE = HEADER_SIZE + MAX_ENTRIES * ENTRY_SIZE;
+
+    // Conteúdo do backup (formato interno) + bit de arquivo compactado (.bpa)
+    const uint8_t KIND_JOURNAL = 1;   // registros do journal/spill (.jnl)
+    const uint8_t KIND_JSON = 2;      // cópia do /buffer.json (.json)
+    const uint8_t KIND_ARCHIVED = 0x80;
+
+    struct Entry {
+        uint32_t id;
+        uint32_t timestamp;
+        uint32_t size;
+        uint32_t firstSeq;
+        uint32_t lastSeq;
+        uint8_t kind;
+    };
+
+    // Retorna o tamanho escrito em `out` (MAX_FILE_SIZE bytes)
+    size_t encode(const Entry* entries, size_t count, uint8_t* out);
+
+    // Retorna o número de entradas, ou -1 se o arquivo for inválido
+    int decode(const uint8_t* in, size_t length, Entry* entries, size_t maxEntries);
+
+    // "/backup_<id>.<jnl|json|bpa>"
+    void path(const Entry& entry, char* out);
+}
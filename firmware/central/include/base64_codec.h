@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Base64 (RFC 4648, com padding) por tabela, sem alocação.
+// Usado pela persistência JSON do buffer e pelo corpo do upload.
+namespace Base64Codec {
+
+    constexpr size_t encodedLength(size_t length) { return ((length + 2) / 3) * 4; }
+    constexpr size_t maxDecodedLength(size_t length) { return (length / 4) * 3 + 3; }
+
+    // Escreve encodedLength(length) caracteres em `out` (sem terminador)
+    size_t encode(const uint8_t* input, size_t length, char* out);
+
+    // Retorna bytes decodificados, ou 0 se inválido / não couber em `capacity`.
+    // `out` pode apontar para o próprio `input` (decodificação in-place).
+    size_t decode(const char* input, size_t length, uint8_t* out, size_t capacity);
+
+    // Hex legado (buffer.json antigo); mesmas regras de decode()
+    size_t decodeHex(const char* input, size_t length, uint8_t* out, size_t capacity);
+}
@@ -1,6 +1,5 @@
 #pragma once
 #include <Arduino.h>
-#include <map>
 #include <vector>
 #include <ArduinoJson.h>
 
@@ -11,6 +10,17 @@ public:
     static bool loadData();
     static bool saveData();
     
+    // Write-behind: mutações marcam o registro sujo; a gravação acontece no
+    // prazo (update), em transições de estado e antes de reiniciar (flush)
+    struct WriteStats {
+        uint32_t flushes;
+        uint32_t bytesWritten;
+        uint32_t flushesAvoided;   // mutações absorvidas por uma gravação pendente
+    };
+    static void update();
+    static bool flush();
+    static const WriteStats& getWriteStats();
+    
     // Controle de acesso (ex-BikeRegistry)
     static bool canConnect(const String& bikeId);
     static bool isAllowed(const String& bikeId);
@@ -27,15 +37,32 @@ public:
     // Configurações (ex-BikeConfigManager)
     static bool hasConfigUpdate(const String& bikeId);
     static void markConfigSent(const String& bikeId);
+    // Push não chegou a sair (maior que o MTU da bike): volta a ficar pendente
+    static void markConfigUnsent(const String& bikeId);
+    // Bike confirmou com config_received: persiste a versão entregue
+    static void markConfigDelivered(const String& bikeId, uint16_t version);
     static String getConfigForBike(const String& bikeId);
+    // Versão do config que getConfigForBike() devolve (0 = defaults);
+    // chave do cache de payloads do BPRBLEServer
+    static uint16_t getConfigVersion(const String& bikeId);
     static String generateDefaultConfig(const String& bikeId);
     static std::vector<String> getBikesWithUpdates();
     
     // Sincronização Firebase
     static bool downloadFromFirebase();
+    // Monta um PATCH multi-path só com os campos alterados; os bits só são
+    // limpos em confirmUpload() (HTTP 200). false = nada pendente
     static bool uploadToFirebase(DynamicJsonDocument& doc);
+    static void confirmUpload();
+    static void rollbackUpload();
     static void updateFromFirebase(const DynamicJsonDocument& firebaseData);
     
     // Logs e eventos
-    static void logConfigEvent(const String& bikeId, const String& event, bool success);
+    // event: BikeRegistry::EVENT_*; guardado no anel binário da bike, JSON só no upload
+    static void logConfigEvent(const String& bikeId, uint8_t event, bool success);
+
+private:
+    static void markDirty();
+    static void markFields(int slot, uint16_t fields);
+    static bool applyConfig(const char* bikeId, JsonObjectConst config);
 };
\ No newline at end of file
@@ -25,10 +25,8 @@ public:
     static int countSleepingBikes();
     static int countOverdueBikes();
     
-    // Métodos de processamento de dados
-    static void processDataQueue();
-    static void requestDataFromBike(const String& bikeId);
-    static void processDataFromBike(const String& bikeId, const String& jsonData);
-    static void enqueueBike(const String& bikeId, const String& jsonData);
-    static void finishCurrentBike();
+    // Sessões de ingestão: uma por conexão, atendidas em round-robin
+    // (um registro por sessão a cada volta) para nenhuma bike esperar as outras
+    static void processSessions();
+    static void processDataFromBike(const String& bikeId, const uint8_t* data, size_t length);
 };
\ No newline at end of file
@@ -0,0 +1,230 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Registro tipado da frota, dividido em duas camadas:
+//   Directory: sempre residente, ~12 bytes por bike conhecida (chave do ID,
+//              bitmap de status de 2 bits, bits de config/upload e versão da
+//              config). Responde canConnect/isAllowed e os contadores sem flash.
+//   Cache:     working set LRU com o registro completo das bikes quentes; o
+//              resto fica em shards por hash do ID no LittleFS.
+// Busca em tempo constante e sem alocação, para ser chamado dos callbacks BLE.
+// JSON só existe nas bordas (Firebase/BLE). Sem dependências de Arduino para
+// poder ser compilado no host.
+//
+// Registro persistido (little-endian, RECORD_SIZE bytes):
+//   [id:10][status:1][visit_count:2][battery:2][heap:4][first_seen:4][last_visit:4]
+//   [last_heartbeat:4][config_version:2][delivered_version:2]
+// O /bike_data.bin antigo usa os primeiros LEGACY_RECORD_SIZE bytes.
+//
+// Entrada do índice (/bikes/index.bin): [chave:6][bits:1][config_version:2]
+//
+// Log de eventos de config (ConfigLog, CONFIG_LOG_BYTES no máximo):
+//   [count:1] + count x [timestamp:4][código:1], do mais antigo ao mais novo
+namespace BikeRegistry {
+
+    const size_t ID_LENGTH = 10;          // "bpr-xxxxxx"
+    const size_t KEY_LENGTH = ID_LENGTH - 4;   // prefixo "bpr-" é constante
+    const size_t CAPACITY = 512;          // bikes conhecidas por central (Directory)
+    const size_t INDEX_SIZE = 1024;       // potência de 2, ocupação <= 50%
+    const size_t CACHE_SIZE = 16;         // registros completos em RAM (LRU)
+    const size_t SHARD_COUNT = 16;        // arquivos /bikes/sXX.bin (potência de 2)
+    const size_t RECORD_SIZE = 35;
+    const size_t LEGACY_RECORD_SIZE = 31;
+    const size_t INDEX_ENTRY_SIZE = KEY_LENGTH + 3;
+
+    // Contato recente: heartbeat nos últimos RECENT_WINDOW_SEC, contado em baldes
+    // de RECENT_BUCKET_SEC (precisão de um balde na borda da janela)
+    const uint32_t RECENT_WINDOW_SEC = 300;
+    const uint32_t RECENT_BUCKET_SEC = 30;
+    const size_t RECENT_BUCKETS = RECENT_WINDOW_SEC / RECENT_BUCKET_SEC;
+
+    const size_t CONFIG_LOG_SIZE = 10;     // eventos de config guardados por bike
+    const size_t CONFIG_LOG_ENTRY_SIZE = 5;
+    const size_t CONFIG_LOG_BYTES = 1 + CONFIG_LOG_SIZE * CONFIG_LOG_ENTRY_SIZE;
+
+    enum Status : uint8_t {
+        STATUS_UNKNOWN = 0,
+        STATUS_PENDING = 1,
+        STATUS_ALLOWED = 2,
+        STATUS_BLOCKED = 3
+    };
+
+    // Código de evento de config; o bit alto marca sucesso
+    enum ConfigEvent : uint8_t {
+        EVENT_UNKNOWN = 0,
+        EVENT_CONFIG_UPDATED = 1,     // versão nova baixada do Firebase
+        EVENT_CONFIG_SENT = 2,        // push BLE
+        EVENT_CONFIG_DELIVERED = 3,   // bike confirmou com config_received
+        EVENT_CONFIG_REJECTED = 4     // bike recusou/falhou ao aplicar
+    };
+    const uint8_t EVENT_SUCCESS = 0x80;
+
+    // Bits por bike no Directory. Só FLAG_CONFIG_PENDING é persistido no índice
+    const uint8_t FLAG_CONFIG_PENDING = 0x01;   // configVersion > deliveredVersion
+    const uint8_t FLAG_CONFIG_SENT = 0x02;      // push feito nesta sessão (runtime)
+    const uint8_t FLAG_UPLOAD = 0x04;           // campos pendentes de upload (runtime)
+    const uint8_t FLAG_RECENT = 0x08;           // heartbeat contado em RecentContacts (runtime)
+    const uint8_t PERSISTED_FLAGS = FLAG_CONFIG_PENDING;
+
+    // Campos alterados desde o último upload confirmado (runtime)
+    const uint16_t FIELD_STATUS = 0x0001;
+    const uint16_t FIELD_FIRST_SEEN = 0x0002;
+    const uint16_t FIELD_LAST_VISIT = 0x0004;
+    const uint16_t FIELD_VISIT_COUNT = 0x0008;
+    const uint16_t FIELD_HEARTBEAT = 0x0010;     // last_heartbeat/timestamp
+    const uint16_t FIELD_BATTERY = 0x0020;
+    const uint16_t FIELD_HEAP = 0x0040;
+    const uint16_t FIELD_CONFIG = 0x0080;
+    const uint16_t FIELD_CONFIG_LOG = 0x0100;
+    const uint16_t FIELD_ALL = 0x01FF;
+
+    // Registro completo; status e configVersion moram no Directory
+    struct Bike {
+        char id[ID_LENGTH + 1];
+        uint16_t visitCount;
+        int16_t battery;
+        uint32_t heap;
+        uint32_t firstSeen;
+        uint32_t lastVisit;
+        uint32_t lastHeartbeat;   // 0 = nunca
+        uint16_t deliveredVersion;  // última versão confirmada pela bike (config_received)
+        uint16_t dirtyFields;     // FIELD_*, pendentes de upload (runtime)
+        uint16_t uploadFields;    // FIELD_* no PATCH em andamento; fixa a bike no cache
+    };
+
+    bool isValidId(const char* id, size_t length);
+
+    const char* statusName(uint8_t status);
+    uint8_t parseStatus(const char* name);
+
+    const char* eventName(uint8_t event);
+    uint8_t parseEvent(const char* name);
+
+    // Shard do ID (FNV-1a dos caracteres variáveis)
+    uint8_t shardOf(const char* id);
+
+    // Anel de baldes de tempo: cada heartbeat soma no balde do seu instante e
+    // baldes fora da janela simplesmente deixam de ser contados (sem varredura)
+    class RecentContacts {
+    public:
+        RecentContacts();
+        void clear();
+        void add(uint32_t timestamp);
+        void remove(uint32_t timestamp);
+        uint16_t count(uint32_t now) const;
+
+    private:
+        uint32_t bucketId[RECENT_BUCKETS];
+        uint16_t bucketCount[RECENT_BUCKETS];
+    };
+
+    // Anel fixo dos últimos CONFIG_LOG_SIZE eventos de config: o evento mais
+    // novo sobrescreve o mais antigo, sem alocação. JSON só no upload
+    class ConfigLog {
+    public:
+        ConfigLog() { clear(); }
+
+        void clear() { head = 0; count = 0; }
+        void add(uint32_t timestamp, uint8_t event, bool success);
+
+        // i = 0 é o evento mais antigo
+        size_t size() const { return count; }
+        uint32_t timestamp(size_t i) const { return timestamps[slot(i)]; }
+        uint8_t event(size_t i) const { return codes[slot(i)] & ~EVENT_SUCCESS; }
+        bool success(size_t i) const { return (codes[slot(i)] & EVENT_SUCCESS) != 0; }
+
+        // Serializa em `out` (CONFIG_LOG_BYTES bytes); retorna o tamanho usado
+        size_t encode(uint8_t* out) const;
+        // `in` começa no byte count; false se count > CONFIG_LOG_SIZE ou faltar dado
+        bool decode(const uint8_t* in, size_t length);
+
+    private:
+        uint32_t timestamps[CONFIG_LOG_SIZE];
+        uint8_t codes[CONFIG_LOG_SIZE];
+        uint8_t head;    // próxima posição de escrita
+        uint8_t count;
+
+        size_t slot(size_t i) const { return (head + CONFIG_LOG_SIZE - count + i) % CONFIG_LOG_SIZE; }
+    };
+
+    // Índice residente de toda a frota. Entradas não são removidas
+    // individualmente; contadores por status mantidos a cada setStatus
+    class Directory {
+    public:
+        Directory();
+
+        void clear();
+        size_t size() const { return count; }
+
+        // Entrada do ID ou -1
+        int find(const char* id, size_t length) const;
+        // Entrada existente ou nova (STATUS_UNKNOWN, sem flags); -1 se ID inválido ou cheio
+        int insert(const char* id, size_t length);
+
+        // Monta "bpr-xxxxxx" em `out` (ID_LENGTH + 1 bytes)
+        void id(int entry, char* out) const;
+        uint8_t shard(int entry) const;
+
+        uint8_t status(int entry) const { return (statusBits[entry >> 2] >> ((entry & 3) * 2)) & 0x03; }
+        void setStatus(int entry, uint8_t status);
+
+        bool flag(int entry, uint8_t flag) const { return (flags[entry] & flag) != 0; }
+        void setFlag(int entry, uint8_t flag, bool on);
+
+        uint16_t configVersion(int entry) const { return configVersions[entry]; }
+        void setConfigVersion(int entry, uint16_t version) { configVersions[entry] = version; }
+
+        uint16_t statusCount(uint8_t status) const { return status <= STATUS_BLOCKED ? byStatus[status] : 0; }
+
+        // Entrada do índice persistido (INDEX_ENTRY_SIZE bytes)
+        void encodeEntry(int entry, uint8_t* out) const;
+        // -1 se a chave for inválida ou o Directory estiver cheio
+        int decodeEntry(const uint8_t* in);
+
+    private:
+        char keys[CAPACITY][KEY_LENGTH];
+        uint8_t statusBits[CAPACITY / 4];   // 2 bits por entrada
+        uint8_t flags[CAPACITY];
+        uint16_t configVersions[CAPACITY];  // 0 = sem config (usa defaults)
+        uint16_t index[INDEX_SIZE];         // entrada + 1; 0 = vazio
+        size_t count;
+        uint16_t byStatus[STATUS_BLOCKED + 1];
+
+        static uint32_t hash(const char* key);
+    };
+
+    // Working set LRU de registros completos. Slots com uploadFields != 0
+    // estão num PATCH em andamento e não são escolhidos para despejo
+    class Cache {
+    public:
+        Cache();
+
+        void clear();
+
+        // Slot da entrada do Directory ou -1
+        int find(int entry) const;
+        // Slot livre, ou o menos usado recentemente que não esteja fixado; -1 se nenhum
+        int victim() const;
+        // Associa o slot à entrada (o registro deve ser preenchido pelo chamador)
+        void bind(int slot, int entry);
+        void release(int slot);
+        void touch(int slot) { lastUse[slot] = ++tick; }
+
+        bool used(int slot) const { return entries[slot] >= 0; }
+        int entry(int slot) const { return entries[slot]; }
+        Bike& at(int slot) { return bikes[slot]; }
+        const Bike& at(int slot) const { return bikes[slot]; }
+
+    private:
+        Bike bikes[CACHE_SIZE];
+        int16_t entries[CACHE_SIZE];   // -1 = livre
+        uint32_t lastUse[CACHE_SIZE];
+        uint32_t tick;
+    };
+
+    // status vem à parte (mora no Directory)
+    void encodeRecord(const Bike& bike, uint8_t status, uint16_t configVersion, uint8_t* out);
+    // Aceita RECORD_SIZE e LEGACY_RECORD_SIZE; false se o ID gravado for inválido
+    bool decodeRecord(const uint8_t* in, size_t size, Bike& bike, uint8_t& status, uint16_t& configVersion);
+}
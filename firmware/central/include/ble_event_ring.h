@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Fila SPSC sem lock entre os callbacks do NimBLE (produtor: task do host BLE)
+// e o loop principal (consumidor). Slots de tamanho fixo em memória estática:
+// push() só copia bytes, nunca aloca nem bloqueia. Parse de JSON, registro de
+// bikes e gravações em flash acontecem todos no consumidor.
+// Sem dependências de Arduino para poder ser compilado no host (bench/).
+namespace BleEvents {
+
+    const size_t SLOT_COUNT = 16;       // potência de 2
+    const size_t MAX_PAYLOAD = 512;     // BLE_ATT_ATTR_MAX_LEN
+
+    enum Type : uint8_t {
+        EVENT_CONNECT = 1,
+        EVENT_DISCONNECT = 2,
+        EVENT_DATA_WRITE = 3,
+        EVENT_CONFIG_WRITE = 4
+    };
+
+    struct Event {
+        uint8_t type;
+        uint16_t connHandle;
+        uint16_t length;
+        uint8_t data[MAX_PAYLOAD];
+    };
+
+    struct Stats {
+        uint32_t pushed;
+        uint32_t dropped;       // fila cheia ou payload maior que MAX_PAYLOAD
+        uint16_t highWater;     // maior ocupação vista desde o boot
+    };
+
+    class Ring {
+    public:
+        Ring();
+
+        // Produtor. false = evento descartado (contado em Stats::dropped)
+        bool push(uint8_t type, uint16_t connHandle, const uint8_t* data = nullptr, size_t length = 0);
+
+        // Produtor em duas fases, para copiar direto da origem (mbuf do NimBLE)
+        // para o slot: reserve() devolve o slot livre com type/connHandle/length
+        // preenchidos, ou nullptr (descarte contado); commit() publica.
+        // Slot reservado e não publicado é simplesmente reusado no próximo reserve()
+        Event* reserve(uint8_t type, uint16_t connHandle, size_t length);
+        void commit();
+
+        // Consumidor: evento mais antigo, ou nullptr se vazia. O slot continua
+        // do consumidor até pop()
+        const Event* front() const;
+        void pop();
+
+        size_t size() const;
+        // Só com o produtor parado (BLE desligado)
+        void clear();
+        Stats stats() const;
+
+    private:
+        Event slots[SLOT_COUNT];
+        std::atomic<uint32_t> head;      // escrito só pelo produtor
+        std::atomic<uint32_t> tail;      // escrito só pelo consumidor
+        std::atomic<uint32_t> pushed;
+        std::atomic<uint32_t> dropped;
+        std::atomic<uint16_t> highWater;
+    };
+}
@@ -11,20 +11,45 @@ public:
     static void pushConfigToBike(const String& bikeId, const String& config);
     static bool isBikeConnected(const String& bikeId);
     static void forceDisconnectBike(const String& bikeId);
-    static void sendConfigToHandle(uint16_t handle, const String& bikeId, const String& config);
+    static bool sendConfigToHandle(uint16_t handle, const String& bikeId, const String& config);
+    // Envia o config da bike a partir do cache de payloads prontos
+    // (chave bike + versão); false se a bike não estiver conectada ou o
+    // config não couber no MTU dela (não marcar como enviado)
+    static bool pushBikeConfig(const String& bikeId);
+    static bool sendCachedConfig(uint16_t handle, const String& bikeId);
     static void checkAndSendPendingConfig(const String& bikeId, uint16_t handle);
     
-    // Callbacks implementados externamente no bike_pairing.cpp
+    // Processa no loop principal os eventos enfileirados pelos callbacks do NimBLE
+    static void poll();
+    struct EventStats {
+        uint16_t highWater;   // maior ocupação da fila desde o boot
+        uint16_t capacity;
+        uint32_t dropped;
+    };
+    static EventStats getEventStats();
+    // Transferências em blocos (BleTransfer) concluídas; vazão = bytes / millis
+    struct TransferStats {
+        uint32_t completed;
+        uint32_t resumed;
+        uint32_t crcFailures;
+        uint32_t bytes;
+        uint32_t millis;
+    };
+    static const TransferStats& getTransferStats();
+    
+    // Callbacks implementados externamente no bike_pairing.cpp (loop principal, via poll)
     static void onBikeConnected(const String& bikeId);
     static void onBikeDisconnected(const String& bikeId);
-    static void onBikeDataReceived(const String& bikeId, const String& jsonData);
-    static void onConfigRequest(const String& bikeId, const String& request);
+    // data/request: mensagem WireFormat ou JSON (bike antiga), como chegou
+    static void onBikeDataReceived(const String& bikeId, const uint8_t* data, size_t length);
+    static void onConfigRequest(const String& bikeId, const uint8_t* request, size_t length);
     
     // Static members - public para acesso das callbacks
     static NimBLEServer* pServer;
-    static NimBLEService* pService;
-    static NimBLECharacteristic* pDataChar;
-    static NimBLECharacteristic* pConfigChar;
+    // Handles de valor das características (0 com o servidor parado); o serviço
+    // é registrado direto no host NimBLE, ver registerService() em ble_server.cpp
+    static uint16_t dataValueHandle;
+    static uint16_t configValueHandle;
     static uint8_t connectedBikes;
     static std::map<uint16_t, String> connectedDevices;
 };
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Transferência em blocos na característica de dados (bike -> central).
+// Um payload maior que o MTU vira um START seguido de DATAs sequenciados; a
+// central remonta por conexão, confere o CRC32 e responde com ACKs
+// (notificação só para a conexão) a cada janela de blocos.
+// Compartilhado com firmware/bici (build_src_filter); sem dependências de
+// Arduino para poder ser compilado no host (bench/).
+//
+// Frame: [magic:1][type:1][transfer_id:2] + corpo (little-endian)
+//   START  [total:4][crc32:4][id_len:1][bike_id]   -> ACK com offset de retomada
+//   DATA   [offset:4][bytes]
+//   ACK    [offset:4][status:1]                    (central -> bike)
+// transfer_id deriva do conteúdo (CRC), então reenviar o mesmo payload
+// após uma reconexão retoma de onde a central parou.
+// Write que não começa com FRAME_MAGIC é um registro JSON inteiro (legado).
+namespace BleTransfer {
+
+    const uint8_t FRAME_MAGIC = 0xB7;   // nunca é o primeiro byte de um JSON
+
+    const uint8_t FRAME_START = 1;
+    const uint8_t FRAME_DATA = 2;
+    const uint8_t FRAME_ACK = 3;
+
+    const uint8_t ACK_CONTINUE = 0;    // offset = bytes contíguos recebidos; enviar daí
+    const uint8_t ACK_DONE = 1;        // payload completo e CRC conferido
+    const uint8_t ACK_RESTART = 2;     // CRC não bateu: reenviar do zero
+    const uint8_t ACK_REJECT = 3;      // grande demais / sem memória / sem slot
+
+    const size_t HEADER_SIZE = 4;
+    const size_t DATA_HEADER_SIZE = HEADER_SIZE + 4;
+    const size_t ACK_SIZE = HEADER_SIZE + 5;
+    const size_t MAX_BIKE_ID = 32;
+    const size_t MAX_START_SIZE = HEADER_SIZE + 9 + MAX_BIKE_ID;
+
+    const size_t MAX_TRANSFER = 16384;   // maior payload remontado
+    const uint8_t WINDOW_CHUNKS = 8;     // blocos entre ACKs (< fila BLE da central)
+    const uint16_t ATT_OVERHEAD = 3;     // opcode + handle do ATT write/notify
+    const uint16_t MTU_DEFAULT = 23;
+    const uint16_t MTU_MAX = 517;
+
+    struct Frame {
+        uint8_t type;
+        uint16_t transferId;
+        uint32_t offset;          // DATA / ACK
+        uint32_t total;           // START
+        uint32_t crc;             // START
+        uint8_t status;           // ACK
+        const char* bikeId;       // START (sem terminador)
+        uint8_t bikeIdLen;
+        const uint8_t* data;      // DATA
+        size_t length;
+    };
+
+    inline bool isFrame(const uint8_t* in, size_t length) {
+        return length >= HEADER_SIZE && in[0] == FRAME_MAGIC;
+    }
+
+    // Bytes de payload por DATA para um MTU negociado
+    inline size_t chunkSize(uint16_t mtu) {
+        if (mtu < MTU_DEFAULT) mtu = MTU_DEFAULT;
+        if (mtu > MTU_MAX) mtu = MTU_MAX;
+        return mtu - ATT_OVERHEAD - DATA_HEADER_SIZE;
+    }
+
+    // transfer_id de um payload (mesmo conteúdo -> mesmo id)
+    inline uint16_t transferIdOf(uint32_t crc, uint32_t total) {
+        uint16_t id = (uint16_t)(crc ^ (crc >> 16) ^ total);
+        return id ? id : 1;
+    }
+
+    // Retornam o tamanho do frame, ou 0 se não couber em `capacity`
+    size_t encodeStart(uint8_t* out, size_t capacity, uint16_t transferId, uint32_t total, uint32_t crc,
+                       const char* bikeId, size_t bikeIdLen);
+    size_t encodeData(uint8_t* out, size_t capacity, uint16_t transferId, uint32_t offset,
+                      const uint8_t* data, size_t length);
+    size_t encodeAck(uint8_t* out, size_t capacity, uint16_t transferId, uint32_t offset, uint8_t status);
+
+    // false se o frame estiver truncado ou o tipo for desconhecido
+    bool decode(const uint8_t* in, size_t length, Frame& frame);
+
+    // Remontagem de um payload (lado da central). O buffer é alocado no START
+    // e sobrevive a uma desconexão para permitir retomada
+    class Reassembler {
+    public:
+        struct Result {
+            uint8_t status;   // ACK_*
+            uint32_t offset;
+            bool ack;         // responder agora (início, fim de janela, lacuna ou fim)
+        };
+
+        Reassembler();
+        ~Reassembler();
+
+        // Mesmo bike/id/total/crc de uma remontagem em andamento = retomada
+        Result start(const Frame& frame, bool& resumed);
+        Result data(const Frame& frame);
+        void release();
+
+        bool active() const { return buffer != nullptr; }
+        bool complete() const { return buffer && received == total; }
+        uint16_t transferId() const { return id; }
+        uint32_t size() const { return total; }
+        uint32_t receivedBytes() const { return received; }
+        const uint8_t* payload() const { return buffer; }
+
+    private:
+        uint8_t* buffer;
+        uint32_t total;
+        uint32_t received;
+        uint32_t crc;
+        uint16_t id;
+        uint8_t chunksSinceAck;
+        char bikeId[MAX_BIKE_ID];
+        uint8_t bikeIdLen;
+
+        Reassembler(const Reassembler&);
+        Reassembler& operator=(const Reassembler&);
+    };
+}
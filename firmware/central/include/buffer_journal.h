@@ -0,0 +1,67 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Formato binário do journal do BufferManager (append-only).
+// Sem dependências de Arduino para poder ser compilado no host (bench/).
+//
+// Registro: [magic:1][type:1][len:2][crc32:4][payload:len]  (little-endian)
+//   DATA_SEQ  payload: [seq:4][ts:4][item_crc:4][flags:1][id_len:1][bike_id][data]
+//   TRIM      payload: [through:4][acked:4] -> descarta registros com seq <= through
+//                      e avança o high-water mark de confirmação para `acked`
+// Legado (só leitura):
+//   DATA      payload: [ts:4][item_crc:4][flags:1][id_len:1][bike_id][data]  (seq = 0)
+//   TOMBSTONE payload: [count:2]  -> descarta os `count` registros mais antigos
+namespace BufferJournal {
+
+    const uint8_t RECORD_MAGIC = 0xB5;
+    const uint8_t RECORD_DATA = 1;
+    const uint8_t RECORD_TOMBSTONE = 2;
+    const uint8_t RECORD_DATA_SEQ = 3;
+    const uint8_t RECORD_TRIM = 4;
+
+    const size_t HEADER_SIZE = 8;
+    const size_t SEQ_SIZE = 4;
+    const size_t DATA_FIXED_SIZE = 10;
+    const size_t MAX_BIKE_ID = 32;
+    const size_t MAX_PAYLOAD = SEQ_SIZE + DATA_FIXED_SIZE + MAX_BIKE_ID + 256;
+    const size_t TRIM_SIZE = 8;
+    const size_t MAX_RECORD = HEADER_SIZE + MAX_PAYLOAD;
+
+    const uint8_t FLAG_COMPRESSED = 0x01;
+    const uint8_t FLAG_WIRE = 0x02;        // dados em WireFormat (JSON só no upload)
+    const uint8_t FLAG_MASK = FLAG_COMPRESSED | FLAG_WIRE;
+
+    struct RecordHeader {
+        uint8_t type;
+        uint16_t length;
+        uint32_t crc;
+    };
+
+    struct DataRecord {
+        uint32_t seq;
+        uint32_t timestamp;
+        uint32_t itemCrc;
+        uint8_t flags;
+        const char* bikeId;
+        uint8_t bikeIdLen;
+        const uint8_t* data;
+        uint16_t size;
+    };
+
+    // Escreve o cabeçalho em `out` (HEADER_SIZE bytes)
+    void writeHeader(uint8_t* out, uint8_t type, uint16_t length, uint32_t crc);
+
+    // Valida magic/tipo/tamanho; false indica cauda corrompida ou truncada
+    bool parseHeader(const uint8_t* in, RecordHeader& header);
+
+    // Serializa o payload DATA_SEQ em `out`; retorna o tamanho ou 0 se não couber
+    size_t encodeData(uint8_t* out, size_t capacity, const DataRecord& record);
+    // Aceita DATA_SEQ e DATA legado (`type` do cabeçalho)
+    bool decodeData(uint8_t type, const uint8_t* payload, size_t length, DataRecord& record);
+
+    size_t encodeTrim(uint8_t* out, uint32_t through, uint32_t acked);
+    bool decodeTrim(const uint8_t* payload, size_t length, uint32_t& through, uint32_t& acked);
+
+    bool decodeTombstone(const uint8_t* payload, size_t length, uint16_t& count);
+}
@@ -1,16 +1,22 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <FS.h>
 
-struct DataItem {
-    String bikeId;
+#include "constants.h"
+#include "buffer_journal.h"
+#include "backup_manifest.h"
+#include "base64_codec.h"
+
+// Cabeçalho de cada registro no arena; os dados vêm logo em seguida, sem padding.
+// O arena não é alinhado: ler/escrever sempre via memcpy (readRecord/writeRecord).
+struct __attribute__((packed)) RecordHeader {
+    uint32_t seq;                  // monotônico; nunca reutilizado (ver ackedSeq)
     uint32_t timestamp;
-    size_t size;
-    uint8_t data[256];
     uint32_t crc32;
-    bool uploaded;
-    bool confirmed;
-    bool compressed;
+    uint16_t size;
+    uint8_t flags;                 // RECORD_COMPRESSED / RECORD_WIRE
+    char bikeId[BIKE_ID_LENGTH];   // sem '\0'; IDs menores completados com zeros
 };
 
 class BufferManager {
@@ -21,27 +27,123 @@ public:
     // Dados coletados
     bool addData(const String& bikeId, const uint8_t* data, size_t length);
     bool addBikeData(const String& bikeId, const String& jsonData);
+    // Mensagem binária da bike (WireFormat): guardada como chegou, sem parse;
+    // lotes maiores que MAX_ITEM_SIZE viram vários itens. JSON só no upload
+    bool addBikeMessage(const String& bikeId, const uint8_t* data, size_t length);
     bool needsSync();
     bool isCriticallyFull();
-    bool getDataForUpload(DynamicJsonDocument& doc);
+    
+    // Upload em streaming: o corpo é escrito item a item, sem documento intermediário.
+    // Cada chamada prepara uma janela de até limits.batch_size registros após o
+    // high-water mark; markAsConfirmed libera só essa janela.
+    int beginUpload();
+    void writeUploadHeader(Print& out);
+    void writeUploadItem(int index, Print& out);
+    void writeUploadFooter(Print& out);
     void markAsConfirmed();
     void rollbackUpload();
+
+    // Compacta um backup retido (.jnl/.json -> .bpa); chamado depois da sync
+    void archiveBackups();
     
     // Status
     int getDataCount();
     int getPendingCount();
+    int getSpillSegmentCount() const { return spillTail - spillHead; }
     void printStorageInfo();
     bool hasEnoughSpace();
 
+    static const size_t MAX_ITEM_SIZE = 256;
+    static const uint8_t RECORD_COMPRESSED = 0x01; // mesmo bit de BufferJournal::FLAG_COMPRESSED
+    static const uint8_t RECORD_WIRE = 0x02;       // mesmo bit de BufferJournal::FLAG_WIRE
+    // JSON de um item binário no upload (o maior lote de scans que cabe em MAX_ITEM_SIZE)
+    static const size_t WIRE_JSON_MAX = 2048;
+    // Maior item que writeUploadItem pode gerar: JSON em base64 + metadados (seq, bike_id, ts, ...)
+    static const size_t UPLOAD_ITEM_MAX = Base64Codec::encodedLength(WIRE_JSON_MAX) + 160 + 2 * BIKE_ID_LENGTH;
+
 private:
-    DataItem buffer[50]; // Tamanho máximo, controlado por config
+    // Tier quente: arena de bytes com registros [RecordHeader][data] em ordem de chegada
+    uint8_t* arena;
+    size_t arenaCapacity;
+    size_t arenaUsed;
     uint16_t dataCount;
     uint32_t lastSync;
+    uint16_t uploadCount;
+    uint32_t uploadTimestamp;
+    uint32_t uploadFirstSeq;
+    uint32_t uploadLastSeq;
+    bool uploadInFlight;
+    bool uploadSegmentDone;  // janela chegou ao fim do segmento de spill
+
+    // Sequência: nextSeq para o próximo registro, ackedSeq = maior seq confirmado pelo servidor
+    uint32_t nextSeq;
+    uint32_t ackedSeq;
+    void noteSeq(uint32_t seq);
+    int cursorIndex;      // último item visitado por writeUploadItem (acesso sequencial O(1))
+    size_t cursorOffset;
+
+    // Tier frio: segmentos imutáveis /spill_<id>.seg (mesmo formato de registro do journal).
+    // Quando o arena enche ele vira um segmento inteiro; upload drena o mais antigo primeiro.
+    uint32_t spillHead;   // id do segmento mais antigo
+    uint32_t spillTail;   // próximo id livre
+    uint32_t spillRecords;
+    size_t spillBytes;
+    bool uploadFromSpill;
+    fs::File uploadFile;
+
+    void scanSpillSegments();
+    bool spillHotTier();
+    void releaseSpillSegment(bool keepBackup);
+    size_t spillCapacity();
+    static void spillPath(uint32_t id, char* out);
+    static uint16_t countSegmentRecords(fs::File& file, uint32_t afterSeq,
+                                        uint32_t* minSeq = nullptr, uint32_t* maxSeq = nullptr);
+    static bool readSegmentRecord(fs::File& file, BufferJournal::DataRecord& record, uint8_t* payload);
+    bool nextWindowRecord(BufferJournal::DataRecord& record, uint8_t* payload);
+    void writeUploadRecord(int index, const BufferJournal::DataRecord& record, Print& out);
+
+    void allocateArena();
+    bool appendItem(const String& bikeId, const uint8_t* data, size_t size, uint8_t flags, size_t originalSize);
+    static bool appendWirePiece(const uint8_t* piece, size_t length, void* context);
+    bool storeRecord(uint32_t seq, const char* bikeId, size_t bikeIdLen, uint32_t timestamp, uint32_t crc,
+                     uint8_t flags, const uint8_t* data, size_t size);
+    void readRecord(size_t offset, RecordHeader& header) const;
+    size_t recordSize(size_t offset) const;
+    size_t offsetOf(int index);
+    static size_t copyBikeId(const RecordHeader& header, char* out);
+    
+    // Journal binário (append-only)
+    bool journalMode;
+    size_t journalSize;
+    uint32_t journalFirstSeq;   // faixa de seq gravada no segmento atual (vai para o backup na rotação)
+    uint32_t journalLastSeq;
+    void noteJournalSeq(uint32_t seq);
+    size_t encodeJournalItem(size_t offset, uint8_t* payload);
+    size_t writeJournalRecord(fs::File& file, uint8_t type, const uint8_t* payload, size_t length);
+    bool appendJournalData(size_t offset);
+    bool appendJournalTrim(uint32_t through);
+    bool appendJournalRecord(uint8_t type, const uint8_t* payload, size_t length);
+    bool replayJournal();
+    void compactJournal();
+    void dropOldest(uint16_t count);
+    void releaseThrough(uint32_t seq);
     
     // Persistência
     void loadBuffer();
+    void loadJsonBuffer();
     void saveBuffer();
     void createBackup();
     void cleanupOldBackups();
+
+    // Backups: índice em /backup.idx, mais antigo primeiro
+    BackupManifest::Entry backups[BackupManifest::MAX_ENTRIES];
+    uint8_t backupCount;
+    uint32_t nextBackupId;
+    void loadManifest();
+    void saveManifest();
+    void importLegacyBackups();
+    bool registerBackup(const char* source, uint8_t kind, uint32_t firstSeq, uint32_t lastSeq);
+    void removeBackup(uint8_t index);
+    bool archiveBackup(uint8_t index);
     void printFileSize(const String& filePath);
 };
\ No newline at end of file
@@ -22,6 +22,7 @@ private:
     static bool downloadCentralConfig();
     static bool downloadBikeData();
     static bool uploadBufferData();
+    static bool uploadBufferWindow(int count);
     static bool uploadHeartbeat();
     static bool uploadWiFiConfig();
     static bool uploadBikeData();
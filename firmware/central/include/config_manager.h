@@ -55,10 +55,12 @@ struct FallbackConfig {
 };
 
 struct BufferConfig {
-    uint8_t max_size;
+    uint8_t max_size;       // segmentos de spill em flash (tier frio)
     uint8_t sync_threshold_percent;
     uint8_t auto_save_interval;
     uint16_t max_item_size;
+    bool journal_enabled;
+    uint16_t arena_kb;      // RAM do buffer em KB (limitada pelo heap livre no boot)
 };
 
 struct CompressionConfig {
@@ -77,6 +79,10 @@ struct BackupConfig {
     uint16_t retention_hours;
 };
 
+struct CompatConfig {
+    bool human_timestamps;  // migração: ainda envia os campos *_human no upload
+};
+
 struct CentralConfig {
     char base_id[32];
     LocationConfig location;
@@ -91,6 +97,7 @@ struct CentralConfig {
     CompressionConfig compression;
     StorageConfig storage;
     BackupConfig backup;
+    CompatConfig compat;
     
     // Compatibility methods
     uint32_t sync_interval_ms() const { return intervals.sync_sec * 1000; }
@@ -124,6 +131,8 @@ public:
     int getBufferSyncThreshold() const { return config.buffer.sync_threshold_percent; }
     int getAutoSaveInterval() const { return config.buffer.auto_save_interval; }
     int getMaxItemSize() const { return config.buffer.max_item_size; }
+    bool getJournalEnabled() const { return config.buffer.journal_enabled; }
+    int getBufferArenaKb() const { return config.buffer.arena_kb; }
     
     // Compression configuration
     bool getCompressionEnabled() const { return config.compression.enabled; }
@@ -138,6 +147,9 @@ public:
     bool getBackupEnabled() const { return config.backup.enabled; }
     int getBackupRetentionHours() const { return config.backup.retention_hours; }
     
+    // Compatibility configuration
+    bool getHumanTimestamps() const { return config.compat.human_timestamps; }
+    
     // Convenience methods
     String getBaseId() const { return String(config.base_id); }
     int getSyncInterval() const { return config.intervals.sync_sec; }
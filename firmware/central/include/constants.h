@@ -6,15 +6,26 @@
 // Files
 #define CONFIG_FILE "/config.json"
 #define BUFFER_FILE "/buffer.json"
+#define BUFFER_JOURNAL_FILE "/buffer.jnl"
+#define BUFFER_JOURNAL_TMP_FILE "/buffer.jnl.tmp"
+#define BACKUP_MANIFEST_FILE "/backup.idx"
+#define BACKUP_MANIFEST_TMP_FILE "/backup.idx.tmp"
 #define BIKE_REGISTRY_FILE "/bike_registry.json"
 #define BIKE_DATA_FILE "/bike_data.json"
+#define BIKE_DATA_BIN_FILE "/bike_data.bin"          // legado: migrado para os shards
+#define CONFIG_DELIVERED_FILE "/config_delivered.bin" // legado: versão entregue vai no registro
+#define BIKE_SHARD_DIR "/bikes"                       // sXX.bin por hash do ID
+#define BIKE_INDEX_FILE "/bikes/index.bin"
+#define BIKE_INDEX_TMP_FILE "/bikes/index.tmp"
 #define BIKE_CONFIG_CACHE_FILE "/bike_config_versions.json"
 #define BIKE_CONFIGS_FILE "/bike_configs.json"
+#define CONFIG_FETCH_BATCH 8                         // bikes desatualizadas por passada no índice de versões
 
 // Timing constants (ms)
 #define WIFI_TIMEOUT_DEFAULT 30000
 #define SYNC_INTERVAL_DEFAULT 300000
 #define HEARTBEAT_INTERVAL 60000
+#define BIKE_DATA_FLUSH_DELAY_MS 30000  // write-behind do registro de bikes
 
 // LED timing
 #define LED_BOOT_INTERVAL 100
@@ -25,14 +36,31 @@
 #define LED_COUNT_PAUSE 2000
 
 // Buffer limits
-#define MAX_BUFFER_SIZE 8000
+#define MAX_BUFFER_SIZE 8000        // registros no tier quente (RAM)
 #define MAX_BIKES 10
+#define JOURNAL_SEGMENT_SIZE 32768  // compacta o journal ao passar disso
+#define BIKE_ID_LENGTH 10           // "bpr-xxxxxx"
+#ifdef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define MAX_BIKE_SESSIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS  // uma sessão de ingestão por conexão BLE
+#else
+#define MAX_BIKE_SESSIONS 3
+#endif
+#define BIKE_SESSION_TIMEOUT_MS 30000  // sessão órfã (desconexão perdida)
+#define BIKE_SESSION_PAYLOAD_MAX 4096  // registros pendentes por sessão antes de drenar na hora
+#define UPLOAD_WINDOW_DEFAULT 64     // registros por PATCH (limits.batch_size)
+#define MAX_UPLOAD_WINDOWS_PER_SYNC 16
+#define MAX_BIKE_DELTA_BATCHES 8     // PATCHes de bikes por sync
+#define BUFFER_ARENA_KB_DEFAULT 8   // tier quente; excedente vai para segmentos em flash
 
 // BLE Configuration
 #define BLE_DEVICE_NAME "BPR Central Station"
 #define BLE_SERVICE_UUID "12345678-1234-1234-1234-123456789abc"
 #define BLE_CHAR_DATA_UUID "87654321-4321-4321-4321-cba987654321"
 #define BLE_CHAR_CONFIG_UUID "11111111-2222-3333-4444-555555555555"
+#define BLE_DLE_TX_OCTETS 251          // data length extension (PDU máximo do BLE 4.2+)
+#define BLE_DLE_TX_TIME 2120
+#define TRANSFER_RESUME_MS 120000      // transferência parcial aguardando a bike reconectar
+#define OUTBOUND_MTU_WAIT_MS 5000      // notificação maior que o MTU aguarda a troca de MTU da bike
 
 // Config AP
 #define AP_SSID "BPR_Central_Config"
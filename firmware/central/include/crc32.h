@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-32 (IEEE 802.3, o mesmo do zlib) usado pelo buffer, journal, backups e BLE.
+// No ESP32 usa a rotina da ROM (esp_rom_crc32_le); no host, slicing-by-8.
+// Os dois caminhos geram valores idênticos aos da antiga lib CRC32, então
+// registros já gravados continuam válidos.
+namespace Crc32 {
+
+    // Nome do motor ativo, para logs e para o bench
+    extern const char* const ENGINE;
+
+    // Continua um CRC em andamento (comece com 0), como crc32() do zlib
+    uint32_t update(uint32_t crc, const void* data, size_t length);
+
+    inline uint32_t compute(const void* data, size_t length) {
+        return update(0, data, length);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Compressor LZ77 pequeno para os payloads JSON das bikes.
+// A janela começa com um dicionário estático (chaves que aparecem em todo
+// registro), então até o primeiro registro de um buffer já comprime bem.
+//
+// Formato: [versão:1] seguido de tokens
+//   0LLLLLLL                -> L+1 literais em seguida (1..128)
+//   1LLLLLOO OOOOOOOO       -> cópia de L+3 bytes (3..34) a O+1 bytes atrás (1..1024)
+// A distância pode apontar para dentro do dicionário.
+//
+// Espelhado em shared/utils/payloadCompressor.js - mudar o dicionário exige
+// incrementar FORMAT_VERSION nos dois lados.
+namespace PayloadCompressor {
+
+    const uint8_t FORMAT_VERSION = 1;
+
+    // Retorna o tamanho comprimido, ou 0 se não couber em `capacity`
+    // ou não ficar menor que a entrada
+    size_t compress(const uint8_t* input, size_t length, uint8_t* output, size_t capacity);
+
+    // Retorna o tamanho descomprimido, ou 0 se o stream for inválido
+    size_t decompress(const uint8_t* input, size_t length, uint8_t* output, size_t capacity);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Formato legível dos timestamps (epoch em segundos).
+// O firmware guarda e transmite só epoch; a forma legível é montada aqui,
+// na borda: página de status do ConfigAP, logs e o modo de compatibilidade
+// (compat.human_timestamps) que ainda envia os campos *_human.
+namespace TimeFormat {
+
+    const size_t HUMAN_SIZE = 32;  // "2024-12-06 10:30:00 UTC-3" + folga
+
+    // Escreve "%Y-%m-%d %H:%M:%S UTC-3" em `out`; retorna o tamanho (0 se não couber)
+    size_t human(uint32_t epoch, char* out, size_t size);
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <Arduino.h>
+
+// Print que só conta bytes (passada de tamanho do upload)
+class CountingPrint : public Print
+{
+public:
+    size_t count = 0;
+    size_t write(uint8_t) override { count++; return 1; }
+    size_t write(const uint8_t *buffer, size_t size) override { count += size; return size; }
+};
+
+// Print sobre um buffer fixo; o que não coube fica marcado em overflowed()
+class FixedPrint : public Print
+{
+public:
+    FixedPrint(uint8_t *buffer, size_t capacity) : buf(buffer), cap(capacity), len(0), overflow(false) {}
+    size_t write(uint8_t c) override
+    {
+        if (len >= cap) {
+            overflow = true;
+            return 0;
+        }
+        buf[len++] = c;
+        return 1;
+    }
+    size_t length() const { return len; }
+    bool overflowed() const { return overflow; }
+
+private:
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+};
+
+// Corpo do upload gerado sob demanda: cabeçalho, um item por vez e rodapé são
+// renderizados num buffer fixo conforme o HTTPClient lê, então o pico de memória
+// não depende de quantos registros estão no buffer.
+// Source = BufferManager (writeUploadHeader/Item/Footer + UPLOAD_ITEM_MAX); template
+// só para o bench de host (bench/upload_stream_bench.cpp) rodar sem LittleFS.
+template <class Source>
+class UploadStream : public Stream
+{
+public:
+    UploadStream(Source &source, int count)
+        : buffer(source), itemCount(count), part(0), stageLen(0), stagePos(0), sent(0), failed(false)
+    {
+        // Stage no heap: item binário vira JSON em base64 (~3 KB), grande demais para a stack do loop
+        stage = (uint8_t *)malloc(STAGE_SIZE);
+        if (!stage) {
+            Serial.println("❌ No memory for upload stage");
+            failed = true;
+            total = 0;
+            return;
+        }
+
+        // Passada de contagem; uma parte maior que o stage sairia truncada
+        // e o corpo ficaria menor que o Content-Length: aborta antes de enviar
+        CountingPrint counter;
+        buffer.writeUploadHeader(counter);
+        for (int i = 0; i < itemCount; i++) {
+            size_t before = counter.count;
+            buffer.writeUploadItem(i, counter);
+            if (counter.count - before > STAGE_SIZE) {
+                Serial.printf("❌ Upload item %d too large for stage (%d > %d bytes)\n",
+                              i, (int)(counter.count - before), (int)STAGE_SIZE);
+                failed = true;
+            }
+        }
+        buffer.writeUploadFooter(counter);
+        total = counter.count;
+    }
+
+    ~UploadStream() { free(stage); }
+
+    size_t size() const { return total; }
+    // Alguma parte não coube no stage: corpo incompleto, o upload não vale
+    bool hasFailed() const { return failed; }
+
+    int available() override { return total - sent; }
+
+    int read() override
+    {
+        uint8_t c;
+        return readBytes((char *)&c, 1) == 1 ? c : -1;
+    }
+
+    int peek() override
+    {
+        if (!fill()) return -1;
+        return stage[stagePos];
+    }
+
+    size_t readBytes(char *out, size_t length) override
+    {
+        size_t copied = 0;
+        while (copied < length && fill()) {
+            size_t chunk = min(length - copied, stageLen - stagePos);
+            memcpy(out + copied, stage + stagePos, chunk);
+            stagePos += chunk;
+            copied += chunk;
+        }
+        sent += copied;
+        return copied;
+    }
+
+    size_t write(uint8_t) override { return 0; }
+
+    static const size_t STAGE_SIZE = Source::UPLOAD_ITEM_MAX; // maior parte possível
+
+private:
+    Source &buffer;
+    int itemCount;
+    int part;
+    uint8_t *stage;
+    size_t stageLen;
+    size_t stagePos;
+    size_t total;
+    size_t sent;
+    bool failed;
+
+    bool fill()
+    {
+        if (stagePos < stageLen) return true;
+        if (failed || part > itemCount + 1) return false;
+
+        // stage é ponteiro: a capacidade é STAGE_SIZE, nunca sizeof(stage)
+        FixedPrint out(stage, STAGE_SIZE);
+        if (part == 0) buffer.writeUploadHeader(out);
+        else if (part <= itemCount) buffer.writeUploadItem(part - 1, out);
+        else buffer.writeUploadFooter(out);
+        part++;
+
+        if (out.overflowed()) {
+            Serial.printf("❌ Upload part %d overflowed stage - aborting\n", part - 1);
+            failed = true;
+            stageLen = 0;
+            return false;
+        }
+        stageLen = out.length();
+        stagePos = 0;
+        return stageLen > 0;
+    }
+};
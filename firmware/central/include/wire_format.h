@@ -0,0 +1,164 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Formato binário das mensagens bike <-> central (BLE). Substitui o JSON no
+// ar; JSON só é montado na borda do Firebase (toJson, no upload).
+// Compartilhado com firmware/bici (build_src_filter); sem Arduino, roda no host.
+//
+// Mensagem: [magic:1][version:1][type:1] + campos TLV [tag:1][len:1][valor]
+// Inteiros little-endian. Tag desconhecida é pulada pelo leitor, então
+// campos novos entram sem quebrar quem lê a versão anterior; mudança
+// incompatível troca o MAGIC. Um write que começa com MAGIC não é JSON
+// nem frame de transferência (BleTransfer::FRAME_MAGIC).
+//
+// Os campos de cada tipo (tag, tipo e chave JSON) vivem numa única tabela
+// (fieldsOf), usada por encoder, decoder, split e toJson.
+namespace WireFormat {
+
+    const uint8_t MAGIC = 0xB9;
+    const uint8_t VERSION = 1;
+    const size_t HEADER_SIZE = 3;
+    const size_t FIELD_HEADER_SIZE = 2;
+    const size_t MAX_FIELD = 255;
+
+    enum MessageType : uint8_t {
+        MSG_STATUS = 1,            // bike -> central (data)
+        MSG_WIFI_SCANS = 2,        // bike -> central (data)
+        MSG_CONFIG_REQUEST = 3,    // bike -> central (config)
+        MSG_CONFIG_RECEIVED = 4,   // bike -> central (config)
+        MSG_DATA_REQUEST = 5,      // central -> bike (notificação)
+        MSG_CONFIG_PUSH = 6        // central -> bike (notificação)
+    };
+
+    enum Tag : uint8_t {
+        TAG_BIKE_ID = 1,
+        TAG_TIMESTAMP = 2,
+        TAG_BATTERY_MV = 3,
+        TAG_BATTERY_PCT = 4,
+        TAG_RECORDS = 5,
+        TAG_HEAP = 6,
+        TAG_SCAN = 7,              // repetido: [ts:4][bssid:6][rssi:1]
+        TAG_STATUS = 8,            // STATUS_OK / STATUS_ERROR
+        TAG_VERSION = 9,
+        TAG_BIKE_NAME = 10,
+        TAG_DEV_MODE = 11,
+        TAG_SCAN_INTERVAL_SEC = 12,
+        TAG_SCAN_TIMEOUT_MS = 13,
+        TAG_BASE_NAME = 14,
+        TAG_BLE_SCAN_SEC = 15,
+        TAG_DEEP_SLEEP_SEC = 16,
+        TAG_CRITICAL_MV = 17,
+        TAG_LOW_MV = 18,
+        TAG_ERROR = 19
+    };
+
+    enum Kind : uint8_t {
+        KIND_U8,
+        KIND_U16,
+        KIND_U32,
+        KIND_STRING,
+        KIND_MILLIVOLTS,           // u16 no ar, volts no JSON
+        KIND_BOOL,
+        KIND_SCAN                  // repetível; vira array "scans" no JSON
+    };
+
+    const uint8_t STATUS_OK = 0;
+    const uint8_t STATUS_ERROR = 1;
+
+    const size_t SCAN_SIZE = 11;
+
+    struct Scan {
+        uint32_t timestamp;
+        uint8_t bssid[6];
+        int8_t rssi;
+    };
+
+    struct Field {
+        uint8_t tag;
+        uint8_t kind;
+        const char* key;           // chave JSON; "a.b" = objeto aninhado (config)
+    };
+
+    // Tabela de campos do tipo (nullptr/0 se o tipo não existe)
+    const Field* fieldsOf(uint8_t type, size_t& count);
+    const Field* fieldOf(uint8_t type, uint8_t tag);
+    const char* typeName(uint8_t type);
+
+    inline bool isMessage(const uint8_t* in, size_t length) {
+        return length >= HEADER_SIZE && in[0] == MAGIC;
+    }
+
+    // Monta uma mensagem direto no buffer do chamador, sem alocação.
+    // Estourou a capacidade: length() passa a devolver 0
+    class Writer {
+    public:
+        Writer(uint8_t* out, size_t capacity, uint8_t type);
+
+        void putU8(uint8_t tag, uint8_t value);
+        void putU16(uint8_t tag, uint16_t value);
+        void putU32(uint8_t tag, uint32_t value);
+        void putString(uint8_t tag, const char* value, size_t length);
+        void putString(uint8_t tag, const char* value);
+        void putScan(const Scan& scan);
+        void putRaw(uint8_t tag, const uint8_t* value, size_t length);
+
+        size_t length() const { return overflow ? 0 : used; }
+
+    private:
+        uint8_t* out;
+        size_t capacity;
+        size_t used;
+        bool overflow;
+
+        uint8_t* reserve(uint8_t tag, size_t length);
+    };
+
+    // Percorre os campos de uma mensagem sem copiar (valores apontam para `in`)
+    class Reader {
+    public:
+        Reader(const uint8_t* in, size_t length);
+
+        bool valid() const { return ok; }
+        uint8_t type() const { return messageType; }
+        uint8_t version() const { return messageVersion; }
+
+        // Próximo campo; false no fim ou se o campo estiver truncado (error())
+        bool next();
+        bool error() const { return truncated; }
+        void rewind();
+
+        uint8_t tag() const { return fieldTag; }
+        uint8_t size() const { return fieldSize; }
+        const uint8_t* value() const { return fieldValue; }
+        uint32_t asUint() const;
+        bool asScan(Scan& scan) const;
+
+    private:
+        const uint8_t* in;
+        size_t length;
+        size_t cursor;
+        bool ok;
+        bool truncated;
+        uint8_t messageType;
+        uint8_t messageVersion;
+        uint8_t fieldTag;
+        uint8_t fieldSize;
+        const uint8_t* fieldValue;
+    };
+
+    // Atalhos para um campo único (primeira ocorrência)
+    bool findString(const uint8_t* in, size_t length, uint8_t tag, const char*& value, size_t& valueLength);
+    bool findUint(const uint8_t* in, size_t length, uint8_t tag, uint32_t& value);
+
+    // Quebra uma mensagem em pedaços válidos de até `maxSize` bytes: campos
+    // únicos se repetem em todo pedaço, os repetidos (scans) se dividem.
+    // `sink` recebe cada pedaço (montado em `piece`); false se a mensagem é
+    // inválida, um pedaço não cabe ou o sink recusou
+    typedef bool (*PieceSink)(const uint8_t* piece, size_t length, void* context);
+    bool split(const uint8_t* in, size_t length, uint8_t* piece, size_t maxSize, PieceSink sink, void* context);
+
+    // Objeto JSON equivalente (borda do Firebase); `receivedAt` entra como
+    // central_receive_timestamp se != 0. Retorna o tamanho, 0 se não couber
+    size_t toJson(const uint8_t* in, size_t length, uint32_t receivedAt, char* out, size_t capacity);
+}
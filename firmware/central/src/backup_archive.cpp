@@ -0,0 +1,65 @@
+#include "backup_archive.h"
+#include "payload_compressor.h"
+#include <string.h>
+
+namespace BackupArchive {
+
+    static const uint8_t MAGIC[3] = { 'B', 'P', 'A' };
+
+    static void putU16(uint8_t* p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+    }
+
+    static uint16_t getU16(const uint8_t* p) {
+        return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+    }
+
+    void writeFileHeader(uint8_t* out) {
+        memcpy(out, MAGIC, sizeof(MAGIC));
+        out[3] = VERSION;
+    }
+
+    bool checkFileHeader(const uint8_t* in) {
+        return memcmp(in, MAGIC, sizeof(MAGIC)) == 0 && in[3] == VERSION;
+    }
+
+    size_t encodeBlock(const uint8_t* raw, size_t length, uint32_t crc, uint8_t* out) {
+        if (length == 0 || length > BLOCK_SIZE) return 0;
+
+        uint8_t* body = out + BLOCK_HEADER_SIZE;
+        size_t stored = PayloadCompressor::compress(raw, length, body, length - 1);
+        if (stored == 0) {
+            memcpy(body, raw, length);
+            stored = length;
+        }
+
+        putU16(out, length);
+        putU16(out + 2, stored);
+        out[4] = crc & 0xFF;
+        out[5] = (crc >> 8) & 0xFF;
+        out[6] = (crc >> 16) & 0xFF;
+        out[7] = (crc >> 24) & 0xFF;
+        return BLOCK_HEADER_SIZE + stored;
+    }
+
+    bool parseBlockHeader(const uint8_t* in, BlockHeader& header) {
+        header.rawLength = getU16(in);
+        header.storedLength = getU16(in + 2);
+        header.crc = (uint32_t)in[4] | ((uint32_t)in[5] << 8) |
+                     ((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 24);
+
+        return header.rawLength > 0 && header.rawLength <= BLOCK_SIZE &&
+               header.storedLength > 0 && header.storedLength <= header.rawLength;
+    }
+
+    size_t decodeBlock(const BlockHeader& header, const uint8_t* stored, uint8_t* raw) {
+        if (header.storedLength == header.rawLength) {
+            memcpy(raw, stored, header.rawLength);
+            return header.rawLength;
+        }
+
+        size_t length = PayloadCompressor::decompress(stored, header.storedLength, raw, BLOCK_SIZE);
+        return length == header.rawLength ? length : 0;
+    }
+}
@@ -0,0 +1,66 @@
+#include "backup_manifest.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace BackupManifest {
+
+    static const uint8_t MAGIC[3] = { 'B', 'I', 'X' };
+
+    static void putU32(uint8_t* p, uint32_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = (v >> 24) & 0xFF;
+    }
+
+    static uint32_t getU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+               ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    size_t encode(const Entry* entries, size_t count, uint8_t* out) {
+        if (count > MAX_ENTRIES) count = MAX_ENTRIES;
+
+        memcpy(out, MAGIC, sizeof(MAGIC));
+        out[3] = VERSION;
+        out[4] = count & 0xFF;
+        out[5] = (count >> 8) & 0xFF;
+
+        uint8_t* p = out + HEADER_SIZE;
+        for (size_t i = 0; i < count; i++, p += ENTRY_SIZE) {
+            putU32(p, entries[i].id);
+            putU32(p + 4, entries[i].timestamp);
+            putU32(p + 8, entries[i].size);
+            putU32(p + 12, entries[i].firstSeq);
+            putU32(p + 16, entries[i].lastSeq);
+            p[20] = entries[i].kind;
+        }
+        return HEADER_SIZE + count * ENTRY_SIZE;
+    }
+
+    int decode(const uint8_t* in, size_t length, Entry* entries, size_t maxEntries) {
+        if (length < HEADER_SIZE || memcmp(in, MAGIC, sizeof(MAGIC)) != 0 || in[3] != VERSION) {
+            return -1;
+        }
+
+        size_t count = (size_t)in[4] | ((size_t)in[5] << 8);
+        if (count > maxEntries || length != HEADER_SIZE + count * ENTRY_SIZE) return -1;
+
+        const uint8_t* p = in + HEADER_SIZE;
+        for (size_t i = 0; i < count; i++, p += ENTRY_SIZE) {
+            entries[i].id = getU32(p);
+            entries[i].timestamp = getU32(p + 4);
+            entries[i].size = getU32(p + 8);
+            entries[i].firstSeq = getU32(p + 12);
+            entries[i].lastSeq = getU32(p + 16);
+            entries[i].kind = p[20];
+        }
+        return (int)count;
+    }
+
+    void path(const Entry& entry, char* out) {
+        const char* ext = (entry.kind & KIND_ARCHIVED) ? "bpa"
+                        : (entry.kind & KIND_JSON) ? "json" : "jnl";
+        sprintf(out, "/backup_%08lu.%s", (unsigned long)entry.id, ext);
+    }
+}
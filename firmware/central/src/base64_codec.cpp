@@ -0,0 +1,96 @@
+#include "base64_codec.h"
+
+namespace Base64Codec {
+
+    static const char ALPHABET[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // 0xFF = caractere inválido, 0xFE = padding
+    static const uint8_t INVALID = 0xFF;
+    static const uint8_t PAD = 0xFE;
+
+    static uint8_t decodeTable[256];
+    static bool tableReady = false;
+
+    static void buildTable() {
+        for (int i = 0; i < 256; i++) decodeTable[i] = INVALID;
+        for (int i = 0; i < 64; i++) decodeTable[(uint8_t)ALPHABET[i]] = i;
+        decodeTable['='] = PAD;
+        tableReady = true;
+    }
+
+    size_t encode(const uint8_t* input, size_t length, char* out) {
+        size_t o = 0;
+        size_t i = 0;
+
+        for (; i + 3 <= length; i += 3) {
+            uint32_t v = ((uint32_t)input[i] << 16) | ((uint32_t)input[i + 1] << 8) | input[i + 2];
+            out[o++] = ALPHABET[(v >> 18) & 0x3F];
+            out[o++] = ALPHABET[(v >> 12) & 0x3F];
+            out[o++] = ALPHABET[(v >> 6) & 0x3F];
+            out[o++] = ALPHABET[v & 0x3F];
+        }
+
+        if (i < length) {
+            uint32_t v = (uint32_t)input[i] << 16;
+            if (i + 1 < length) v |= (uint32_t)input[i + 1] << 8;
+
+            out[o++] = ALPHABET[(v >> 18) & 0x3F];
+            out[o++] = ALPHABET[(v >> 12) & 0x3F];
+            out[o++] = (i + 1 < length) ? ALPHABET[(v >> 6) & 0x3F] : '=';
+            out[o++] = '=';
+        }
+
+        return o;
+    }
+
+    size_t decode(const char* input, size_t length, uint8_t* out, size_t capacity) {
+        if (!tableReady) buildTable();
+        if (length % 4 != 0) return 0;
+
+        size_t o = 0;
+        for (size_t i = 0; i < length; i += 4) {
+            uint8_t a = decodeTable[(uint8_t)input[i]];
+            uint8_t b = decodeTable[(uint8_t)input[i + 1]];
+            uint8_t c = decodeTable[(uint8_t)input[i + 2]];
+            uint8_t d = decodeTable[(uint8_t)input[i + 3]];
+
+            if (a >= 64 || b >= 64 || c == INVALID || d == INVALID) return 0;
+
+            bool last = (i + 4 == length);
+            if ((c == PAD || d == PAD) && !last) return 0;
+            if (c == PAD && d != PAD) return 0;
+
+            size_t n = (c == PAD) ? 1 : (d == PAD) ? 2 : 3;
+            if (o + n > capacity) return 0;
+
+            // Lê os 4 caracteres antes de escrever: seguro para in-place (o <= i)
+            uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) |
+                         ((uint32_t)(c & 0x3F) << 6) | (d & 0x3F);
+            out[o++] = (v >> 16) & 0xFF;
+            if (n > 1) out[o++] = (v >> 8) & 0xFF;
+            if (n > 2) out[o++] = v & 0xFF;
+        }
+
+        return o;
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    size_t decodeHex(const char* input, size_t length, uint8_t* out, size_t capacity) {
+        if (length % 2 != 0 || length / 2 > capacity) return 0;
+
+        for (size_t i = 0; i < length; i += 2) {
+            int hi = hexValue(input[i]);
+            int lo = hexValue(input[i + 1]);
+            if (hi < 0 || lo < 0) return 0;
+            out[i / 2] = (uint8_t)((hi << 4) | lo);
+        }
+        return length / 2;
+    }
+}
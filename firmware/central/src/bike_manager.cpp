@@ -3,93 +3,737 @@
 #include <ArduinoJson.h>
 #include "constants.h"
 #include "config_manager.h"
+#include "bike_registry.h"
+#include "crc32.h"
+#include "time_format.h"
 #include <HTTPClient.h>
 
 extern ConfigManager configManager;
 
-// Dados unificados das bikes (registry + configs)
-static DynamicJsonDocument bikes(8192); // 8KB para registry + configs
-static DynamicJsonDocument configVersions(1024);
-static std::map<String, bool> configChanged;
+using BikeRegistry::Bike;
+
+// Directory residente com toda a frota + working set LRU de registros completos.
+// A config de cada bike fica como JSON cru no slot do cache (só atravessa a
+// borda Firebase/BLE); o log de eventos é um anel binário, JSON só no upload
+static BikeRegistry::Directory directory;
+static BikeRegistry::Cache cache;
+static BikeRegistry::RecentContacts recent;
+static String bikeConfigs[BikeRegistry::CACHE_SIZE];
+static BikeRegistry::ConfigLog configLogs[BikeRegistry::CACHE_SIZE];
 static bool dataLoaded = false;
 
-bool BikeManager::init() {
-    return loadData();
+static bool dirty = false;
+static uint32_t dirtySince = 0;
+static uint16_t dirtyShards = 0;   // bit por shard com registros alterados no cache
+static bool indexDirty = false;
+static BikeManager::WriteStats writeStats = {};
+
+// /bikes/sXX.bin: [magic "BKS":3][versão:1]
+//   por bike: [registro][config_len:2][config][ConfigLog]
+//   [crc32:4] de tudo que vem antes
+// Versão 1 (só leitura) guardava o log como blob JSON: [log_len:2][log]
+static const uint8_t SHARD_MAGIC[3] = { 'B', 'K', 'S' };
+static const uint8_t SHARD_VERSION = 2;
+static const uint8_t LEGACY_SHARD_VERSION = 1;
+static const uint8_t DATA_VERSION = 1;
+static const size_t SHARD_HEADER_SIZE = 4;
+
+// /bikes/index.bin: [magic "BKI":3][versão:1][count:2] + count x entrada + [crc32:4]
+static const uint8_t INDEX_MAGIC[3] = { 'B', 'K', 'I' };
+static const size_t DATA_HEADER_SIZE = 6;
+
+// Legado: /bike_data.bin ("BKR", registro de 31 bytes) e /config_delivered.bin ("BCV")
+static const uint8_t LEGACY_DATA_MAGIC[3] = { 'B', 'K', 'R' };
+static const uint8_t LEGACY_DELIVERED_MAGIC[3] = { 'B', 'C', 'V' };
+static const size_t LEGACY_DELIVERED_ENTRY_SIZE = BikeRegistry::ID_LENGTH + 2;
+
+// Espaço reservado no documento por bike no PATCH (chaves multi-path + valores)
+static const size_t UPLOAD_BIKE_BUDGET = 768;
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-bool BikeManager::loadData() {
-    if (!LittleFS.exists(BIKE_DATA_FILE)) {
-        Serial.println("📄 Bike data not found, creating empty");
-        bikes.clear();
-        dataLoaded = true;
-        return saveData();
+static void shardPath(uint8_t shard, bool tmp, char* out, size_t size) {
+    snprintf(out, size, "%s/s%02x.%s", BIKE_SHARD_DIR, shard, tmp ? "tmp" : "bin");
+}
+
+static int entryOf(const String& bikeId) {
+    return directory.find(bikeId.c_str(), bikeId.length());
+}
+
+static bool writeBlob(File& file, const String& blob, uint32_t& crc, size_t& written) {
+    uint8_t length[2] = { (uint8_t)(blob.length() & 0xFF), (uint8_t)(blob.length() >> 8) };
+    crc = Crc32::update(crc, length, sizeof(length));
+    crc = Crc32::update(crc, blob.c_str(), blob.length());
+    written += sizeof(length) + blob.length();
+    return file.write(length, sizeof(length)) == sizeof(length) &&
+           file.write((const uint8_t*)blob.c_str(), blob.length()) == blob.length();
+}
+
+static bool readBlob(File& file, String& blob, uint32_t& crc) {
+    uint8_t length[2];
+    if (file.read(length, sizeof(length)) != sizeof(length)) return false;
+    crc = Crc32::update(crc, length, sizeof(length));
+
+    size_t remaining = length[0] | (length[1] << 8);
+    blob = String();
+    blob.reserve(remaining);
+
+    char chunk[128];
+    while (remaining > 0) {
+        size_t n = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+        if (file.read((uint8_t*)chunk, n) != n) return false;
+        crc = Crc32::update(crc, chunk, n);
+        blob.concat(chunk, n);
+        remaining -= n;
     }
-    
-    File file = LittleFS.open(BIKE_DATA_FILE, "r");
+    return true;
+}
+
+static bool writeLog(File& file, const BikeRegistry::ConfigLog& log, uint32_t& crc, size_t& written) {
+    uint8_t bytes[BikeRegistry::CONFIG_LOG_BYTES];
+    size_t length = log.encode(bytes);
+    crc = Crc32::update(crc, bytes, length);
+    written += length;
+    return file.write(bytes, length) == length;
+}
+
+static bool readLog(File& file, BikeRegistry::ConfigLog& log, uint32_t& crc) {
+    uint8_t bytes[BikeRegistry::CONFIG_LOG_BYTES];
+    if (file.read(bytes, 1) != 1 || bytes[0] > BikeRegistry::CONFIG_LOG_SIZE) return false;
+
+    size_t length = bytes[0] * BikeRegistry::CONFIG_LOG_ENTRY_SIZE;
+    if (file.read(bytes + 1, length) != length) return false;
+    crc = Crc32::update(crc, bytes, 1 + length);
+    return log.decode(bytes, 1 + length);
+}
+
+// config_log no formato do Firebase/JSON antigo: [{timestamp, event, success}, ...]
+static void importConfigLog(JsonArrayConst entries, BikeRegistry::ConfigLog& log) {
+    log.clear();
+    for (JsonObjectConst entry : entries) {
+        log.add(entry["timestamp"] | 0, BikeRegistry::parseEvent(entry["event"]), entry["success"] | false);
+    }
+}
+
+static void parseConfigLog(const String& json, BikeRegistry::ConfigLog& log) {
+    log.clear();
+    if (json.length() == 0) return;
+
+    DynamicJsonDocument doc(2048);
+    if (deserializeJson(doc, json) == DeserializationError::Ok) importConfigLog(doc.as<JsonArrayConst>(), log);
+}
+
+static bool writeRecord(File& file, const Bike& bike, int entry, const String& config,
+                        const BikeRegistry::ConfigLog& log, uint32_t& crc, size_t& written) {
+    uint8_t record[BikeRegistry::RECORD_SIZE];
+    BikeRegistry::encodeRecord(bike, directory.status(entry), directory.configVersion(entry), record);
+    crc = Crc32::update(crc, record, sizeof(record));
+    written += sizeof(record);
+    return file.write(record, sizeof(record)) == sizeof(record) &&
+           writeBlob(file, config, crc, written) && writeLog(file, log, crc, written);
+}
+
+// Percorre os registros de um shard; fn(bike, status, configVersion, config, log)
+// devolve false para parar. true = shard inexistente ou lido inteiro com CRC válido
+template <typename Fn>
+static bool walkShard(uint8_t shard, Fn fn) {
+    char path[32];
+    shardPath(shard, false, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    if (!file) return true;
+
+    uint8_t header[SHARD_HEADER_SIZE];
+    if (file.read(header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, SHARD_MAGIC, sizeof(SHARD_MAGIC)) != 0 ||
+        (header[3] != SHARD_VERSION && header[3] != LEGACY_SHARD_VERSION)) {
+        file.close();
+        Serial.printf("❌ Bike shard %02x header invalid\n", shard);
+        return false;
+    }
+    // Shard com log em JSON: regravado no formato atual no próximo flush
+    bool legacy = header[3] == LEGACY_SHARD_VERSION;
+    if (legacy) dirtyShards |= 1 << shard;
+
+    uint32_t crc = Crc32::update(0, header, sizeof(header));
+    bool complete = true;
+    while (file.available() > 4) {
+        uint8_t record[BikeRegistry::RECORD_SIZE];
+        String config;
+        BikeRegistry::ConfigLog log;
+        if (file.read(record, sizeof(record)) != sizeof(record)) return false;
+        crc = Crc32::update(crc, record, sizeof(record));
+        if (!readBlob(file, config, crc)) return false;
+        if (legacy) {
+            String json;
+            if (!readBlob(file, json, crc)) return false;
+            parseConfigLog(json, log);
+        } else if (!readLog(file, log, crc)) {
+            return false;
+        }
+
+        Bike bike;
+        uint8_t status;
+        uint16_t configVersion;
+        if (!BikeRegistry::decodeRecord(record, sizeof(record), bike, status, configVersion)) continue;
+        if (!fn(bike, status, configVersion, config, log)) {
+            complete = false;
+            break;
+        }
+    }
+
+    uint8_t stored[4];
+    bool valid = !complete || (file.read(stored, sizeof(stored)) == sizeof(stored) && getU32(stored) == crc);
+    file.close();
+
+    if (!valid) Serial.printf("❌ Bike shard %02x CRC mismatch\n", shard);
+    return valid;
+}
+
+// Reescreve o shard: registros em cache substituem os do arquivo, o resto é copiado
+static bool saveShard(uint8_t shard, size_t& written) {
+    char path[32], tmpPath[32];
+    shardPath(shard, false, path, sizeof(path));
+    shardPath(shard, true, tmpPath, sizeof(tmpPath));
+
+    bool saved[BikeRegistry::CACHE_SIZE] = {};
+    uint32_t crc = 0;
+    size_t bytes = 0;
+    bool ok = true;
+
+    File file = LittleFS.open(tmpPath, "w");
     if (!file) {
-        Serial.println("❌ Failed to open bike data");
+        Serial.printf("❌ Failed to create bike shard %02x\n", shard);
         return false;
     }
-    
-    DeserializationError error = deserializeJson(bikes, file);
+
+    uint8_t header[SHARD_HEADER_SIZE];
+    memcpy(header, SHARD_MAGIC, sizeof(SHARD_MAGIC));
+    header[3] = SHARD_VERSION;
+    ok = file.write(header, sizeof(header)) == sizeof(header);
+    crc = Crc32::update(crc, header, sizeof(header));
+    bytes += sizeof(header);
+
+    bool valid = walkShard(shard, [&](const Bike& bike, uint8_t, uint16_t, const String& config, const BikeRegistry::ConfigLog& log) {
+        int entry = directory.find(bike.id, BikeRegistry::ID_LENGTH);
+        if (entry < 0) return true;
+        int slot = cache.find(entry);
+        if (slot >= 0) {
+            saved[slot] = true;
+            ok = writeRecord(file, cache.at(slot), entry, bikeConfigs[slot], configLogs[slot], crc, bytes);
+        } else {
+            // Status e versão da config vêm do Directory (fonte de verdade)
+            ok = writeRecord(file, bike, entry, config, log, crc, bytes);
+        }
+        return ok;
+    });
+
+    if (ok && !valid) {
+        // Shard antigo corrompido: recomeçar do zero, com o cache por cima
+        file.close();
+        file = LittleFS.open(tmpPath, "w");
+        memset(saved, 0, sizeof(saved));
+        crc = Crc32::update(0, header, sizeof(header));
+        bytes = sizeof(header);
+        ok = file && file.write(header, sizeof(header)) == sizeof(header);
+    }
+
+    for (size_t slot = 0; ok && slot < BikeRegistry::CACHE_SIZE; slot++) {
+        if (!cache.used(slot) || saved[slot] || directory.shard(cache.entry(slot)) != shard) continue;
+        ok = writeRecord(file, cache.at(slot), cache.entry(slot), bikeConfigs[slot], configLogs[slot], crc, bytes);
+    }
+
+    if (ok && !valid) {
+        // Bikes fora do cache: o registro se perdeu, mas o Directory ainda tem
+        // ID e status. Regravar a partir dele em vez de sumir com a bike; a
+        // versão da config zera para o próximo download buscar o corpo de novo
+        int rebuilt = 0;
+        for (size_t entry = 0; ok && entry < directory.size(); entry++) {
+            if (directory.shard(entry) != shard || cache.find(entry) >= 0) continue;
+            Bike bike;
+            memset(&bike, 0, sizeof(bike));
+            directory.id(entry, bike.id);
+            directory.setConfigVersion(entry, 0);
+            directory.setFlag(entry, BikeRegistry::FLAG_CONFIG_PENDING, false);
+            ok = writeRecord(file, bike, entry, String(), BikeRegistry::ConfigLog(), crc, bytes);
+            rebuilt++;
+        }
+        indexDirty = true;
+        Serial.printf("⚠️ Bike shard %02x corrupt: %d bikes rebuilt from index (visits, heartbeat, config and log lost)\n",
+                      shard, rebuilt);
+    }
+
+    uint8_t trailer[4] = { (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24) };
+    ok = ok && file.write(trailer, sizeof(trailer)) == sizeof(trailer);
+    if (file) file.close();
+
+    // Troca atômica: uma escrita interrompida não perde o shard anterior
+    if (!ok) {
+        LittleFS.remove(tmpPath);
+        Serial.printf("❌ Short write on bike shard %02x\n", shard);
+        return false;
+    }
+    LittleFS.remove(path);
+    LittleFS.rename(tmpPath, path);
+
+    dirtyShards &= ~(1 << shard);
+    written += bytes + sizeof(trailer);
+    return true;
+}
+
+static bool saveIndex(size_t& written) {
+    File file = LittleFS.open(BIKE_INDEX_TMP_FILE, "w");
+    if (!file) {
+        Serial.println("❌ Failed to create bike index");
+        return false;
+    }
+
+    uint8_t header[DATA_HEADER_SIZE];
+    memcpy(header, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header[3] = DATA_VERSION;
+    header[4] = directory.size() & 0xFF;
+    header[5] = (directory.size() >> 8) & 0xFF;
+
+    bool ok = file.write(header, sizeof(header)) == sizeof(header);
+    uint32_t crc = Crc32::update(0, header, sizeof(header));
+
+    for (size_t entry = 0; ok && entry < directory.size(); entry++) {
+        uint8_t bytes[BikeRegistry::INDEX_ENTRY_SIZE];
+        directory.encodeEntry(entry, bytes);
+        crc = Crc32::update(crc, bytes, sizeof(bytes));
+        ok = file.write(bytes, sizeof(bytes)) == sizeof(bytes);
+    }
+
+    uint8_t trailer[4] = { (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24) };
+    ok = ok && file.write(trailer, sizeof(trailer)) == sizeof(trailer);
     file.close();
-    
+
+    if (!ok) {
+        LittleFS.remove(BIKE_INDEX_TMP_FILE);
+        Serial.println("❌ Short write on bike index");
+        return false;
+    }
+    LittleFS.remove(BIKE_INDEX_FILE);
+    LittleFS.rename(BIKE_INDEX_TMP_FILE, BIKE_INDEX_FILE);
+
+    indexDirty = false;
+    written += sizeof(header) + directory.size() * BikeRegistry::INDEX_ENTRY_SIZE + sizeof(trailer);
+    return true;
+}
+
+// Boot: só o índice é lido; registros completos vêm dos shards sob demanda
+static bool loadIndex() {
+    File file = LittleFS.open(BIKE_INDEX_FILE, "r");
+    if (!file) return false;
+
+    uint8_t header[DATA_HEADER_SIZE];
+    if (file.read(header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header[3] != DATA_VERSION) {
+        file.close();
+        Serial.println("❌ Bike index header invalid");
+        return false;
+    }
+
+    uint32_t crc = Crc32::update(0, header, sizeof(header));
+    size_t count = header[4] | (header[5] << 8);
+    bool valid = count <= BikeRegistry::CAPACITY;
+
+    for (size_t i = 0; valid && i < count; i++) {
+        uint8_t bytes[BikeRegistry::INDEX_ENTRY_SIZE];
+        valid = file.read(bytes, sizeof(bytes)) == sizeof(bytes);
+        crc = Crc32::update(crc, bytes, sizeof(bytes));
+        if (valid) directory.decodeEntry(bytes);
+    }
+
+    uint8_t stored[4];
+    valid = valid && file.read(stored, sizeof(stored)) == sizeof(stored) && getU32(stored) == crc;
+    file.close();
+
+    if (!valid) {
+        Serial.println("❌ Bike index CRC mismatch");
+        directory.clear();
+    }
+    return valid;
+}
+
+// Recuperação: índice perdido, mas os shards têm status e versões
+static void rebuildIndex() {
+    for (uint8_t shard = 0; shard < BikeRegistry::SHARD_COUNT; shard++) {
+        walkShard(shard, [](const Bike& bike, uint8_t status, uint16_t configVersion, const String&, const BikeRegistry::ConfigLog&) {
+            int entry = directory.insert(bike.id, BikeRegistry::ID_LENGTH);
+            if (entry < 0) return false;
+            directory.setStatus(entry, status);
+            directory.setConfigVersion(entry, configVersion);
+            directory.setFlag(entry, BikeRegistry::FLAG_CONFIG_PENDING, configVersion > bike.deliveredVersion);
+            return true;
+        });
+    }
+    indexDirty = true;
+}
+
+static void loadBike(int entry, int slot) {
+    Bike& bike = cache.at(slot);
+    char id[BikeRegistry::ID_LENGTH + 1];
+    directory.id(entry, id);
+
+    bool found = false;
+    bool valid = walkShard(directory.shard(entry), [&](const Bike& stored, uint8_t, uint16_t, const String& config, const BikeRegistry::ConfigLog& log) {
+        if (memcmp(stored.id, id, BikeRegistry::ID_LENGTH) != 0) return true;
+        bike = stored;
+        bikeConfigs[slot] = config;
+        configLogs[slot] = log;
+        found = true;
+        return true;   // ler até o fim para validar o CRC
+    });
+
+    if (!found || !valid) {
+        // Bike nova (ainda não gravada) ou shard corrompido: começa zerada
+        memset(&bike, 0, sizeof(bike));
+        memcpy(bike.id, id, sizeof(id));
+        bikeConfigs[slot] = String();
+        configLogs[slot].clear();
+    }
+
+    // Bits de upload não são persistidos: bike com upload pendente sobe inteira
+    bike.dirtyFields = directory.flag(entry, BikeRegistry::FLAG_UPLOAD) ? BikeRegistry::FIELD_ALL : 0;
+    bike.uploadFields = 0;
+}
+
+// Slot do cache com o registro completo da entrada; carrega do shard se preciso.
+// -1 se o cache inteiro estiver fixado por um PATCH ou o write-back falhar
+static int acquire(int entry) {
+    int slot = cache.find(entry);
+    if (slot >= 0) {
+        cache.touch(slot);
+        return slot;
+    }
+
+    slot = cache.victim();
+    if (slot < 0) return -1;
+
+    if (cache.used(slot)) {
+        // Write-back: o shard do despejado sai junto com os outros registros em cache dele
+        uint8_t shard = directory.shard(cache.entry(slot));
+        if (dirtyShards & (1 << shard)) {
+            size_t written = 0;
+            if (!saveShard(shard, written)) return -1;
+            writeStats.bytesWritten += written;
+        }
+        cache.release(slot);
+    }
+
+    cache.bind(slot, entry);
+    loadBike(entry, slot);
+    return slot;
+}
+
+static int acquireBike(const String& bikeId) {
+    if (!dataLoaded) return -1;
+    int entry = entryOf(bikeId);
+    return entry < 0 ? -1 : acquire(entry);
+}
+
+static void markShard(int slot) {
+    dirtyShards |= 1 << directory.shard(cache.entry(slot));
+}
+
+static void setHeartbeat(int slot, uint32_t timestamp) {
+    Bike& bike = cache.at(slot);
+    int entry = cache.entry(slot);
+    // Só descontar o heartbeat anterior se ele foi contado nesta sessão
+    if (directory.flag(entry, BikeRegistry::FLAG_RECENT)) recent.remove(bike.lastHeartbeat);
+    recent.add(timestamp);
+    directory.setFlag(entry, BikeRegistry::FLAG_RECENT, timestamp != 0);
+    bike.lastHeartbeat = timestamp;
+}
+
+static void refreshConfigPending(int slot) {
+    int entry = cache.entry(slot);
+    bool pending = directory.configVersion(entry) > cache.at(slot).deliveredVersion;
+    if (pending != directory.flag(entry, BikeRegistry::FLAG_CONFIG_PENDING)) {
+        directory.setFlag(entry, BikeRegistry::FLAG_CONFIG_PENDING, pending);
+        indexDirty = true;
+    }
+}
+
+static void removeShardFiles() {
+    for (uint8_t shard = 0; shard < BikeRegistry::SHARD_COUNT; shard++) {
+        char path[32];
+        shardPath(shard, false, path, sizeof(path));
+        LittleFS.remove(path);
+    }
+}
+
+static void clearRegistry() {
+    directory.clear();
+    cache.clear();
+    recent.clear();
+    for (size_t i = 0; i < BikeRegistry::CACHE_SIZE; i++) {
+        bikeConfigs[i] = String();
+        configLogs[i].clear();
+    }
+    dirtyShards = 0;
+    indexDirty = true;
+}
+
+// Formato do /bike_data.json antigo e do nó bikes no Firebase
+static int importBike(const char* bikeId, JsonObjectConst data) {
+    int entry = directory.insert(bikeId, strlen(bikeId));
+    int slot = entry < 0 ? -1 : acquire(entry);
+    if (slot < 0) {
+        Serial.printf("⚠️ Skipping bike %s (invalid ID or registry full)\n", bikeId);
+        return -1;
+    }
+
+    Bike& bike = cache.at(slot);
+    directory.setStatus(entry, BikeRegistry::parseStatus(data["status"] | "unknown"));
+    bike.firstSeen = data["first_seen"] | 0;
+    bike.lastVisit = data["last_visit"] | 0;
+    bike.visitCount = data["visit_count"] | 0;
+
+    JsonObjectConst heartbeat = data["last_heartbeat"];
+    if (!heartbeat.isNull()) {
+        setHeartbeat(slot, heartbeat["timestamp"] | 0);
+        bike.battery = heartbeat["battery"] | 0;
+        bike.heap = heartbeat["heap"] | 0;
+    }
+
+    bikeConfigs[slot] = String();
+    if (!data["config"].isNull()) {
+        serializeJson(data["config"], bikeConfigs[slot]);
+        directory.setConfigVersion(entry, data["config"]["version"] | 1);
+    }
+    importConfigLog(data["config_log"], configLogs[slot]);
+
+    refreshConfigPending(slot);
+    markShard(slot);
+    return slot;
+}
+
+// /bike_data.bin (registro único, 64 bikes) -> shards
+static bool migrateBinaryData() {
+    File file = LittleFS.open(BIKE_DATA_BIN_FILE, "r");
+    if (!file) return false;
+
+    uint8_t header[DATA_HEADER_SIZE];
+    if (file.read(header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, LEGACY_DATA_MAGIC, sizeof(LEGACY_DATA_MAGIC)) != 0 || header[3] != DATA_VERSION) {
+        file.close();
+        Serial.println("❌ Bike data header invalid");
+        return false;
+    }
+
+    uint32_t crc = Crc32::update(0, header, sizeof(header));
+    size_t count = header[4] | (header[5] << 8);
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t record[BikeRegistry::LEGACY_RECORD_SIZE];
+        Bike stored;
+        uint8_t status;
+        uint16_t configVersion;
+        String config, log;
+        if (file.read(record, sizeof(record)) != sizeof(record)) break;
+        crc = Crc32::update(crc, record, sizeof(record));
+        if (!readBlob(file, config, crc) || !readBlob(file, log, crc)) break;
+
+        if (!BikeRegistry::decodeRecord(record, sizeof(record), stored, status, configVersion)) continue;
+        int entry = directory.insert(stored.id, BikeRegistry::ID_LENGTH);
+        int slot = entry < 0 ? -1 : acquire(entry);
+        if (slot < 0) continue;
+
+        uint32_t heartbeat = stored.lastHeartbeat;
+        stored.lastHeartbeat = 0;
+        cache.at(slot) = stored;
+        setHeartbeat(slot, heartbeat);
+        directory.setStatus(entry, status);
+        bikeConfigs[slot] = config;
+        parseConfigLog(log, configLogs[slot]);
+
+        // Versão da config em cache: o download só busca o que andou além dela
+        if (config.length()) {
+            DynamicJsonDocument cached(1024);
+            if (deserializeJson(cached, config) == DeserializationError::Ok) {
+                directory.setConfigVersion(entry, cached["version"] | 1);
+            }
+        }
+        markShard(slot);
+    }
+
+    uint8_t stored[4];
+    bool valid = file.read(stored, sizeof(stored)) == sizeof(stored) && getU32(stored) == crc;
+    file.close();
+
+    if (!valid) {
+        Serial.println("❌ Bike data CRC mismatch");
+        clearRegistry();
+        return false;
+    }
+
+    // Versões entregues da tabela antiga passam para o registro de cada bike
+    file = LittleFS.open(CONFIG_DELIVERED_FILE, "r");
+    if (file) {
+        uint8_t deliveredHeader[DATA_HEADER_SIZE];
+        bool ok = file.read(deliveredHeader, sizeof(deliveredHeader)) == sizeof(deliveredHeader) &&
+                  memcmp(deliveredHeader, LEGACY_DELIVERED_MAGIC, sizeof(LEGACY_DELIVERED_MAGIC)) == 0;
+        size_t entries = ok ? (deliveredHeader[4] | (deliveredHeader[5] << 8)) : 0;
+        for (size_t i = 0; i < entries; i++) {
+            uint8_t bytes[LEGACY_DELIVERED_ENTRY_SIZE];
+            if (file.read(bytes, sizeof(bytes)) != sizeof(bytes)) break;
+            int entry = directory.find((const char*)bytes, BikeRegistry::ID_LENGTH);
+            int slot = entry < 0 ? -1 : acquire(entry);
+            if (slot < 0) continue;
+            cache.at(slot).deliveredVersion = bytes[10] | (bytes[11] << 8);
+            markShard(slot);
+        }
+        file.close();
+    }
+
+    for (size_t slot = 0; slot < BikeRegistry::CACHE_SIZE; slot++) {
+        if (cache.used(slot)) refreshConfigPending(slot);
+    }
+    Serial.printf("🔄 Bike data migrated to shards: %d bikes\n", directory.size());
+    return true;
+}
+
+static bool migrateJsonData() {
+    File file = LittleFS.open(BIKE_DATA_FILE, "r");
+    if (!file) return false;
+
+    DynamicJsonDocument doc(file.size() * 2 + 1024);
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+
     if (error) {
         Serial.printf("❌ Data parse error: %s\n", error.c_str());
         return false;
     }
+
+    for (JsonPairConst bike : doc.as<JsonObjectConst>()) {
+        importBike(bike.key().c_str(), bike.value());
+    }
+    Serial.printf("🔄 Bike data migrated from JSON: %d bikes\n", directory.size());
+    return true;
+}
+
+bool BikeManager::init() {
+    // Carrega uma vez: o estado de runtime (bits de upload, pushes) sobrevive às trocas de estado
+    if (dataLoaded) return true;
+    return loadData();
+}
+
+bool BikeManager::loadData() {
+    if (!LittleFS.exists(BIKE_SHARD_DIR)) LittleFS.mkdir(BIKE_SHARD_DIR);
+    clearRegistry();
+    
+    if (loadIndex()) {
+        indexDirty = false;
+    } else if (LittleFS.exists(BIKE_DATA_BIN_FILE) || LittleFS.exists(BIKE_DATA_FILE)) {
+        // Primeiro boot com shards: converter o registro antigo
+        bool binary = LittleFS.exists(BIKE_DATA_BIN_FILE);
+        if (!(binary ? migrateBinaryData() : migrateJsonData())) return false;
+        dataLoaded = true;
+        if (!saveData()) return false;
+        LittleFS.remove(binary ? BIKE_DATA_BIN_FILE : BIKE_DATA_FILE);
+        LittleFS.remove(CONFIG_DELIVERED_FILE);
+    } else {
+        // Sem índice: reconstruir dos shards (vazio no primeiro boot)
+        rebuildIndex();
+        Serial.printf("📄 Bike index rebuilt from shards: %d bikes\n", directory.size());
+        dataLoaded = true;
+        if (!saveData()) return false;
+    }
     
     dataLoaded = true;
-    Serial.printf("✅ Bike data loaded: %d bikes\n", bikes.size());
+    Serial.printf("✅ Bike index loaded: %d bikes (cache %d)\n", directory.size(), BikeRegistry::CACHE_SIZE);
     
-    // Log bikes por status
-    int allowed = 0, pending = 0, blocked = 0;
-    JsonObject obj = bikes.as<JsonObject>();
-    for (JsonPair bike : obj) {
-        String status = bike.value()["status"] | "unknown";
-        if (status == "allowed") allowed++;
-        else if (status == "pending") pending++;
-        else if (status == "blocked") blocked++;
+    // Bits de upload não são persistidos: o primeiro upload após o boot reconcilia tudo
+    for (size_t entry = 0; entry < directory.size(); entry++) {
+        directory.setFlag(entry, BikeRegistry::FLAG_UPLOAD, true);
     }
-    Serial.printf("   Allowed: %d | Pending: %d | Blocked: %d\n", allowed, pending, blocked);
+    
+    // Log bikes por status
+    Serial.printf("   Allowed: %d | Pending: %d | Blocked: %d\n",
+                  directory.statusCount(BikeRegistry::STATUS_ALLOWED),
+                  directory.statusCount(BikeRegistry::STATUS_PENDING),
+                  directory.statusCount(BikeRegistry::STATUS_BLOCKED));
     
     return true;
 }
 
 bool BikeManager::saveData() {
-    File file = LittleFS.open(BIKE_DATA_FILE, "w");
-    if (!file) {
-        Serial.println("❌ Failed to create bike data");
-        return false;
+    size_t written = 0;
+    int shards = 0;
+    bool ok = true;
+    
+    // Só os shards com registros alterados e o índice, se mudou
+    for (uint8_t shard = 0; shard < BikeRegistry::SHARD_COUNT; shard++) {
+        if (!(dirtyShards & (1 << shard))) continue;
+        if (saveShard(shard, written)) shards++;
+        else ok = false;
     }
+    if (indexDirty && !saveIndex(written)) ok = false;
     
-    serializeJson(bikes, file);
-    file.close();
+    writeStats.flushes++;
+    writeStats.bytesWritten += written;
+    Serial.printf("💾 Bike data saved (%d bytes, %d shards, %lu writes avoided so far)\n",
+                  written, shards, (unsigned long)writeStats.flushesAvoided);
+    return ok;
+}
+
+void BikeManager::markDirty() {
+    if (dirty) {
+        writeStats.flushesAvoided++;
+        return;
+    }
+    dirty = true;
+    dirtySince = millis();
+}
+
+void BikeManager::update() {
+    if (dirty && millis() - dirtySince >= BIKE_DATA_FLUSH_DELAY_MS) {
+        flush();
+    }
+}
+
+bool BikeManager::flush() {
+    if (!dirty) return true;
     
-    Serial.println("💾 Bike data saved");
+    if (!saveData()) {
+        // Tentar de novo só no próximo prazo
+        dirtySince = millis();
+        return false;
+    }
+    dirty = false;
     return true;
 }
 
+const BikeManager::WriteStats& BikeManager::getWriteStats() {
+    return writeStats;
+}
+
 bool BikeManager::canConnect(const String& bikeId) {
     if (!dataLoaded) return false;
     
     // Verificar se é formato válido BPR
-    if (!bikeId.startsWith("bpr-") || bikeId.length() != 10) {
+    if (!BikeRegistry::isValidId(bikeId.c_str(), bikeId.length())) {
         Serial.printf("❌ Invalid bike ID format: %s\n", bikeId.c_str());
         return false;
     }
     
-    if (!bikes.containsKey(bikeId)) {
+    // Só o bitmap residente: nenhum acesso a flash no caminho do connect
+    int entry = entryOf(bikeId);
+    if (entry < 0) {
         Serial.printf("🆕 New bike detected: %s - allowing connection + adding as pending\n", bikeId.c_str());
         addPendingBike(bikeId);
         return true; // Permite conexão de bikes novas
     }
     
-    String status = bikes[bikeId]["status"] | "unknown";
-    bool canConnect = (status != "blocked");
+    uint8_t status = directory.status(entry);
+    bool canConnect = (status != BikeRegistry::STATUS_BLOCKED);
     
     Serial.printf("🔍 Bike %s status: %s (%s)\n", 
-                 bikeId.c_str(), status.c_str(), canConnect ? "✅ Can connect" : "❌ Blocked");
+                 bikeId.c_str(), BikeRegistry::statusName(status), canConnect ? "✅ Can connect" : "❌ Blocked");
     
     return canConnect;
 }
@@ -97,53 +741,58 @@ bool BikeManager::canConnect(const String& bikeId) {
 bool BikeManager::isAllowed(const String& bikeId) {
     if (!dataLoaded) return false;
     
-    // Verificar se é formato válido BPR
-    if (!bikeId.startsWith("bpr-") || bikeId.length() != 10) {
-        return false;
-    }
-    
-    if (!bikes.containsKey(bikeId)) {
+    int entry = entryOf(bikeId);
+    if (entry < 0) {
         return false; // Bikes novas NÃO podem enviar dados (só pending)
     }
     
-    String status = bikes[bikeId]["status"] | "unknown";
-    return (status == "allowed"); // Só bikes ALLOWED podem enviar dados
+    return directory.status(entry) == BikeRegistry::STATUS_ALLOWED; // Só bikes ALLOWED podem enviar dados
 }
 
 void BikeManager::addPendingBike(const String& bikeId) {
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    getLocalTime(&timeinfo);
+    int entry = directory.insert(bikeId.c_str(), bikeId.length());
+    int slot = entry < 0 ? -1 : acquire(entry);
+    if (slot < 0) {
+        Serial.printf("❌ Bike registry full (%d bikes), %s not added\n", BikeRegistry::CAPACITY, bikeId.c_str());
+        return;
+    }
     
-    char dateStr[64];
-    strftime(dateStr, sizeof(dateStr), "%Y-%m-%d %H:%M:%S UTC-3", &timeinfo);
+    time_t now = time(nullptr);
     
-    bikes[bikeId]["status"] = "pending";
-    bikes[bikeId]["first_seen"] = now;
-    bikes[bikeId]["first_seen_human"] = dateStr;
-    bikes[bikeId]["last_visit"] = now;
-    bikes[bikeId]["last_visit_human"] = dateStr;
-    bikes[bikeId]["visit_count"] = 1;
-    bikes[bikeId]["last_heartbeat"] = nullptr;
+    Bike& bike = cache.at(slot);
+    directory.setStatus(entry, BikeRegistry::STATUS_PENDING);
+    setHeartbeat(slot, 0);
+    bike.firstSeen = now;
+    bike.lastVisit = now;
+    bike.visitCount = 1;
+    markFields(slot, BikeRegistry::FIELD_STATUS | BikeRegistry::FIELD_FIRST_SEEN |
+                     BikeRegistry::FIELD_LAST_VISIT | BikeRegistry::FIELD_VISIT_COUNT);
+    indexDirty = true;
+    markShard(slot);
     
-    saveData();
-    Serial.printf("📝 Bike %s added as pending (first seen: %s)\n", bikeId.c_str(), dateStr);
+    markDirty();
+    Serial.printf("📝 Bike %s added as pending (first seen: %lu)\n", bikeId.c_str(), (unsigned long)now);
 }
 
 void BikeManager::updateHeartbeat(const String& bikeId, int battery, int heap) {
-    if (!dataLoaded || !bikes.containsKey(bikeId)) return;
+    int slot = acquireBike(bikeId);
+    if (slot < 0) return;
     
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    getLocalTime(&timeinfo);
+    Bike& bike = cache.at(slot);
+    uint16_t fields = BikeRegistry::FIELD_HEARTBEAT;
+    if (bike.battery != battery) fields |= BikeRegistry::FIELD_BATTERY;
+    if (bike.heap != (uint32_t)heap) fields |= BikeRegistry::FIELD_HEAP;
+    // Primeiro heartbeat: a bike nunca subiu, enviar o registro inteiro
+    if (bike.lastHeartbeat == 0) fields = BikeRegistry::FIELD_ALL;
     
-    char dateStr[64];
-    strftime(dateStr, sizeof(dateStr), "%Y-%m-%d %H:%M:%S UTC-3", &timeinfo);
+    setHeartbeat(slot, time(nullptr));
+    bike.battery = battery;
+    bike.heap = heap;
+    markFields(slot, fields);
     
-    bikes[bikeId]["last_heartbeat"]["timestamp"] = now;
-    bikes[bikeId]["last_heartbeat"]["timestamp_human"] = dateStr;
-    bikes[bikeId]["last_heartbeat"]["battery"] = battery;
-    bikes[bikeId]["last_heartbeat"]["heap"] = heap;
+    // O registro pode ser despejado do cache: o heartbeat precisa chegar ao shard
+    markShard(slot);
+    markDirty();
     
     Serial.printf("💓 Heartbeat updated: %s (bat:%d%%, heap:%d)\n", 
                  bikeId.c_str(), battery, heap);
@@ -152,293 +801,559 @@ void BikeManager::updateHeartbeat(const String& bikeId, int battery, int heap) {
 void BikeManager::updateFromFirebase(const DynamicJsonDocument& firebaseData) {
     Serial.println("🔄 Updating bike data from Firebase...");
     
-    bikes.clear();
+    clearRegistry();
+    removeShardFiles();
     
     JsonObjectConst obj = firebaseData.as<JsonObjectConst>();
     for (JsonPairConst bike : obj) {
-        String bikeId = bike.key().c_str();
-        bikes[bikeId] = bike.value();
+        int slot = importBike(bike.key().c_str(), bike.value());
+        if (slot < 0) continue;
         
-        String status = bike.value()["status"] | "unknown";
-        Serial.printf("   %s: %s\n", bikeId.c_str(), status.c_str());
+        Serial.printf("   %s: %s\n", bike.key().c_str(), BikeRegistry::statusName(directory.status(cache.entry(slot))));
     }
     
-    saveData();
+    markDirty();
     dataLoaded = true;
     
-    Serial.printf("✅ Data updated: %d bikes from Firebase\n", bikes.size());
+    Serial.printf("✅ Data updated: %d bikes from Firebase\n", directory.size());
+}
+
+// Chave multi-path "bpr-xxxxxx/campo[/subcampo]": o PATCH só toca as folhas enviadas
+template <typename T>
+static void putField(DynamicJsonDocument& doc, const char* bikeId, const char* path, const T& value) {
+    char key[64];
+    snprintf(key, sizeof(key), "%s/%s", bikeId, path);
+    doc[key] = value;   // char* (não const) -> ArduinoJson copia a chave
+}
+
+// Só epoch; o *_human legado sai apenas com compat.human_timestamps
+static void putTimeField(DynamicJsonDocument& doc, const char* bikeId, const char* path,
+                         const char* humanPath, uint32_t timestamp) {
+    putField(doc, bikeId, path, timestamp);
+    if (configManager.getHumanTimestamps()) {
+        char dateStr[TimeFormat::HUMAN_SIZE];
+        TimeFormat::human(timestamp, dateStr, sizeof(dateStr));
+        putField(doc, bikeId, humanPath, (char*)dateStr);
+    }
+}
+
+// Único ponto em que o anel de eventos vira JSON
+static void putConfigLog(DynamicJsonDocument& doc, const char* bikeId, const BikeRegistry::ConfigLog& log) {
+    char key[64];
+    snprintf(key, sizeof(key), "%s/config_log", bikeId);
+    JsonArray entries = doc.createNestedArray(key);
+    for (size_t i = 0; i < log.size(); i++) {
+        JsonObject entry = entries.createNestedObject();
+        entry["timestamp"] = log.timestamp(i);
+        entry["event"] = BikeRegistry::eventName(log.event(i));   // literal estático, sem cópia
+        entry["success"] = log.success(i);
+    }
+}
+
+void BikeManager::markFields(int slot, uint16_t fields) {
+    Bike& bike = cache.at(slot);
+    bike.dirtyFields |= fields;
+    // Alterado de novo durante o PATCH: o valor enviado já está velho
+    bike.uploadFields &= ~fields;
+    directory.setFlag(cache.entry(slot), BikeRegistry::FLAG_UPLOAD, true);
 }
 
 bool BikeManager::uploadToFirebase(DynamicJsonDocument& doc) {
     if (!dataLoaded) return false;
     
     doc.clear();
+    int bikes = 0;
     
-    // Só enviar bikes que tiveram heartbeat atualizado
-    JsonObject obj = bikes.as<JsonObject>();
-    for (JsonPair bike : obj) {
-        String bikeId = bike.key().c_str();
-        if (bike.value()["last_heartbeat"].isNull()) continue;
+    // Só enviar bikes que já tiveram heartbeat, e só os campos alterados.
+    // Bikes no PATCH ficam fixadas no cache até confirmUpload/rollbackUpload
+    for (size_t entry = 0; entry < directory.size(); entry++) {
+        if (!directory.flag(entry, BikeRegistry::FLAG_UPLOAD)) continue;
+        
+        // Documento cheio: o resto fica sujo para o próximo PATCH
+        if (doc.capacity() - doc.memoryUsage() < UPLOAD_BIKE_BUDGET) break;
+        
+        int slot = acquire(entry);
+        if (slot < 0) break;
+        
+        Bike& bike = cache.at(slot);
+        uint16_t fields = bike.dirtyFields;
+        if (bike.lastHeartbeat == 0 || fields == 0) {
+            // Sem heartbeat ainda: o primeiro heartbeat marca tudo de novo
+            directory.setFlag(entry, BikeRegistry::FLAG_UPLOAD, false);
+            continue;
+        }
+        
+        const char* id = bike.id;
+        if (fields & BikeRegistry::FIELD_STATUS) {
+            putField(doc, id, "status", BikeRegistry::statusName(directory.status(entry)));
+        }
+        if ((fields & BikeRegistry::FIELD_FIRST_SEEN) && bike.firstSeen) {
+            putTimeField(doc, id, "first_seen", "first_seen_human", bike.firstSeen);
+        }
+        if ((fields & BikeRegistry::FIELD_LAST_VISIT) && bike.lastVisit) {
+            putTimeField(doc, id, "last_visit", "last_visit_human", bike.lastVisit);
+        }
+        if (fields & BikeRegistry::FIELD_VISIT_COUNT) {
+            putField(doc, id, "visit_count", bike.visitCount);
+        }
+        if (fields & BikeRegistry::FIELD_HEARTBEAT) {
+            putTimeField(doc, id, "last_heartbeat/timestamp", "last_heartbeat/timestamp_human", bike.lastHeartbeat);
+        }
+        if (fields & BikeRegistry::FIELD_BATTERY) {
+            putField(doc, id, "last_heartbeat/battery", bike.battery);
+        }
+        if (fields & BikeRegistry::FIELD_HEAP) {
+            putField(doc, id, "last_heartbeat/heap", bike.heap);
+        }
+        if ((fields & BikeRegistry::FIELD_CONFIG) && bikeConfigs[slot].length()) {
+            putField(doc, id, "config", serialized(bikeConfigs[slot]));
+        }
+        if ((fields & BikeRegistry::FIELD_CONFIG_LOG) && configLogs[slot].size()) {
+            putConfigLog(doc, id, configLogs[slot]);
+        }
         
-        doc[bikeId] = bike.value();
+        bike.uploadFields = fields;
+        bikes++;
     }
     
+    if (bikes > 0) {
+        Serial.printf("📤 Bike delta: %d bikes, %d fields\n", bikes, doc.size());
+    }
     return doc.size() > 0;
 }
 
+void BikeManager::confirmUpload() {
+    // Só bikes em cache podem estar num PATCH (ficam fixadas)
+    for (size_t slot = 0; slot < BikeRegistry::CACHE_SIZE; slot++) {
+        if (!cache.used(slot)) continue;
+        Bike& bike = cache.at(slot);
+        bike.dirtyFields &= ~bike.uploadFields;
+        bike.uploadFields = 0;
+        if (bike.dirtyFields == 0) directory.setFlag(cache.entry(slot), BikeRegistry::FLAG_UPLOAD, false);
+    }
+}
+
+void BikeManager::rollbackUpload() {
+    for (size_t slot = 0; slot < BikeRegistry::CACHE_SIZE; slot++) {
+        cache.at(slot).uploadFields = 0;
+    }
+}
+
 int BikeManager::getAllowedCount() {
     if (!dataLoaded) return 0;
     
-    int count = 0;
-    JsonObject obj = bikes.as<JsonObject>();
-    for (JsonPair bike : obj) {
-        String status = bike.value()["status"] | "";
-        if (status == "allowed") count++;
-    }
-    return count;
+    return directory.statusCount(BikeRegistry::STATUS_ALLOWED);
 }
 
 void BikeManager::recordPendingVisit(const String& bikeId) {
-    if (!dataLoaded || !bikes.containsKey(bikeId)) return;
+    int entry = dataLoaded ? entryOf(bikeId) : -1;
+    if (entry < 0 || directory.status(entry) != BikeRegistry::STATUS_PENDING) return;
     
-    String status = bikes[bikeId]["status"] | "";
-    if (status != "pending") return;
+    int slot = acquire(entry);
+    if (slot < 0) return;
     
+    Bike& bike = cache.at(slot);
     time_t now = time(nullptr);
-    struct tm timeinfo;
-    getLocalTime(&timeinfo);
-    
-    char dateStr[64];
-    strftime(dateStr, sizeof(dateStr), "%Y-%m-%d %H:%M:%S UTC-3", &timeinfo);
-    
-    bikes[bikeId]["last_visit"] = now;
-    bikes[bikeId]["last_visit_human"] = dateStr;
     
-    int visitCount = bikes[bikeId]["visit_count"] | 0;
-    bikes[bikeId]["visit_count"] = visitCount + 1;
+    bike.lastVisit = now;
+    bike.visitCount++;
+    markFields(slot, BikeRegistry::FIELD_LAST_VISIT | BikeRegistry::FIELD_VISIT_COUNT);
+    markShard(slot);
     
-    saveData();
-    Serial.printf("📝 Pending bike %s visited (count: %d, time: %s)\n", 
-                 bikeId.c_str(), visitCount + 1, dateStr);
+    markDirty();
+    Serial.printf("📝 Pending bike %s visited (count: %d, ts: %lu)\n", 
+                 bikeId.c_str(), bike.visitCount, (unsigned long)now);
 }
 
 int BikeManager::getPendingCount() {
     if (!dataLoaded) return 0;
     
-    int count = 0;
-    JsonObject obj = bikes.as<JsonObject>();
-    for (JsonPair bike : obj) {
-        String status = bike.value()["status"] | "";
-        if (status == "pending") count++;
-    }
-    return count;
+    return directory.statusCount(BikeRegistry::STATUS_PENDING);
 }
 
-void BikeManager::logConfigEvent(const String& bikeId, const String& event, bool success) {
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    getLocalTime(&timeinfo);
-    
-    char dateStr[64];
-    strftime(dateStr, sizeof(dateStr), "%Y-%m-%d %H:%M:%S UTC-3", &timeinfo);
-    
-    // Criar entrada no log de configuração
-    JsonArray configLog;
-    if (bikes[bikeId]["config_log"].isNull()) {
-        configLog = bikes[bikeId].createNestedArray("config_log");
-    } else {
-        configLog = bikes[bikeId]["config_log"];
-    }
-    
-    JsonObject logEntry = configLog.createNestedObject();
-    logEntry["timestamp"] = now;
-    logEntry["timestamp_human"] = dateStr;
-    logEntry["event"] = event;
-    logEntry["success"] = success;
+void BikeManager::logConfigEvent(const String& bikeId, uint8_t event, bool success) {
+    int entry = directory.insert(bikeId.c_str(), bikeId.length());
+    int slot = entry < 0 ? -1 : acquire(entry);
+    if (slot < 0) return;
     
-    // Manter apenas os últimos 10 logs
-    while (configLog.size() > 10) {
-        configLog.remove(0);
-    }
-    
-    saveData();
+    // Anel fixo: o evento mais novo sobrescreve o mais antigo, sem alocação
+    configLogs[slot].add(time(nullptr), event, success);
+    markFields(slot, BikeRegistry::FIELD_CONFIG_LOG);
+    markShard(slot);
+    markDirty();
     Serial.printf("📝 Config event logged: %s - %s (%s)\n", 
-                 bikeId.c_str(), event.c_str(), success ? "SUCCESS" : "FAILED");
+                 bikeId.c_str(), BikeRegistry::eventName(event), success ? "SUCCESS" : "FAILED");
 }
 
 int BikeManager::getConnectedCount() {
     if (!dataLoaded) return 0;
     
-    int count = 0;
-    time_t now = time(nullptr);
+    // Heartbeat nos últimos 5 minutos, mantido pelos baldes do registro
+    return recent.count(time(nullptr));
+}
+
+static bool appendHeartbeatData(JsonArray& bikes_array, const Bike& bike, uint8_t status, time_t now) {
+    JsonObject bikeData = bikes_array.createNestedObject();
+    if (bikeData.isNull()) return false;
     
-    JsonObject obj = bikes.as<JsonObject>();
-    for (JsonPair bike : obj) {
-        JsonObject heartbeat = bike.value()["last_heartbeat"];
-        if (!heartbeat.isNull()) {
-            uint32_t lastSeen = heartbeat["timestamp"] | 0;
-            // Considerar conectada se heartbeat foi há menos de 5 minutos
-            if ((now - lastSeen) < 300) {
-                count++;
-            }
-        }
+    bikeData["id"] = bike.id;
+    bikeData["status"] = BikeRegistry::statusName(status);
+    
+    // Dados do último heartbeat
+    if (bike.lastHeartbeat != 0) {
+        bikeData["last_seen"] = bike.lastHeartbeat;
+        bikeData["battery_last"] = bike.battery;
+        bikeData["heap_last"] = bike.heap;
+        
+        uint32_t timeSince = now - bike.lastHeartbeat;
+        bikeData["seconds_since_contact"] = timeSince;
+        bikeData["is_recent"] = (timeSince < 300); // < 5min
+    } else {
+        bikeData["last_seen"] = 0;
+        bikeData["battery_last"] = 0;
+        bikeData["heap_last"] = 0;
+        bikeData["seconds_since_contact"] = 999999;
+        bikeData["is_recent"] = false;
     }
-    return count;
+    
+    // Dados de visitas (para bikes pending)
+    bikeData["visit_count"] = bike.visitCount;
+    bikeData["first_seen"] = bike.firstSeen;
+    return true;
 }
 
 void BikeManager::populateHeartbeatData(JsonArray& bikes_array) {
     if (!dataLoaded) return;
     
     time_t now = time(nullptr);
-    JsonObject obj = bikes.as<JsonObject>();
+    bool room = true;
+    
+    // Sem flash: quem mandou heartbeat passou pelo cache, que tem o registro
+    // completo; as demais bikes saem só com ID e status do Directory
+    for (size_t slot = 0; room && slot < BikeRegistry::CACHE_SIZE; slot++) {
+        if (!cache.used(slot)) continue;
+        room = appendHeartbeatData(bikes_array, cache.at(slot), directory.status(cache.entry(slot)), now);
+    }
     
-    for (JsonPair bike : obj) {
-        String bikeId = bike.key().c_str();
+    for (size_t entry = 0; room && entry < directory.size(); entry++) {
+        if (cache.find(entry) >= 0) continue;
         JsonObject bikeData = bikes_array.createNestedObject();
+        if (bikeData.isNull()) break;
         
-        bikeData["id"] = bikeId;
-        bikeData["status"] = bike.value()["status"] | "unknown";
+        char id[BikeRegistry::ID_LENGTH + 1];
+        directory.id(entry, id);
+        bikeData["id"] = id;
+        bikeData["status"] = BikeRegistry::statusName(directory.status(entry));
+    }
+}
+
+// Funções de configuração (ex-BikeConfigManager)
+static bool readNonSpace(Stream& stream, char& c) {
+    do {
+        if (stream.readBytes(&c, 1) != 1) return false;
+    } while (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+    return true;
+}
+
+// Percorre o objeto {"bpr-xxxxxx": {...}, ...} direto do stream, uma bike por vez:
+// deserializeJson lê exatamente um valor e para, então só uma config fica em memória
+template <typename Fn>
+static bool streamConfigs(Stream& stream, Fn apply) {
+    char c;
+    if (!readNonSpace(stream, c)) return false;
+    if (c == 'n') return true;   // null: nenhuma config
+    if (c != '{') return false;
+    
+    while (readNonSpace(stream, c)) {
+        if (c == '}') return true;
+        if (c == ',') continue;
+        if (c != '"') return false;
         
-        // Dados do último heartbeat
-        JsonObject heartbeat = bike.value()["last_heartbeat"];
-        if (!heartbeat.isNull()) {
-            bikeData["last_seen"] = heartbeat["timestamp"] | 0;
-            bikeData["battery_last"] = heartbeat["battery"] | 0;
-            bikeData["heap_last"] = heartbeat["heap"] | 0;
-            
-            uint32_t lastSeen = heartbeat["timestamp"] | 0;
-            uint32_t timeSince = now - lastSeen;
-            bikeData["seconds_since_contact"] = timeSince;
-            bikeData["is_recent"] = (timeSince < 300); // < 5min
-        } else {
-            bikeData["last_seen"] = 0;
-            bikeData["battery_last"] = 0;
-            bikeData["heap_last"] = 0;
-            bikeData["seconds_since_contact"] = 999999;
-            bikeData["is_recent"] = false;
-        }
+        char bikeId[32];
+        size_t length = stream.readBytesUntil('"', bikeId, sizeof(bikeId) - 1);
+        bikeId[length] = '\0';
+        if (!readNonSpace(stream, c) || c != ':') return false;
         
-        // Dados de visitas (para bikes pending)
-        bikeData["visit_count"] = bike.value()["visit_count"] | 0;
-        bikeData["first_seen"] = bike.value()["first_seen"] | 0;
+        DynamicJsonDocument body(1024);
+        if (deserializeJson(body, stream) != DeserializationError::Ok) return false;
+        apply(bikeId, body.as<JsonObjectConst>());
     }
+    return false;
+}
+
+// Índice {"bpr-xxxxxx": versão, ...} lido direto do stream, sem documento:
+// memória constante qualquer que seja a frota. `present` = false quando o índice é null
+template <typename Fn>
+static bool streamVersions(Stream& stream, bool& present, Fn apply) {
+    char c;
+    present = false;
+    if (!readNonSpace(stream, c)) return false;
+    if (c == 'n') return true;   // null: índice ainda não existe
+    if (c != '{') return false;
+    present = true;
+    
+    while (readNonSpace(stream, c)) {
+        if (c == '}') return true;
+        if (c == ',') continue;
+        if (c != '"') return false;
+        
+        char bikeId[32];
+        size_t length = stream.readBytesUntil('"', bikeId, sizeof(bikeId) - 1);
+        bikeId[length] = '\0';
+        if (!readNonSpace(stream, c) || c != ':') return false;
+        if (!readNonSpace(stream, c) || c < '0' || c > '9') return false;
+        
+        // Número lido à mão: o caractere que o encerra já é o separador seguinte
+        int version = 0;
+        do {
+            version = version * 10 + (c - '0');
+            if (stream.readBytes(&c, 1) != 1) return false;
+        } while (c >= '0' && c <= '9');
+        apply(bikeId, version);
+        if (c == '}') return true;
+    }
+    return false;
+}
+
+bool BikeManager::applyConfig(const char* bikeId, JsonObjectConst config) {
+    int entry = directory.insert(bikeId, strlen(bikeId));
+    if (entry < 0) {
+        Serial.printf("⚠️ No registry slot for config of %s\n", bikeId);
+        return false;
+    }
+    
+    int newVersion = config["version"] | 1;
+    int oldVersion = directory.configVersion(entry);
+    if (newVersion <= oldVersion && oldVersion != 0) return false;
+    
+    int slot = acquire(entry);
+    if (slot < 0) return false;
+    
+    bikeConfigs[slot] = String();
+    serializeJson(config, bikeConfigs[slot]);
+    markFields(slot, BikeRegistry::FIELD_CONFIG);
+    
+    // Versão nova precisa de um push novo
+    directory.setConfigVersion(entry, newVersion);
+    directory.setFlag(entry, BikeRegistry::FLAG_CONFIG_SENT, false);
+    refreshConfigPending(slot);
+    indexDirty = true;
+    markShard(slot);
+    Serial.printf("🔄 Config changed for %s: v%d → v%d\n", bikeId, oldVersion, newVersion);
+    return true;
 }
 
-// Funções de configuração (ex-BikeConfigManager)
 bool BikeManager::downloadFromFirebase() {
     HTTPClient http;
     const CentralConfig& config = configManager.getConfig();
     
-    String url = String(config.firebase.database_url) + 
-                "/bike_configs.json?auth=" + config.firebase.api_key;
+    String base = String(config.firebase.database_url);
+    String auth = String("auth=") + config.firebase.api_key;
+    
+    Serial.println("🔄 Checking bike config versions...");
+    
+    // HTTP/1.0: corpo sem chunked encoding, para ler direto do stream
+    http.useHTTP10(true);
+    
+    // Índice {bike: versão}, mantido pela Cloud Function a cada escrita em /bike_configs.
+    // Cada passada guarda só os IDs desatualizados (lote fixo) e fecha a conexão
+    // antes de buscar os corpos; lote cheio = nova passada depois de aplicá-lo
+    char stale[CONFIG_FETCH_BATCH][BikeRegistry::ID_LENGTH + 1];
+    uint8_t staleCount = 0;
+    bool more = false;
+    bool present = false;
+    auto readIndex = [&]() -> bool {
+        staleCount = 0;
+        more = false;
+        http.begin(base + "/bike_config_versions.json?" + auth);
+        int httpCode = http.GET();
+        bool ok = httpCode == HTTP_CODE_OK &&
+                  streamVersions(http.getStream(), present, [&](const char* bikeId, int remote) {
+                      int known = directory.find(bikeId, strlen(bikeId));
+                      if (known >= 0 && directory.configVersion(known) != 0 && remote <= directory.configVersion(known)) return;
+                      if (strlen(bikeId) != BikeRegistry::ID_LENGTH) return;
+                      if (staleCount == CONFIG_FETCH_BATCH) {
+                          more = true;
+                          return;
+                      }
+                      memcpy(stale[staleCount++], bikeId, BikeRegistry::ID_LENGTH + 1);
+                  });
+        http.end();
+        if (!ok) Serial.printf("❌ Failed to read config versions: HTTP %d\n", httpCode);
+        return ok;
+    };
     
-    Serial.println("🔄 Downloading bike configs from Firebase...");
+    if (!readIndex()) return false;
     
-    http.begin(url);
-    int httpCode = http.GET();
+    int changed = 0;
     
-    if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
+    if (!present) {
+        // Índice ainda não existe: baixar tudo, mas uma bike por vez
+        Serial.println("⚠️ No config version index, streaming full bike_configs");
+        http.begin(base + "/bike_configs.json?" + auth);
+        int httpCode = http.GET();
+        bool ok = httpCode == HTTP_CODE_OK &&
+                  streamConfigs(http.getStream(), [&](const char* bikeId, JsonObjectConst body) {
+                      if (applyConfig(bikeId, body)) changed++;
+                  });
+        http.end();
         
-        if (payload == "null" || payload.length() < 10) {
-            Serial.println("📝 No bike configs in Firebase");
-            http.end();
-            return true;
+        if (!ok) {
+            Serial.printf("❌ Failed to download configs: HTTP %d\n", httpCode);
+            return false;
         }
-        
-        DynamicJsonDocument newConfigs(4096);
-        if (deserializeJson(newConfigs, payload) == DeserializationError::Ok) {
-            // Integrar configs nas bikes existentes
-            JsonObjectConst obj = newConfigs.as<JsonObjectConst>();
-            for (JsonPairConst bike : obj) {
-                String bikeId = bike.key().c_str();
-                bikes[bikeId]["config"] = bike.value();
-                
-                int newVersion = bike.value()["version"] | 1;
-                int oldVersion = configVersions[bikeId]["version"] | 0;
-                
-                if (newVersion > oldVersion) {
-                    configChanged[bikeId] = true;
-                    configVersions[bikeId]["version"] = newVersion;
-                    configVersions[bikeId]["last_update"] = time(nullptr);
-                    
-                    Serial.printf("🔄 Config changed for %s: v%d → v%d\n", 
-                                 bikeId.c_str(), oldVersion, newVersion);
+    }
+    
+    while (staleCount > 0) {
+        // Só buscar o corpo das bikes cuja versão andou
+        int applied = 0;
+        for (uint8_t i = 0; i < staleCount; i++) {
+            const char* bikeId = stale[i];
+            http.begin(base + "/bike_configs/" + bikeId + ".json?" + auth);
+            int httpCode = http.GET();
+            if (httpCode == HTTP_CODE_OK) {
+                DynamicJsonDocument body(1024);
+                if (deserializeJson(body, http.getStream()) == DeserializationError::Ok && !body.isNull()) {
+                    if (applyConfig(bikeId, body.as<JsonObjectConst>())) applied++;
                 }
+            } else {
+                Serial.printf("❌ Failed to download config for %s: HTTP %d\n", bikeId, httpCode);
             }
-            
-            saveData();
-            Serial.printf("✅ Downloaded configs for %d bikes\n", newConfigs.size());
             http.end();
-            return true;
-        } else {
-            Serial.println("❌ Failed to parse bike configs");
         }
-    } else {
-        Serial.printf("❌ Failed to download configs: HTTP %d\n", httpCode);
+        changed += applied;
+        
+        // Lote sem nenhum avanço: o resto fica para a próxima sync
+        if (!more || applied == 0 || !readIndex()) break;
     }
     
-    http.end();
-    return false;
+    if (changed > 0) {
+        markDirty();
+        Serial.printf("✅ Downloaded configs for %d bikes\n", changed);
+    } else {
+        Serial.println("📝 Bike configs up to date");
+    }
+    return true;
 }
 
 bool BikeManager::hasConfigUpdate(const String& bikeId) {
-    return configChanged.find(bikeId) != configChanged.end() && configChanged[bikeId];
+    int entry = dataLoaded ? entryOf(bikeId) : -1;
+    return entry >= 0 && directory.flag(entry, BikeRegistry::FLAG_CONFIG_PENDING) &&
+           !directory.flag(entry, BikeRegistry::FLAG_CONFIG_SENT);
 }
 
 void BikeManager::markConfigSent(const String& bikeId) {
-    configChanged[bikeId] = false;
+    int entry = dataLoaded ? entryOf(bikeId) : -1;
+    if (entry >= 0) {
+        directory.setFlag(entry, BikeRegistry::FLAG_CONFIG_SENT, true);
+    }
     Serial.printf("✅ Config marked as sent for %s\n", bikeId.c_str());
 }
 
+void BikeManager::markConfigUnsent(const String& bikeId) {
+    int entry = dataLoaded ? entryOf(bikeId) : -1;
+    if (entry >= 0) {
+        directory.setFlag(entry, BikeRegistry::FLAG_CONFIG_SENT, false);
+    }
+    Serial.printf("↩️ Config for %s back to pending\n", bikeId.c_str());
+}
+
+void BikeManager::markConfigDelivered(const String& bikeId, uint16_t version) {
+    int entry = dataLoaded ? entryOf(bikeId) : -1;
+    if (entry < 0) return;
+    
+    // Bikes antigas não mandam a versão: vale a do último push (uma versão
+    // nova desde então limpa FLAG_CONFIG_SENT)
+    if (version == 0 && directory.flag(entry, BikeRegistry::FLAG_CONFIG_SENT)) {
+        version = directory.configVersion(entry);
+    }
+    if (version == 0) return;
+    
+    int slot = acquire(entry);
+    if (slot < 0) return;
+    
+    Bike& bike = cache.at(slot);
+    if (version == bike.deliveredVersion) return;
+    
+    bike.deliveredVersion = version;
+    refreshConfigPending(slot);
+    
+    // Gravar já: reiniciar antes do prazo do write-behind faria o push de novo
+    size_t written = 0;
+    uint8_t shard = directory.shard(entry);
+    if (saveShard(shard, written) && (!indexDirty || saveIndex(written))) {
+        writeStats.bytesWritten += written;
+    }
+    Serial.printf("📬 Config v%d delivered to %s\n", version, bikeId.c_str());
+}
+
 String BikeManager::getConfigForBike(const String& bikeId) {
-    if (!dataLoaded || !bikes.containsKey(bikeId) || bikes[bikeId]["config"].isNull()) {
+    int slot = acquireBike(bikeId);
+    if (slot < 0 || bikeConfigs[slot].length() == 0) {
         Serial.printf("⚠️ No config found for %s, using defaults\n", bikeId.c_str());
         return generateDefaultConfig(bikeId);
     }
     
-    DynamicJsonDocument response(1024);
-    response["type"] = "config_push";
-    response["bike_id"] = bikeId;
-    response["config"] = bikes[bikeId]["config"];
-    
+    // bikeConfigs já é JSON serializado: concatena em vez de reparsear
     String result;
-    serializeJson(response, result);
+    result.reserve(bikeConfigs[slot].length() + bikeId.length() + 48);
+    result += "{\"type\":\"config_push\",\"bike_id\":\"";
+    result += bikeId;
+    result += "\",\"config\":";
+    result += bikeConfigs[slot];
+    result += "}";
     return result;
 }
 
+uint16_t BikeManager::getConfigVersion(const String& bikeId) {
+    int entry = dataLoaded ? entryOf(bikeId) : -1;
+    return entry < 0 ? 0 : directory.configVersion(entry);
+}
+
 String BikeManager::generateDefaultConfig(const String& bikeId) {
-    DynamicJsonDocument response(1024);
-    response["type"] = "config_push";
-    response["bike_id"] = bikeId;
-    
-    // Config padrão
-    response["config"]["version"] = 1;
-    response["config"]["bike_name"] = "Bike " + bikeId;
-    response["config"]["dev_mode"] = false;
-    
-    response["config"]["wifi"]["scan_interval_sec"] = 300;
-    response["config"]["wifi"]["scan_timeout_ms"] = 5000;
-    
-    response["config"]["ble"]["base_name"] = "BPR Hub Station";
-    response["config"]["ble"]["scan_time_sec"] = 5;
+    // Defaults são iguais para toda bike exceto o ID: serializa uma vez com
+    // um marcador e só substitui o ID nas chamadas seguintes
+    static const char* PLACEHOLDER = "@@BIKE_ID@@";
+    static String defaultTemplate;
     
-    response["config"]["power"]["deep_sleep_duration_sec"] = 3600;
-    
-    response["config"]["battery"]["critical_voltage"] = 3.2;
-    response["config"]["battery"]["low_voltage"] = 3.45;
+    if (defaultTemplate.length() == 0) {
+        DynamicJsonDocument response(1024);
+        response["type"] = "config_push";
+        response["bike_id"] = PLACEHOLDER;
+        
+        // Config padrão
+        response["config"]["version"] = 1;
+        response["config"]["bike_name"] = String("Bike ") + PLACEHOLDER;
+        response["config"]["dev_mode"] = false;
+        
+        response["config"]["wifi"]["scan_interval_sec"] = 300;
+        response["config"]["wifi"]["scan_timeout_ms"] = 5000;
+        
+        response["config"]["ble"]["base_name"] = "BPR Hub Station";
+        response["config"]["ble"]["scan_time_sec"] = 5;
+        
+        response["config"]["power"]["deep_sleep_duration_sec"] = 3600;
+        
+        response["config"]["battery"]["critical_voltage"] = 3.2;
+        response["config"]["battery"]["low_voltage"] = 3.45;
+        
+        serializeJson(response, defaultTemplate);
+    }
     
-    String result;
-    serializeJson(response, result);
+    String result = defaultTemplate;
+    result.replace(PLACEHOLDER, bikeId);
     return result;
 }
 
 std::vector<String> BikeManager::getBikesWithUpdates() {
     std::vector<String> bikes_list;
-    for (auto& pair : configChanged) {
-        if (pair.second) {
-            bikes_list.push_back(pair.first);
+    char id[BikeRegistry::ID_LENGTH + 1];
+    for (size_t entry = 0; entry < directory.size(); entry++) {
+        if (directory.flag(entry, BikeRegistry::FLAG_CONFIG_PENDING) &&
+            !directory.flag(entry, BikeRegistry::FLAG_CONFIG_SENT)) {
+            directory.id(entry, id);
+            bikes_list.push_back(id);
         }
     }
     return bikes_list;
-}
\ No newline at end of file
+}
@@ -1,11 +1,11 @@
 #include "bike_pairing.h"
 #include <ArduinoJson.h>
-#include <queue>
 #include "constants.h"
 #include "buffer_manager.h"
 #include "led_controller.h"
 #include "bike_manager.h"
 #include "ble_server.h"
+#include "wire_format.h"
 
 extern BufferManager bufferManager;
 extern LEDController ledController;
@@ -16,11 +16,25 @@ static PairingStatus currentStatus = PAIRING_IDLE;
 static uint32_t lastActivity = 0;
 static uint32_t busyTimeout = 10000; // 10 segundos para considerar idle
 
-// Sistema de fila sequencial
-static std::queue<String> dataQueue;
-static String currentBike = "";
-static uint32_t requestTimeout = 0;
-static const uint32_t BIKE_TIMEOUT_MS = 30000; // 30s timeout por bike
+// Tabela de sessões de ingestão, uma por conexão BLE
+enum SessionState : uint8_t {
+    SESSION_FREE,
+    SESSION_IDLE,            // conectada, nada pendente
+    SESSION_DATA_PENDING     // registros recebidos ainda não processados
+};
+
+struct IngestSession {
+    char bikeId[BIKE_ID_LENGTH + 1];
+    SessionState state;
+    bool connected;          // desconectada: drena o pendente e libera
+    uint8_t* payload;        // registros [len:2][bytes] (WireFormat ou JSON), em ordem
+    uint16_t used;
+    uint16_t capacity;
+    uint32_t deadline;
+};
+
+static IngestSession sessions[MAX_BIKE_SESSIONS];
+static uint8_t nextSession = 0;   // cursor do round-robin
 
 void BikePairing::enter()
 {
@@ -47,8 +61,11 @@ void BikePairing::update()
 {
     uint32_t now = millis();
 
-    // Processar fila de dados sequencialmente
-    processDataQueue();
+    // Eventos BLE enfileirados pelos callbacks do NimBLE
+    BPRBLEServer::poll();
+
+    // Uma volta do round-robin pelas sessões
+    processSessions();
 
     // Heartbeat local (só para debug de bikes conectadas)
     if (now - lastHeartbeat > HEARTBEAT_INTERVAL)
@@ -67,14 +84,99 @@ void BikePairing::update()
     }
 }
 
+static IngestSession* findSession(const String& bikeId)
+{
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        if (sessions[i].state != SESSION_FREE && bikeId == sessions[i].bikeId) return &sessions[i];
+    }
+    return nullptr;
+}
+
+static IngestSession* openSession(const String& bikeId)
+{
+    IngestSession* session = findSession(bikeId);
+    if (session) {
+        session->connected = true;
+        return session;
+    }
+
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        if (sessions[i].state != SESSION_FREE) continue;
+        session = &sessions[i];
+        strncpy(session->bikeId, bikeId.c_str(), BIKE_ID_LENGTH);
+        session->bikeId[BIKE_ID_LENGTH] = '\0';
+        session->state = SESSION_IDLE;
+        session->connected = true;
+        session->used = 0;
+        session->deadline = millis() + BIKE_SESSION_TIMEOUT_MS;
+        Serial.printf("🧵 Session opened for %s (slot %d)\n", session->bikeId, i);
+        return session;
+    }
+    return nullptr;
+}
+
+static void closeSession(IngestSession& session)
+{
+    Serial.printf("✅ Session closed for %s\n", session.bikeId);
+    session.state = SESSION_FREE;
+    session.bikeId[0] = '\0';
+    free(session.payload);
+    session.payload = nullptr;
+    session.used = 0;
+    session.capacity = 0;
+}
+
+static const size_t RECORD_PREFIX = 2;
+
+static bool appendRecord(IngestSession& session, const uint8_t* data, size_t length)
+{
+    size_t needed = session.used + RECORD_PREFIX + length;
+    if (needed > BIKE_SESSION_PAYLOAD_MAX) return false;
+    if (needed > session.capacity) {
+        size_t capacity = session.capacity ? session.capacity : 256;
+        while (capacity < needed) capacity *= 2;
+        if (capacity > BIKE_SESSION_PAYLOAD_MAX) capacity = BIKE_SESSION_PAYLOAD_MAX;
+        uint8_t* grown = (uint8_t*)realloc(session.payload, capacity);
+        if (!grown) return false;
+        session.payload = grown;
+        session.capacity = capacity;
+    }
+    session.payload[session.used] = length & 0xFF;
+    session.payload[session.used + 1] = length >> 8;
+    memcpy(session.payload + session.used + RECORD_PREFIX, data, length);
+    session.used += RECORD_PREFIX + length;
+    return true;
+}
+
+// Processa o registro mais antigo da sessão; false se não havia nenhum
+static bool processNextRecord(IngestSession& session)
+{
+    if (session.state != SESSION_DATA_PENDING) return false;
+
+    size_t length = session.payload[0] | (session.payload[1] << 8);
+    BikePairing::processDataFromBike(session.bikeId, session.payload + RECORD_PREFIX, length);
+
+    size_t consumed = RECORD_PREFIX + length;
+    memmove(session.payload, session.payload + consumed, session.used - consumed);
+    session.used -= consumed;
+    if (session.used == 0) session.state = SESSION_IDLE;
+    return true;
+}
+
+static void drainSession(IngestSession& session)
+{
+    while (processNextRecord(session)) {}
+}
+
 void BikePairing::exit()
 {
-    // Limpar fila ao sair
-    while (!dataQueue.empty()) {
-        dataQueue.pop();
+    // Nada recebido se perde: drenar as sessões antes de derrubar o BLE
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        if (sessions[i].state == SESSION_FREE) continue;
+        drainSession(sessions[i]);
+        closeSession(sessions[i]);
     }
-    currentBike = "";
-    requestTimeout = 0;
+    nextSession = 0;
     
     BPRBLEServer::stop();
     currentStatus = PAIRING_IDLE;
@@ -102,16 +204,19 @@ void BikePairing::sendHeartbeat()
     // Estatísticas calculadas
     heartbeat["total_bikes"] = bikes.size();
     heartbeat["bikes_connected_now"] = BPRBLEServer::getConnectedBikes();
-    heartbeat["bikes_allowed"] = BikeManager::getAllowedCount();
-    heartbeat["bikes_pending"] = BikeManager::getPendingCount();
-    heartbeat["bikes_with_recent_contact"] = BikeManager::getConnectedCount();
+    // Contadores mantidos incrementalmente pelo BikeManager
+    int allowed = BikeManager::getAllowedCount();
+    int pending = BikeManager::getPendingCount();
+    int recent = BikeManager::getConnectedCount();
+    heartbeat["bikes_allowed"] = allowed;
+    heartbeat["bikes_pending"] = pending;
+    heartbeat["bikes_with_recent_contact"] = recent;
     
     // Salvar no LittleFS
     bufferManager.addBikeData("heartbeat", heartbeat.as<String>());
     
     Serial.printf("💓 Heartbeat: %d total, %d allowed, %d pending, %d recent\n", 
-                  (int)bikes.size(), BikeManager::getAllowedCount(), 
-                  BikeManager::getPendingCount(), BikeManager::getConnectedCount());
+                  (int)bikes.size(), allowed, pending, recent);
 }
 
 PairingStatus BikePairing::getStatus()
@@ -148,11 +253,10 @@ void BPRBLEServer::onBikeConnected(const String& bikeId) {
         currentStatus = PAIRING_SENDING_CONFIG;
         lastActivity = millis();
         
-        String config = BikeManager::getConfigForBike(bikeId);
-        BPRBLEServer::pushConfigToBike(bikeId, config);
-        BikeManager::markConfigSent(bikeId);
-        
-        Serial.printf("⚙️ Config sent to %s on connection\n", bikeId.c_str());
+        if (BPRBLEServer::pushBikeConfig(bikeId)) {
+            BikeManager::markConfigSent(bikeId);
+            Serial.printf("⚙️ Config sent to %s on connection\n", bikeId.c_str());
+        }
     } else {
         Serial.printf("📝 No config update for %s - skipping\n", bikeId.c_str());
     }
@@ -161,13 +265,16 @@ void BPRBLEServer::onBikeConnected(const String& bikeId) {
 void BPRBLEServer::onBikeDisconnected(const String& bikeId) {
     ledController.bikeLeftPattern();
     if (!bikeId.isEmpty()) {
+        // Registros já recebidos ainda são processados; a sessão sai depois
+        IngestSession* session = findSession(bikeId);
+        if (session) session->connected = false;
         Serial.printf("🚲 Bike %s disconnected - LED pattern triggered\n", bikeId.c_str());
     } else {
         Serial.printf("🚲 Device disconnected - LED pattern triggered\n");
     }
 }
 
-void BPRBLEServer::onBikeDataReceived(const String& bikeId, const String& jsonData) {
+void BPRBLEServer::onBikeDataReceived(const String& bikeId, const uint8_t* data, size_t length) {
     // Validações rápidas primeiro
     if (!BikeManager::canConnect(bikeId)) {
         Serial.printf("❌ Data rejected from blocked bike: %s\n", bikeId.c_str());
@@ -180,152 +287,158 @@ void BPRBLEServer::onBikeDataReceived(const String& bikeId, const String& jsonDa
         return;
     }
     
-    // Sistema de fila sequencial
-    if (currentBike.isEmpty()) {
-        // Nenhuma bike processando - processar imediatamente
-        BikePairing::processDataFromBike(bikeId, jsonData);
-    } else if (currentBike == bikeId) {
-        // Bike atual enviando mais dados - processar
-        BikePairing::processDataFromBike(bikeId, jsonData);
-    } else {
-        // Outra bike tentando enviar - enfileirar
-        Serial.printf("📋 Bike %s enqueued (current: %s)\n", bikeId.c_str(), currentBike.c_str());
-        BikePairing::enqueueBike(bikeId, jsonData);
+    IngestSession* session = openSession(bikeId);
+    if (!session) {
+        // Mais bikes que conexões possíveis não deveria acontecer; não perder o dado
+        Serial.printf("⚠️ No free session for %s - processing inline\n", bikeId.c_str());
+        BikePairing::processDataFromBike(bikeId, data, length);
+        return;
+    }
+    
+    // Sessão com backlog grande demais: drena antes de aceitar mais
+    if (!appendRecord(*session, data, length)) {
+        Serial.printf("⚠️ Session backlog full for %s - draining\n", bikeId.c_str());
+        drainSession(*session);
+        if (!appendRecord(*session, data, length)) {
+            // Registro maior que o backlog inteiro (ou sem heap): processa já
+            BikePairing::processDataFromBike(bikeId, data, length);
+            return;
+        }
     }
+    session->state = SESSION_DATA_PENDING;
+    session->deadline = millis() + BIKE_SESSION_TIMEOUT_MS;
+    
+    currentStatus = PAIRING_RECEIVING_DATA;
+    lastActivity = millis();
 }
 
-void BPRBLEServer::onConfigRequest(const String& bikeId, const String& request) {
+void BPRBLEServer::onConfigRequest(const String& bikeId, const uint8_t* request, size_t length) {
     // Marcar atividade de configuração
     currentStatus = PAIRING_SENDING_CONFIG;
     lastActivity = millis();
     
-    DynamicJsonDocument doc(256);
-    DeserializationError error = deserializeJson(doc, request);
-    
-    if (error) {
-        Serial.printf("❌ Config request parse error: %s\n", error.c_str());
-        currentStatus = PAIRING_IDLE;
-        return;
+    // Binário: tipo no cabeçalho; JSON (bike antiga): campo "type"
+    String type;
+    String status;
+    uint16_t version = 0;
+    if (WireFormat::isMessage(request, length)) {
+        WireFormat::Reader reader(request, length);
+        if (reader.valid()) type = WireFormat::typeName(reader.type());
+        uint32_t value;
+        if (WireFormat::findUint(request, length, WireFormat::TAG_STATUS, value)) {
+            status = value == WireFormat::STATUS_OK ? "ok" : "error";
+        }
+        if (WireFormat::findUint(request, length, WireFormat::TAG_VERSION, value)) version = value;
+    } else {
+        DynamicJsonDocument doc(256);
+        DeserializationError error = deserializeJson(doc, (const char*)request, length);
+        if (error) {
+            Serial.printf("❌ Config request parse error: %s\n", error.c_str());
+            currentStatus = PAIRING_IDLE;
+            return;
+        }
+        type = doc["type"] | "";
+        status = doc["status"] | "";
+        version = doc["version"] | 0;
     }
     
-    String type = doc["type"] | "";
-    
     if (type == "config_request") {
         Serial.printf("📝 Config request from %s\n", bikeId.c_str());
         
         if (BikeManager::hasConfigUpdate(bikeId)) {
-            String config = BikeManager::getConfigForBike(bikeId);
-            BPRBLEServer::pushConfigToBike(bikeId, config);
-            BikeManager::markConfigSent(bikeId);
-            Serial.printf("⚙️ Config sent to %s\n", bikeId.c_str());
+            if (BPRBLEServer::pushBikeConfig(bikeId)) {
+                BikeManager::markConfigSent(bikeId);
+                Serial.printf("⚙️ Config sent to %s\n", bikeId.c_str());
+            }
         } else {
             Serial.printf("📝 No config update for %s\n", bikeId.c_str());
             currentStatus = PAIRING_IDLE; // Sem config = idle
         }
     } else if (type == "config_received") {
-        String status = doc["status"] | "";
         Serial.printf("📋 Config confirmation from %s: %s\n", bikeId.c_str(), status.c_str());
+        if (status == "ok") {
+            BikeManager::markConfigDelivered(bikeId, version);
+        }
         currentStatus = PAIRING_IDLE; // Confirmação recebida = idle
     }
 }
 
 // Funções auxiliares removidas - dados vêm do BikeRegistry::populateHeartbeatData()
 
-// Funções da fila sequencial
-void BikePairing::processDataQueue() {
+// Sessões de ingestão
+void BikePairing::processSessions() {
     uint32_t now = millis();
+    bool busy = false;
     
-    // Verificar timeout da bike atual
-    if (!currentBike.isEmpty() && (now - requestTimeout) > BIKE_TIMEOUT_MS) {
-        Serial.printf("⏰ Timeout for bike %s - processing next\n", currentBike.c_str());
-        finishCurrentBike();
-    }
-    
-    // Se não há bike atual e há fila, processar próxima
-    if (currentBike.isEmpty() && !dataQueue.empty()) {
-        String nextBike = dataQueue.front();
-        dataQueue.pop();
+    // Um registro por sessão por volta, começando de onde a anterior parou
+    for (uint8_t n = 0; n < MAX_BIKE_SESSIONS; n++) {
+        IngestSession& session = sessions[(nextSession + n) % MAX_BIKE_SESSIONS];
+        if (session.state == SESSION_FREE) continue;
+        
+        if (processNextRecord(session)) {
+            busy = busy || session.state == SESSION_DATA_PENDING;
+            continue;
+        }
+        
+        // Desconectada e sem nada pendente
+        if (!session.connected) {
+            closeSession(session);
+            continue;
+        }
         
-        Serial.printf("🎯 Processing next bike from queue: %s\n", nextBike.c_str());
-        requestDataFromBike(nextBike);
+        if ((int32_t)(now - session.deadline) < 0) continue;
+        
+        // Desconexão perdida: a sessão não pode ocupar o slot para sempre
+        if (!BPRBLEServer::isBikeConnected(session.bikeId)) {
+            closeSession(session);
+            continue;
+        }
+        session.deadline = now + BIKE_SESSION_TIMEOUT_MS;
     }
-}
-
-void BikePairing::requestDataFromBike(const String& bikeId) {
-    currentBike = bikeId;
-    requestTimeout = millis();
-    currentStatus = PAIRING_RECEIVING_DATA;
-    lastActivity = millis();
-    
-    // Enviar comando para bike enviar dados
-    DynamicJsonDocument cmd(256);
-    cmd["type"] = "data_request";
-    cmd["bike_id"] = bikeId;
-    
-    String cmdStr;
-    serializeJson(cmd, cmdStr);
-    BPRBLEServer::pushConfigToBike(bikeId, cmdStr);
+    nextSession = (nextSession + 1) % MAX_BIKE_SESSIONS;
     
-    Serial.printf("📤 Data request sent to %s\n", bikeId.c_str());
+    if (!busy && currentStatus == PAIRING_RECEIVING_DATA) {
+        currentStatus = PAIRING_IDLE;
+    }
 }
 
-void BikePairing::processDataFromBike(const String& bikeId, const String& jsonData) {
-    currentBike = bikeId;
-    requestTimeout = millis();
-    currentStatus = PAIRING_RECEIVING_DATA;
+void BikePairing::processDataFromBike(const String& bikeId, const uint8_t* data, size_t length) {
     lastActivity = millis();
     
     Serial.printf("📥 Processing data from %s\n", bikeId.c_str());
     
-    // Parse para atualizar heartbeat
-    DynamicJsonDocument doc(512);
-    if (deserializeJson(doc, jsonData) == DeserializationError::Ok) {
-        if (doc["battery"] && doc["heap"]) {
-            BikeManager::updateHeartbeat(bikeId, doc["battery"], doc["heap"]);
+    if (WireFormat::isMessage(data, length)) {
+        // Binário: campos lidos direto, sem parse; vai para o buffer como chegou
+        uint32_t battery, heap;
+        if (WireFormat::findUint(data, length, WireFormat::TAG_BATTERY_PCT, battery) &&
+            WireFormat::findUint(data, length, WireFormat::TAG_HEAP, heap)) {
+            BikeManager::updateHeartbeat(bikeId, battery, heap);
+        }
+        bufferManager.addBikeMessage(bikeId, data, length);
+    } else {
+        // Bike antiga: registro JSON
+        String jsonData;
+        jsonData.concat((const char*)data, length);
+        
+        // Parse para atualizar heartbeat
+        DynamicJsonDocument doc(512);
+        if (deserializeJson(doc, jsonData) == DeserializationError::Ok) {
+            if (doc["battery"] && doc["heap"]) {
+                BikeManager::updateHeartbeat(bikeId, doc["battery"], doc["heap"]);
+            }
         }
+        
+        // Processar dados via BufferManager
+        bufferManager.addBikeData(bikeId, jsonData);
     }
     
-    // Processar dados via BufferManager
-    bufferManager.addBikeData(bikeId, jsonData);
-    
     // Verificar se tem config nova para enviar
     if (BikeManager::hasConfigUpdate(bikeId)) {
         currentStatus = PAIRING_SENDING_CONFIG;
         
-        String config = BikeManager::getConfigForBike(bikeId);
-        BPRBLEServer::pushConfigToBike(bikeId, config);
-        BikeManager::markConfigSent(bikeId);
-        
-        Serial.printf("⚙️ Config sent to %s\n", bikeId.c_str());
-    }
-    
-    // Finalizar processamento desta bike
-    finishCurrentBike();
-}
-
-void BikePairing::enqueueBike(const String& bikeId, const String& jsonData) {
-    // Verificar se bike já está na fila
-    std::queue<String> tempQueue = dataQueue;
-    while (!tempQueue.empty()) {
-        if (tempQueue.front() == bikeId) {
-            Serial.printf("📋 Bike %s already in queue\n", bikeId.c_str());
-            return;
+        if (BPRBLEServer::pushBikeConfig(bikeId)) {
+            BikeManager::markConfigSent(bikeId);
+            Serial.printf("⚙️ Config sent to %s\n", bikeId.c_str());
         }
-        tempQueue.pop();
     }
-    
-    // Adicionar à fila
-    dataQueue.push(bikeId);
-    Serial.printf("📋 Bike %s added to queue (size: %d)\n", bikeId.c_str(), (int)dataQueue.size());
 }
-
-void BikePairing::finishCurrentBike() {
-    if (!currentBike.isEmpty()) {
-        Serial.printf("✅ Finished processing bike %s\n", currentBike.c_str());
-        currentBike = "";
-        requestTimeout = 0;
-        currentStatus = PAIRING_IDLE;
-    }
-}
-
-// Funções auxiliares removidas - lógica consolidada no BikeRegistry
\ No newline at end of file
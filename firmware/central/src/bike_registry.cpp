@@ -0,0 +1,314 @@
+#include "bike_registry.h"
+#include <string.h>
+
+namespace BikeRegistry {
+
+    static const char* const STATUS_NAMES[] = { "unknown", "pending", "allowed", "blocked" };
+    // Mesmos nomes que já existiam em config_log no Firebase
+    static const char* const EVENT_NAMES[] = {
+        "unknown", "config_updated", "config_sent", "config_delivered", "config_rejected"
+    };
+    static const uint8_t EVENT_LAST = EVENT_CONFIG_REJECTED;
+
+    static void putU16(uint8_t* p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+    }
+
+    static void putU32(uint8_t* p, uint32_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = (v >> 24) & 0xFF;
+    }
+
+    static uint16_t getU16(const uint8_t* p) {
+        return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+    }
+
+    static uint32_t getU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+               ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    bool isValidId(const char* id, size_t length) {
+        return length == ID_LENGTH && memcmp(id, "bpr-", 4) == 0;
+    }
+
+    const char* statusName(uint8_t status) {
+        return status <= STATUS_BLOCKED ? STATUS_NAMES[status] : STATUS_NAMES[STATUS_UNKNOWN];
+    }
+
+    uint8_t parseStatus(const char* name) {
+        if (!name) return STATUS_UNKNOWN;
+        for (uint8_t i = STATUS_PENDING; i <= STATUS_BLOCKED; i++) {
+            if (strcmp(name, STATUS_NAMES[i]) == 0) return i;
+        }
+        return STATUS_UNKNOWN;
+    }
+
+    const char* eventName(uint8_t event) {
+        event &= ~EVENT_SUCCESS;
+        return event <= EVENT_LAST ? EVENT_NAMES[event] : EVENT_NAMES[EVENT_UNKNOWN];
+    }
+
+    uint8_t parseEvent(const char* name) {
+        if (!name) return EVENT_UNKNOWN;
+        for (uint8_t i = EVENT_CONFIG_UPDATED; i <= EVENT_LAST; i++) {
+            if (strcmp(name, EVENT_NAMES[i]) == 0) return i;
+        }
+        return EVENT_UNKNOWN;
+    }
+
+    void ConfigLog::add(uint32_t timestamp, uint8_t event, bool success) {
+        timestamps[head] = timestamp;
+        codes[head] = (event & ~EVENT_SUCCESS) | (success ? EVENT_SUCCESS : 0);
+        head = (head + 1) % CONFIG_LOG_SIZE;
+        if (count < CONFIG_LOG_SIZE) count++;
+    }
+
+    size_t ConfigLog::encode(uint8_t* out) const {
+        out[0] = count;
+        uint8_t* p = out + 1;
+        for (size_t i = 0; i < count; i++, p += CONFIG_LOG_ENTRY_SIZE) {
+            putU32(p, timestamps[slot(i)]);
+            p[4] = codes[slot(i)];
+        }
+        return 1 + count * CONFIG_LOG_ENTRY_SIZE;
+    }
+
+    bool ConfigLog::decode(const uint8_t* in, size_t length) {
+        clear();
+        if (length < 1 || in[0] > CONFIG_LOG_SIZE || length < 1 + in[0] * CONFIG_LOG_ENTRY_SIZE) return false;
+
+        const uint8_t* p = in + 1;
+        for (size_t i = 0; i < in[0]; i++, p += CONFIG_LOG_ENTRY_SIZE) {
+            timestamps[i] = getU32(p);
+            codes[i] = p[4];
+        }
+        count = in[0];
+        head = count % CONFIG_LOG_SIZE;
+        return true;
+    }
+
+    RecentContacts::RecentContacts() {
+        clear();
+    }
+
+    void RecentContacts::clear() {
+        memset(bucketId, 0, sizeof(bucketId));
+        memset(bucketCount, 0, sizeof(bucketCount));
+    }
+
+    void RecentContacts::add(uint32_t timestamp) {
+        if (timestamp == 0) return;
+
+        uint32_t id = timestamp / RECENT_BUCKET_SEC;
+        size_t i = id % RECENT_BUCKETS;
+        if (bucketId[i] != id) {
+            // Balde mais novo que o ocupante: o ocupante já saiu da janela
+            if (bucketId[i] > id) return;
+            bucketId[i] = id;
+            bucketCount[i] = 0;
+        }
+        bucketCount[i]++;
+    }
+
+    void RecentContacts::remove(uint32_t timestamp) {
+        if (timestamp == 0) return;
+
+        uint32_t id = timestamp / RECENT_BUCKET_SEC;
+        size_t i = id % RECENT_BUCKETS;
+        if (bucketId[i] == id && bucketCount[i] > 0) bucketCount[i]--;
+    }
+
+    uint16_t RecentContacts::count(uint32_t now) const {
+        uint32_t current = now / RECENT_BUCKET_SEC;
+        uint16_t total = 0;
+        for (size_t i = 0; i < RECENT_BUCKETS; i++) {
+            if (bucketId[i] <= current && bucketId[i] + RECENT_BUCKETS > current) total += bucketCount[i];
+        }
+        return total;
+    }
+
+    static uint32_t fnv1a(const char* key) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < KEY_LENGTH; i++) {
+            h ^= (uint8_t)key[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    uint8_t shardOf(const char* id) {
+        // Bits altos do hash: os baixos já endereçam o índice do Directory
+        return (fnv1a(id + 4) >> 24) & (SHARD_COUNT - 1);
+    }
+
+    Directory::Directory() {
+        clear();
+    }
+
+    void Directory::clear() {
+        memset(index, 0, sizeof(index));
+        memset(statusBits, 0, sizeof(statusBits));
+        memset(flags, 0, sizeof(flags));
+        memset(configVersions, 0, sizeof(configVersions));
+        memset(byStatus, 0, sizeof(byStatus));
+        count = 0;
+    }
+
+    uint32_t Directory::hash(const char* key) {
+        return fnv1a(key);
+    }
+
+    int Directory::find(const char* id, size_t length) const {
+        if (!isValidId(id, length)) return -1;
+        const char* key = id + 4;
+
+        // Sondagem linear; sem remoção individual, o primeiro vazio encerra a busca
+        for (size_t i = hash(key) & (INDEX_SIZE - 1), probes = 0; probes < INDEX_SIZE;
+             i = (i + 1) & (INDEX_SIZE - 1), probes++) {
+            if (index[i] == 0) return -1;
+            int entry = index[i] - 1;
+            if (memcmp(keys[entry], key, KEY_LENGTH) == 0) return entry;
+        }
+        return -1;
+    }
+
+    int Directory::insert(const char* id, size_t length) {
+        if (!isValidId(id, length)) return -1;
+        const char* key = id + 4;
+
+        size_t i = hash(key) & (INDEX_SIZE - 1);
+        while (index[i] != 0) {
+            int entry = index[i] - 1;
+            if (memcmp(keys[entry], key, KEY_LENGTH) == 0) return entry;
+            i = (i + 1) & (INDEX_SIZE - 1);
+        }
+        if (count >= CAPACITY) return -1;
+
+        int entry = count++;
+        memcpy(keys[entry], key, KEY_LENGTH);
+        index[i] = entry + 1;
+        byStatus[STATUS_UNKNOWN]++;
+        return entry;
+    }
+
+    void Directory::id(int entry, char* out) const {
+        memcpy(out, "bpr-", 4);
+        memcpy(out + 4, keys[entry], KEY_LENGTH);
+        out[ID_LENGTH] = '\0';
+    }
+
+    uint8_t Directory::shard(int entry) const {
+        return (fnv1a(keys[entry]) >> 24) & (SHARD_COUNT - 1);
+    }
+
+    void Directory::setStatus(int entry, uint8_t value) {
+        if (value > STATUS_BLOCKED) value = STATUS_UNKNOWN;
+        uint8_t shift = (entry & 3) * 2;
+        byStatus[status(entry)]--;
+        byStatus[value]++;
+        statusBits[entry >> 2] = (statusBits[entry >> 2] & ~(0x03 << shift)) | (value << shift);
+    }
+
+    void Directory::setFlag(int entry, uint8_t flag, bool on) {
+        if (on) flags[entry] |= flag;
+        else flags[entry] &= ~flag;
+    }
+
+    void Directory::encodeEntry(int entry, uint8_t* out) const {
+        memcpy(out, keys[entry], KEY_LENGTH);
+        out[KEY_LENGTH] = status(entry) | ((flags[entry] & PERSISTED_FLAGS) << 2);
+        putU16(out + KEY_LENGTH + 1, configVersions[entry]);
+    }
+
+    int Directory::decodeEntry(const uint8_t* in) {
+        char id[ID_LENGTH];
+        memcpy(id, "bpr-", 4);
+        memcpy(id + 4, in, KEY_LENGTH);
+
+        int entry = insert(id, ID_LENGTH);
+        if (entry < 0) return -1;
+
+        setStatus(entry, in[KEY_LENGTH] & 0x03);
+        flags[entry] = (in[KEY_LENGTH] >> 2) & PERSISTED_FLAGS;
+        configVersions[entry] = getU16(in + KEY_LENGTH + 1);
+        return entry;
+    }
+
+    Cache::Cache() {
+        clear();
+    }
+
+    void Cache::clear() {
+        for (size_t i = 0; i < CACHE_SIZE; i++) {
+            entries[i] = -1;
+            lastUse[i] = 0;
+        }
+        tick = 0;
+    }
+
+    int Cache::find(int entry) const {
+        // Working set pequeno: varredura linear é mais barata que outro índice
+        for (size_t i = 0; i < CACHE_SIZE; i++) {
+            if (entries[i] == entry) return i;
+        }
+        return -1;
+    }
+
+    int Cache::victim() const {
+        int best = -1;
+        for (size_t i = 0; i < CACHE_SIZE; i++) {
+            if (entries[i] < 0) return i;
+            if (bikes[i].uploadFields != 0) continue;
+            if (best < 0 || lastUse[i] < lastUse[best]) best = i;
+        }
+        return best;
+    }
+
+    void Cache::bind(int slot, int entry) {
+        entries[slot] = entry;
+        touch(slot);
+    }
+
+    void Cache::release(int slot) {
+        entries[slot] = -1;
+        lastUse[slot] = 0;
+    }
+
+    void encodeRecord(const Bike& bike, uint8_t status, uint16_t configVersion, uint8_t* out) {
+        memcpy(out, bike.id, ID_LENGTH);
+        out[10] = status;
+        putU16(out + 11, bike.visitCount);
+        putU16(out + 13, (uint16_t)bike.battery);
+        putU32(out + 15, bike.heap);
+        putU32(out + 19, bike.firstSeen);
+        putU32(out + 23, bike.lastVisit);
+        putU32(out + 27, bike.lastHeartbeat);
+        putU16(out + 31, configVersion);
+        putU16(out + 33, bike.deliveredVersion);
+    }
+
+    bool decodeRecord(const uint8_t* in, size_t size, Bike& bike, uint8_t& status, uint16_t& configVersion) {
+        memset(&bike, 0, sizeof(bike));
+        if (size != RECORD_SIZE && size != LEGACY_RECORD_SIZE) return false;
+        memcpy(bike.id, in, ID_LENGTH);
+        if (!isValidId(bike.id, ID_LENGTH)) return false;
+
+        status = in[10] <= STATUS_BLOCKED ? in[10] : STATUS_UNKNOWN;
+        bike.visitCount = getU16(in + 11);
+        bike.battery = (int16_t)getU16(in + 13);
+        bike.heap = getU32(in + 15);
+        bike.firstSeen = getU32(in + 19);
+        bike.lastVisit = getU32(in + 23);
+        bike.lastHeartbeat = getU32(in + 27);
+        configVersion = 0;
+        if (size == RECORD_SIZE) {
+            configVersion = getU16(in + 31);
+            bike.deliveredVersion = getU16(in + 33);
+        }
+        return true;
+    }
+}
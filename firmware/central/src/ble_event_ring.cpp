@@ -0,0 +1,73 @@
+#include "ble_event_ring.h"
+#include <string.h>
+
+namespace BleEvents {
+
+    Ring::Ring() : head(0), tail(0), pushed(0), dropped(0), highWater(0) {}
+
+    bool Ring::push(uint8_t type, uint16_t connHandle, const uint8_t* data, size_t length) {
+        Event* event = reserve(type, connHandle, length);
+        if (!event) return false;
+        if (length > 0) memcpy(event->data, data, length);
+        commit();
+        return true;
+    }
+
+    Event* Ring::reserve(uint8_t type, uint16_t connHandle, size_t length) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t used = h - tail.load(std::memory_order_acquire);
+
+        if (used >= SLOT_COUNT || length > MAX_PAYLOAD) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Event& event = slots[h & (SLOT_COUNT - 1)];
+        event.type = type;
+        event.connHandle = connHandle;
+        event.length = (uint16_t)length;
+        return &event;
+    }
+
+    void Ring::commit() {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t used = h - tail.load(std::memory_order_acquire);
+
+        // release: o consumidor só enxerga o slot depois dos bytes copiados
+        head.store(h + 1, std::memory_order_release);
+
+        pushed.fetch_add(1, std::memory_order_relaxed);
+        if (used + 1 > highWater.load(std::memory_order_relaxed)) {
+            highWater.store((uint16_t)(used + 1), std::memory_order_relaxed);
+        }
+    }
+
+    const Event* Ring::front() const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) return nullptr;
+        return &slots[t & (SLOT_COUNT - 1)];
+    }
+
+    void Ring::pop() {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) return;
+        // release: o produtor só reusa o slot depois que o consumidor terminou
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    size_t Ring::size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    void Ring::clear() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    Stats Ring::stats() const {
+        Stats s;
+        s.pushed = pushed.load(std::memory_order_relaxed);
+        s.dropped = dropped.load(std::memory_order_relaxed);
+        s.highWater = highWater.load(std::memory_order_relaxed);
+        return s;
+    }
+}
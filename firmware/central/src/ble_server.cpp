@@ -3,147 +3,777 @@
 #include <ArduinoJson.h>
 #include "constants.h"
 #include "bike_manager.h"
+#include "ble_event_ring.h"
+#include "ble_transfer.h"
+#include "wire_format.h"
+#include <string>
 
 // Static members
 NimBLEServer *BPRBLEServer::pServer = nullptr;
-NimBLEService *BPRBLEServer::pService = nullptr;
-NimBLECharacteristic *BPRBLEServer::pDataChar = nullptr;
-NimBLECharacteristic *BPRBLEServer::pConfigChar = nullptr;
+uint16_t BPRBLEServer::dataValueHandle = 0;
+uint16_t BPRBLEServer::configValueHandle = 0;
 uint8_t BPRBLEServer::connectedBikes = 0;
 std::map<uint16_t, String> BPRBLEServer::connectedDevices;
 
+// Callbacks do NimBLE só copiam handle + bytes para cá; poll() no loop
+// principal faz o resto. connectedDevices e connectedBikes são só do loop
+static BleEvents::Ring bleEvents;
+
+// Remontagem de transferências em blocos, uma por bike. Sobrevive à
+// desconexão por TRANSFER_RESUME_MS para a bike retomar do último ACK
+static const uint16_t NO_CONNECTION = 0xFFFF;
+
+struct TransferSlot {
+    char bikeId[BleTransfer::MAX_BIKE_ID + 1];
+    uint16_t connHandle;
+    uint32_t startedAt;
+    uint32_t lastActivity;
+    BleTransfer::Reassembler rx;
+};
+
+static TransferSlot transfers[MAX_BIKE_SESSIONS];
+static BPRBLEServer::TransferStats transferStats = {};
+
+// Fila de saída por conexão: configs e comandos viram notificação só
+// para o handle da bike, e pushes simultâneos para bikes diferentes não
+// disputam o valor da característica. Drena em poll() conforme o NimBLE
+// tiver mbufs; o que não saiu fica para a próxima volta. Notificação maior
+// que MTU - 3 nunca sai (o enlace truncaria): espera a troca de MTU por
+// OUTBOUND_MTU_WAIT_MS e depois é recusada.
+static const uint8_t OUTBOUND_DEPTH = 4;
+
+enum OutboundKind : uint8_t {
+    OUTBOUND_COMMAND,       // config avulso (pushConfigToBike), sem cache
+    OUTBOUND_CONFIG         // config do cache (estado de entrega em ConfigPushEntry)
+};
+
+struct OutboundQueue {
+    bool active;
+    bool wire;              // bike fala WireFormat: config vai em binário
+    uint16_t connHandle;
+    uint8_t head;
+    uint8_t count;
+    uint32_t blockedSince;  // item da frente maior que o MTU desde (0 = não bloqueado)
+    std::string items[OUTBOUND_DEPTH];
+    uint8_t kinds[OUTBOUND_DEPTH];
+};
+
+static OutboundQueue outbound[MAX_BIKE_SESSIONS];
+
+// Cache de payloads de config já embrulhados para a característica, por
+// (bike, versão). Só é reconstruído quando a versão muda; um push vira um
+// memcpy em setValue(). Substituição round-robin quando cheio.
+static const uint8_t CONFIG_PUSH_CACHE_SIZE = 8;
+
+enum PushDelivery : uint8_t {
+    PUSH_IDLE,
+    PUSH_QUEUED,            // na fila de saída da conexão
+    PUSH_NOTIFIED,          // notificação inteira entregue ao NimBLE
+    PUSH_TOO_LARGE,         // maior que o MTU da bike: recusada, config volta a pendente
+    PUSH_DROPPED            // descartada antes de sair (fila cheia, desconexão): volta a pendente
+};
+
+struct ConfigPushEntry {
+    char bikeId[BIKE_ID_LENGTH + 1];
+    uint16_t version;
+    String payload;
+    std::string wire;       // MSG_CONFIG_PUSH, montado do payload na primeira bike binária
+    PushDelivery delivery;
+    uint16_t refusedMtu;    // MTU da conexão que recusou (PUSH_TOO_LARGE)
+};
+
+static ConfigPushEntry configPushCache[CONFIG_PUSH_CACHE_SIZE];
+static uint8_t configPushNext = 0;
+
+// Embrulha um JSON já serializado com o target, sem reparsear
+static String wrapForBike(const String &bikeId, const String &body)
+{
+    String wrapped;
+    wrapped.reserve(body.length() + bikeId.length() + 32);
+    wrapped += "{\"target_bike\":\"";
+    wrapped += bikeId;
+    wrapped += "\",\"config\":";
+    wrapped += body;
+    wrapped += "}";
+    return wrapped;
+}
+
+static ConfigPushEntry *findConfigEntry(const char *bikeId)
+{
+    for (uint8_t i = 0; i < CONFIG_PUSH_CACHE_SIZE; i++) {
+        if (strcmp(configPushCache[i].bikeId, bikeId) == 0) return &configPushCache[i];
+    }
+    return nullptr;
+}
+
+static ConfigPushEntry &cachedConfigEntry(const String &bikeId)
+{
+    uint16_t version = BikeManager::getConfigVersion(bikeId);
+    ConfigPushEntry *entry = findConfigEntry(bikeId.c_str());
+
+    if (entry && entry->version == version && entry->payload.length() > 0) {
+        return *entry;
+    }
+
+    if (!entry) {
+        entry = &configPushCache[configPushNext];
+        configPushNext = (configPushNext + 1) % CONFIG_PUSH_CACHE_SIZE;
+        strncpy(entry->bikeId, bikeId.c_str(), BIKE_ID_LENGTH);
+        entry->bikeId[BIKE_ID_LENGTH] = '\0';
+    }
+
+    entry->version = version;
+    entry->payload = wrapForBike(bikeId, BikeManager::getConfigForBike(bikeId));
+    entry->wire.clear();
+    entry->delivery = PUSH_IDLE;
+    entry->refusedMtu = 0;
+    Serial.printf("📦 Config payload cached for %s (v%d, %d bytes)\n",
+                  bikeId.c_str(), version, entry->payload.length());
+    return *entry;
+}
+
+static const String &cachedConfigPayload(const String &bikeId)
+{
+    return cachedConfigEntry(bikeId).payload;
+}
+
+// Caminho "a.b" da tabela do WireFormat dentro do objeto config
+static JsonVariantConst configValue(JsonObjectConst config, const char *key)
+{
+    const char *dot = strchr(key, '.');
+    if (!dot) return config[key];
+
+    char section[16];
+    size_t length = dot - key < (int)sizeof(section) - 1 ? dot - key : sizeof(section) - 1;
+    memcpy(section, key, length);
+    section[length] = '\0';
+    return config[section][dot + 1];
+}
+
+// Mesmo config do cache JSON, em MSG_CONFIG_PUSH (campos da tabela do WireFormat)
+static const std::string &cachedConfigWire(const String &bikeId)
+{
+    ConfigPushEntry &entry = cachedConfigEntry(bikeId);
+    if (!entry.wire.empty()) return entry.wire;
+
+    // payload = {"target_bike":..,"config":{"type":"config_push","bike_id":..,"config":{...}}}
+    DynamicJsonDocument doc(2048);
+    if (deserializeJson(doc, entry.payload) != DeserializationError::Ok) {
+        Serial.printf("❌ Cached config for %s is not valid JSON\n", bikeId.c_str());
+        return entry.wire;
+    }
+    JsonObjectConst config = doc["config"]["config"];
+
+    uint8_t buffer[BleTransfer::MTU_MAX - BleTransfer::ATT_OVERHEAD];
+    WireFormat::Writer writer(buffer, sizeof(buffer), WireFormat::MSG_CONFIG_PUSH);
+    writer.putString(WireFormat::TAG_BIKE_ID, bikeId.c_str(), bikeId.length());
+
+    size_t count;
+    const WireFormat::Field *fields = WireFormat::fieldsOf(WireFormat::MSG_CONFIG_PUSH, count);
+    for (size_t i = 0; i < count; i++) {
+        const WireFormat::Field &field = fields[i];
+        if (field.tag == WireFormat::TAG_BIKE_ID) continue;
+        JsonVariantConst value = configValue(config, field.key);
+        if (value.isNull()) continue;
+
+        switch (field.kind) {
+        case WireFormat::KIND_STRING:
+            writer.putString(field.tag, value.as<const char *>());
+            break;
+        case WireFormat::KIND_BOOL:
+            writer.putU8(field.tag, value.as<bool>() ? 1 : 0);
+            break;
+        case WireFormat::KIND_MILLIVOLTS:
+            writer.putU16(field.tag, (uint16_t)(value.as<float>() * 1000 + 0.5f));
+            break;
+        case WireFormat::KIND_U8:
+            writer.putU8(field.tag, value.as<uint8_t>());
+            break;
+        case WireFormat::KIND_U16:
+            writer.putU16(field.tag, value.as<uint16_t>());
+            break;
+        case WireFormat::KIND_U32:
+            writer.putU32(field.tag, value.as<uint32_t>());
+            break;
+        }
+    }
+
+    if (writer.length() == 0) {
+        Serial.printf("❌ Wire config for %s does not fit\n", bikeId.c_str());
+        return entry.wire;
+    }
+    entry.wire.assign((const char *)buffer, writer.length());
+    Serial.printf("📦 Wire config cached for %s (v%d, %d bytes vs %d JSON)\n",
+                  bikeId.c_str(), entry.version, (int)entry.wire.size(), entry.payload.length());
+    return entry.wire;
+}
+
+// Notificação para uma única conexão (ble_gattc_notify_custom consome o mbuf mesmo em erro)
+static bool notifyHandle(uint16_t connHandle, uint16_t valueHandle, const uint8_t *data, size_t length)
+{
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(data, length);
+    return om && ble_gattc_notify_custom(connHandle, valueHandle, om) == 0;
+}
+
+static OutboundQueue *outboundFor(uint16_t connHandle, bool create)
+{
+    OutboundQueue *unused = nullptr;
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        if (outbound[i].active && outbound[i].connHandle == connHandle) return &outbound[i];
+        if (!outbound[i].active && !unused) unused = &outbound[i];
+    }
+    if (!create || !unused) return nullptr;
+
+    unused->active = true;
+    unused->wire = false;
+    unused->blockedSince = 0;
+    unused->connHandle = connHandle;
+    unused->head = 0;
+    unused->count = 0;
+    return unused;
+}
+
+static size_t maxNotifyPayload(uint16_t mtu)
+{
+    return mtu > BleTransfer::ATT_OVERHEAD ? mtu - BleTransfer::ATT_OVERHEAD : 0;
+}
+
+static const char *bikeOfHandle(uint16_t connHandle)
+{
+    auto it = BPRBLEServer::connectedDevices.find(connHandle);
+    return it == BPRBLEServer::connectedDevices.end() ? "" : it->second.c_str();
+}
+
+// Estado de entrega do config no cache; recusado volta a pendente no BikeManager
+static void recordConfigDelivery(const char *bikeId, PushDelivery delivery, uint16_t mtu)
+{
+    ConfigPushEntry *entry = findConfigEntry(bikeId);
+    if (entry) {
+        entry->delivery = delivery;
+        entry->refusedMtu = delivery == PUSH_TOO_LARGE ? mtu : 0;
+    }
+    if ((delivery == PUSH_TOO_LARGE || delivery == PUSH_DROPPED) && bikeId[0]) {
+        BikeManager::markConfigUnsent(bikeId);
+    }
+}
+
+// Tira o item da frente; `delivery` vai para o cache se o item era config
+static void popOutbound(OutboundQueue &queue, PushDelivery delivery, uint16_t mtu)
+{
+    if (queue.kinds[queue.head] == OUTBOUND_CONFIG) {
+        recordConfigDelivery(bikeOfHandle(queue.connHandle), delivery, mtu);
+    }
+    queue.items[queue.head].clear();
+    queue.head = (queue.head + 1) % OUTBOUND_DEPTH;
+    queue.count--;
+    queue.blockedSince = 0;
+}
+
+// Config que não saiu volta a pendente (antes de connectedDevices perder o handle)
+static void releaseOutbound(OutboundQueue &queue)
+{
+    while (queue.count > 0) popOutbound(queue, PUSH_DROPPED, 0);
+    queue.active = false;
+    queue.wire = false;
+    queue.blockedSince = 0;
+    queue.head = 0;
+}
+
+static const char *outboundName(uint8_t kind)
+{
+    return kind == OUTBOUND_CONFIG ? "Config" : "Command";
+}
+
+// false = não enfileirado (sem fila ou maior que qualquer MTU possível)
+static bool notifyPayload(uint16_t handle, const String &bikeId, const uint8_t *payload, size_t length,
+                          OutboundKind kind)
+{
+    // Nem com o MTU máximo caberia numa notificação: não adianta esperar
+    if (length > maxNotifyPayload(BleTransfer::MTU_MAX))
+    {
+        Serial.printf("❌ Payload for %s (%d bytes) exceeds max notification size - refused\n",
+                      bikeId.c_str(), (int)length);
+        if (kind == OUTBOUND_CONFIG) recordConfigDelivery(bikeId.c_str(), PUSH_TOO_LARGE, BleTransfer::MTU_MAX);
+        return false;
+    }
+
+    OutboundQueue *queue = outboundFor(handle, true);
+    if (!queue)
+    {
+        Serial.printf("❌ No outbound queue for %s (handle %d)\n", bikeId.c_str(), handle);
+        return false;
+    }
+
+    // Mesmo payload ainda na fila (config reenviado antes de sair): não duplicar
+    for (uint8_t i = 0; i < queue->count; i++) {
+        const std::string &item = queue->items[(queue->head + i) % OUTBOUND_DEPTH];
+        if (item.size() == length && memcmp(item.data(), payload, length) == 0) return true;
+    }
+
+    if (queue->count == OUTBOUND_DEPTH)
+    {
+        Serial.printf("⚠️ Outbound queue full for %s - dropping oldest %s\n",
+                      bikeId.c_str(), outboundName(queue->kinds[queue->head]));
+        popOutbound(*queue, PUSH_DROPPED, 0);
+    }
+
+    uint16_t mtu = BPRBLEServer::pServer->getPeerMTU(handle);
+    if (length > maxNotifyPayload(mtu))
+    {
+        Serial.printf("⏳ Payload for %s (%d bytes) waits for MTU > %d\n", bikeId.c_str(), (int)length, mtu);
+    }
+
+    uint8_t slot = (queue->head + queue->count) % OUTBOUND_DEPTH;
+    queue->items[slot].assign((const char *)payload, length);
+    queue->kinds[slot] = kind;
+    queue->count++;
+    if (kind == OUTBOUND_CONFIG) recordConfigDelivery(bikeId.c_str(), PUSH_QUEUED, mtu);
+    Serial.printf("📤 %s queued for %s (handle %d, %d pending)\n", outboundName(kind), bikeId.c_str(), handle, queue->count);
+    return true;
+}
+
+static void flushOutbound()
+{
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        OutboundQueue &queue = outbound[i];
+        while (queue.active && queue.count > 0)
+        {
+            const std::string &item = queue.items[queue.head];
+            uint16_t mtu = BPRBLEServer::pServer->getPeerMTU(queue.connHandle);
+
+            // Sairia truncada: espera a bike trocar o MTU; passou do prazo, recusa
+            if (item.size() > maxNotifyPayload(mtu))
+            {
+                if (queue.blockedSince == 0) queue.blockedSince = now | 1;
+                if (now - queue.blockedSince < OUTBOUND_MTU_WAIT_MS) break;
+
+                Serial.printf("❌ Notification for %s (%d bytes) does not fit MTU %d - refused\n",
+                              bikeOfHandle(queue.connHandle), (int)item.size(), mtu);
+                popOutbound(queue, PUSH_TOO_LARGE, mtu);
+                continue;
+            }
+
+            // Sem mbuf livre agora: tenta de novo no próximo poll
+            if (!notifyHandle(queue.connHandle, BPRBLEServer::configValueHandle, (const uint8_t *)item.data(), item.size())) break;
+
+            popOutbound(queue, PUSH_NOTIFIED, mtu);
+        }
+    }
+}
+
+// Task do host NimBLE: sem alocação, sem JSON, sem log
 class ServerCallbacks : public NimBLEServerCallbacks
 {
     void onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
     {
-        uint16_t conn_handle = desc->conn_handle;
-        NimBLEAddress addr = NimBLEAddress(desc->peer_id_addr);
+        bleEvents.push(BleEvents::EVENT_CONNECT, desc->conn_handle);
+        NimBLEDevice::startAdvertising();
+    }
 
-        BPRBLEServer::connectedBikes++;
-        Serial.printf("🔵 BLE CONNECT: %s | Handle: %d | Total: %d\n",
-                      addr.toString().c_str(), conn_handle, BPRBLEServer::connectedBikes);
+    void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
+    {
+        bleEvents.push(BleEvents::EVENT_DISCONNECT, desc->conn_handle);
         NimBLEDevice::startAdvertising();
+    }
+};
+
+// Serviço BPR registrado direto no host NimBLE (sem NimBLECharacteristic):
+// o write sai do mbuf para o slot da fila com os_mbuf_copydata, sem
+// NimBLEAttValue nem outra cópia no heap na task do host
+static ble_uuid128_t serviceUuid;
+static ble_uuid128_t dataUuid;
+static ble_uuid128_t configUuid;
+static struct ble_gatt_chr_def characteristics[3];
+static struct ble_gatt_svc_def services[2];
+
+static int accessCharacteristic(uint16_t connHandle, uint16_t attrHandle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    // Leitura devolve vazio: config e ACKs só saem por notificação direcionada
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) return 0;
+
+    uint16_t length = OS_MBUF_PKTLEN(ctxt->om);
+    if (length == 0) return 0;
 
-        BPRBLEServer::connectedDevices[conn_handle] = "";
-        Serial.printf("📝 Stored connection handle %d\n", conn_handle);
+    // Fila cheia: write com resposta recebe erro (a bike tenta de novo)
+    BleEvents::Event *event = bleEvents.reserve((uint8_t)(uintptr_t)arg, connHandle, length);
+    if (!event) return BLE_ATT_ERR_INSUFFICIENT_RES;
+    if (os_mbuf_copydata(ctxt->om, 0, length, event->data) != 0) return BLE_ATT_ERR_UNLIKELY;
+    bleEvents.commit();
+    return 0;
+}
+
+static void copyUuid(ble_uuid128_t &out, const char *uuid)
+{
+    out = NimBLEUUID(uuid).getNative()->u128;
+}
+
+// Depois de createServer() (que reseta o GATT) e antes do ble_gatts_start()
+// (primeiro startAdvertising); os handles de valor saem no ble_gatts_start()
+static bool registerService()
+{
+    copyUuid(serviceUuid, BLE_SERVICE_UUID);
+    copyUuid(dataUuid, BLE_CHAR_DATA_UUID);
+    copyUuid(configUuid, BLE_CHAR_CONFIG_UUID);
+
+    memset(characteristics, 0, sizeof(characteristics));
+    characteristics[0].uuid = &dataUuid.u;
+    characteristics[0].access_cb = accessCharacteristic;
+    characteristics[0].arg = (void *)(uintptr_t)BleEvents::EVENT_DATA_WRITE;
+    characteristics[0].flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_NOTIFY;
+    characteristics[0].val_handle = &BPRBLEServer::dataValueHandle;
+
+    characteristics[1].uuid = &configUuid.u;
+    characteristics[1].access_cb = accessCharacteristic;
+    characteristics[1].arg = (void *)(uintptr_t)BleEvents::EVENT_CONFIG_WRITE;
+    characteristics[1].flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_NOTIFY;
+    characteristics[1].val_handle = &BPRBLEServer::configValueHandle;
+
+    memset(services, 0, sizeof(services));
+    services[0].type = BLE_GATT_SVC_TYPE_PRIMARY;
+    services[0].uuid = &serviceUuid.u;
+    services[0].characteristics = characteristics;
+
+    int rc = ble_gatts_count_cfg(services);
+    if (rc == 0) rc = ble_gatts_add_svcs(services);
+    if (rc != 0)
+    {
+        Serial.printf("❌ Failed to register BLE service: rc=%d\n", rc);
+        return false;
     }
+    return true;
+}
 
-    void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc)
+static void handleConnect(uint16_t conn_handle)
+{
+    BPRBLEServer::connectedBikes++;
+    BPRBLEServer::connectedDevices[conn_handle] = "";
+    Serial.printf("🔵 BLE CONNECT: handle %d | Total: %d\n", conn_handle, BPRBLEServer::connectedBikes);
+
+    // Data length extension: PDUs de até 251 bytes no enlace (o MTU a bike negocia)
+    ble_gap_set_data_len(conn_handle, BLE_DLE_TX_OCTETS, BLE_DLE_TX_TIME);
+}
+
+static void handleDisconnect(uint16_t conn_handle)
+{
+    if (BPRBLEServer::connectedBikes > 0)
+        BPRBLEServer::connectedBikes--;
+
+    // Notificações pendentes morrem com a conexão; config que não saiu volta a
+    // pendente e é reenviado na próxima conexão, via checkAndSendPendingConfig
+    OutboundQueue *queue = outboundFor(conn_handle, false);
+    if (queue) releaseOutbound(*queue);
+
+    // Transferência incompleta fica à espera de retomada
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        if (transfers[i].connHandle == conn_handle) {
+            transfers[i].connHandle = NO_CONNECTION;
+            transfers[i].lastActivity = millis();
+        }
+    }
+
+    String bikeId = "";
+    auto it = BPRBLEServer::connectedDevices.find(conn_handle);
+    if (it != BPRBLEServer::connectedDevices.end())
+    {
+        bikeId = it->second;
+        BPRBLEServer::connectedDevices.erase(it);
+        Serial.printf("🔵 Bike %s disconnected (%d total)\n", bikeId.c_str(), BPRBLEServer::connectedBikes);
+    }
+    else
+    {
+        Serial.printf("🔵 Device disconnected (%d total)\n", BPRBLEServer::connectedBikes);
+    }
+
+    // Notificar bike_pairing sobre desconexão (só se conhece a bike)
+    if (!bikeId.isEmpty())
+    {
+        BPRBLEServer::onBikeDisconnected(bikeId);
+    }
+}
+
+// bike_id de um write (WireFormat ou JSON); marca a conexão como binária.
+// Vazio se o registro não identifica a bike
+static String bikeIdOf(uint16_t connHandle, const uint8_t *data, size_t length)
+{
+    String bikeId;
+    if (WireFormat::isMessage(data, length))
+    {
+        const char *value;
+        size_t valueLength;
+        if (WireFormat::findString(data, length, WireFormat::TAG_BIKE_ID, value, valueLength)) {
+            bikeId.concat(value, valueLength);
+        }
+        OutboundQueue *queue = outboundFor(connHandle, true);
+        if (queue) queue->wire = true;
+        return bikeId;
+    }
+
+    // Bike antiga (JSON): só bike_id interessa aqui
+    StaticJsonDocument<32> filter;
+    filter["bike_id"] = true;
+    StaticJsonDocument<128> doc;
+    if (deserializeJson(doc, (const char *)data, length, DeserializationOption::Filter(filter)) == DeserializationError::Ok) {
+        bikeId = doc["bike_id"] | "";
+    }
+    return bikeId;
+}
+
+// Registro completo (write único ou transferência remontada), binário ou JSON
+static void handleRecord(uint16_t connHandle, const uint8_t *data, size_t length)
+{
+    String bikeId = bikeIdOf(connHandle, data, length);
+    if (bikeId.isEmpty())
+    {
+        Serial.printf("⚠️ Data without bike_id (%d bytes, handle %d)\n", (int)length, connHandle);
+        return;
+    }
+
+    // O handle vem do próprio evento: a conexão que escreveu é a da bike
+    auto it = BPRBLEServer::connectedDevices.find(connHandle);
+    if (it == BPRBLEServer::connectedDevices.end())
+    {
+        Serial.printf("⚠️ Could not find handle for bike %s\n", bikeId.c_str());
+    }
+    else if (it->second != bikeId)
+    {
+        it->second = bikeId;
+        Serial.printf("📝 Bike %s mapped to handle %d\n", bikeId.c_str(), connHandle);
+
+        // Verificar se tem config pendente e enviar imediatamente
+        BPRBLEServer::checkAndSendPendingConfig(bikeId, connHandle);
+    }
+
+    // Delegar processamento para bike_pairing (bytes como chegaram)
+    BPRBLEServer::onBikeDataReceived(bikeId, data, length);
+}
+
+// ACK só para a conexão da bike (notificação direcionada, sem broadcast)
+static void sendAck(uint16_t connHandle, uint16_t transferId, const BleTransfer::Reassembler::Result &result)
+{
+    if (!BPRBLEServer::dataValueHandle || connHandle == NO_CONNECTION) return;
+
+    uint8_t frame[BleTransfer::ACK_SIZE];
+    size_t length = BleTransfer::encodeAck(frame, sizeof(frame), transferId, result.offset, result.status);
+    if (!notifyHandle(connHandle, BPRBLEServer::dataValueHandle, frame, length))
+    {
+        Serial.printf("⚠️ Transfer ACK to handle %d failed\n", connHandle);
+    }
+}
+
+static TransferSlot *transferFor(uint16_t connHandle)
+{
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        if (transfers[i].connHandle == connHandle && transfers[i].rx.active()) return &transfers[i];
+    }
+    return nullptr;
+}
+
+static TransferSlot *transferSlot(const BleTransfer::Frame &start)
+{
+    TransferSlot *unused = nullptr;
+    TransferSlot *oldest = nullptr;
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        TransferSlot &slot = transfers[i];
+        if (slot.rx.active() && strlen(slot.bikeId) == start.bikeIdLen &&
+            memcmp(slot.bikeId, start.bikeId, start.bikeIdLen) == 0) {
+            return &slot;
+        }
+        if (!slot.rx.active()) {
+            if (!unused) unused = &slot;
+        } else if (slot.connHandle == NO_CONNECTION &&
+                   (!oldest || (int32_t)(slot.lastActivity - oldest->lastActivity) < 0)) {
+            oldest = &slot;
+        }
+    }
+    // Sem slot livre: sacrificar a retomada mais antiga de bike já desconectada
+    TransferSlot *slot = unused ? unused : oldest;
+    if (slot) {
+        slot->rx.release();
+        memcpy(slot->bikeId, start.bikeId, start.bikeIdLen);
+        slot->bikeId[start.bikeIdLen] = '\0';
+    }
+    return slot;
+}
+
+static void finishTransfer(TransferSlot &slot)
+{
+    uint32_t elapsed = millis() - slot.startedAt;
+    uint16_t mtu = BPRBLEServer::pServer ? BPRBLEServer::pServer->getPeerMTU(slot.connHandle) : 0;
+
+    transferStats.completed++;
+    transferStats.bytes += slot.rx.size();
+    transferStats.millis += elapsed;
+    Serial.printf("📶 Transfer from %s: %lu B in %lu ms (%lu B/s, MTU %d)\n",
+                  slot.bikeId, (unsigned long)slot.rx.size(), (unsigned long)elapsed,
+                  (unsigned long)(elapsed ? (uint64_t)slot.rx.size() * 1000 / elapsed : 0), mtu);
+
+    handleRecord(slot.connHandle, slot.rx.payload(), slot.rx.size());
+    slot.rx.release();
+    slot.bikeId[0] = '\0';
+}
+
+static void handleTransferFrame(const BleEvents::Event &event)
+{
+    BleTransfer::Frame frame;
+    if (!BleTransfer::decode(event.data, event.length, frame))
     {
-        if (BPRBLEServer::connectedBikes > 0)
-            BPRBLEServer::connectedBikes--;
+        Serial.printf("⚠️ Invalid transfer frame from handle %d\n", event.connHandle);
+        return;
+    }
+
+    if (frame.type == BleTransfer::FRAME_START)
+    {
+        TransferSlot *slot = transferSlot(frame);
+        if (!slot)
+        {
+            sendAck(event.connHandle, frame.transferId, { BleTransfer::ACK_REJECT, 0, true });
+            return;
+        }
 
-        uint16_t conn_handle = desc->conn_handle;
-        String bikeId = "";
-        if (BPRBLEServer::connectedDevices.find(conn_handle) != BPRBLEServer::connectedDevices.end())
+        bool resumed = false;
+        BleTransfer::Reassembler::Result result = slot->rx.start(frame, resumed);
+        slot->connHandle = event.connHandle;
+        slot->lastActivity = millis();
+        if (resumed)
         {
-            bikeId = BPRBLEServer::connectedDevices[conn_handle];
-            BPRBLEServer::connectedDevices.erase(conn_handle);
-            Serial.printf("🔵 Bike %s disconnected (%d total)\n", bikeId.c_str(), BPRBLEServer::connectedBikes);
+            transferStats.resumed++;
+            Serial.printf("↪️ Transfer from %s resumed at %lu/%lu\n", slot->bikeId,
+                          (unsigned long)result.offset, (unsigned long)frame.total);
         }
         else
         {
-            Serial.printf("🔵 Device disconnected (%d total)\n", BPRBLEServer::connectedBikes);
+            slot->startedAt = millis();
         }
+        sendAck(event.connHandle, frame.transferId, result);
+        return;
+    }
 
-        NimBLEDevice::startAdvertising();
+    if (frame.type != BleTransfer::FRAME_DATA) return;
 
-        // Notificar bike_pairing sobre desconexão (só se conhece a bike)
-        if (!bikeId.isEmpty())
-        {
-            BPRBLEServer::onBikeDisconnected(bikeId);
-        }
+    TransferSlot *slot = transferFor(event.connHandle);
+    if (!slot)
+    {
+        // Sem START (central reiniciou?): a bike volta ao START ao ver o REJECT
+        sendAck(event.connHandle, frame.transferId, { BleTransfer::ACK_REJECT, 0, true });
+        return;
     }
-};
 
-class DataCallbacks : public NimBLECharacteristicCallbacks
+    slot->lastActivity = millis();
+    BleTransfer::Reassembler::Result result = slot->rx.data(frame);
+    if (result.status == BleTransfer::ACK_RESTART)
+    {
+        transferStats.crcFailures++;
+        Serial.printf("❌ Transfer CRC mismatch from %s - restarting\n", slot->bikeId);
+    }
+    if (result.ack) sendAck(event.connHandle, frame.transferId, result);
+    if (result.status == BleTransfer::ACK_DONE) finishTransfer(*slot);
+}
+
+static void expireTransfers()
 {
-    void onWrite(NimBLECharacteristic *pChar)
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+        TransferSlot &slot = transfers[i];
+        if (!slot.rx.active() || slot.connHandle != NO_CONNECTION) continue;
+        if (now - slot.lastActivity < TRANSFER_RESUME_MS) continue;
+
+        Serial.printf("⏰ Transfer from %s abandoned at %lu/%lu\n", slot.bikeId,
+                      (unsigned long)slot.rx.receivedBytes(), (unsigned long)slot.rx.size());
+        slot.rx.release();
+        slot.bikeId[0] = '\0';
+    }
+}
+
+static void handleDataWrite(const BleEvents::Event &event)
+{
+    if (BleTransfer::isFrame(event.data, event.length))
     {
-        std::string value = pChar->getValue();
-        if (value.length() > 0)
-        {
-            DynamicJsonDocument doc(512);
-            DeserializationError error = deserializeJson(doc, value.c_str());
+        handleTransferFrame(event);
+    }
+    else
+    {
+        // Write único: mensagem WireFormat ou registro JSON (bike antiga) inteiro
+        handleRecord(event.connHandle, event.data, event.length);
+    }
+}
 
-            if (!error && doc["bike_id"])
-            {
-                String bikeId = doc["bike_id"];
-                
-                // Encontrar handle desta conexão
-                uint16_t conn_handle = 0;
-                for (auto &pair : BPRBLEServer::connectedDevices) {
-                    if (pair.second.isEmpty()) {
-                        conn_handle = pair.first;
-                        break;
-                    }
-                }
-                
-                if (conn_handle != 0) {
-                    // Armazenar bike_id para esta conexão específica
-                    BPRBLEServer::connectedDevices[conn_handle] = bikeId;
-                    Serial.printf("📝 Bike %s mapped to handle %d\n", bikeId.c_str(), conn_handle);
-
-                    // Verificar se tem config pendente e enviar imediatamente
-                    BPRBLEServer::checkAndSendPendingConfig(bikeId, conn_handle);
-                } else {
-                    Serial.printf("⚠️ Could not find handle for bike %s\n", bikeId.c_str());
-                }
-
-                // Delegar processamento para bike_pairing
-                BPRBLEServer::onBikeDataReceived(bikeId, String(value.c_str()));
-            }
-            else
-            {
-                Serial.printf("⚠️ Data without bike_id: %s\n", value.c_str());
-            }
-        }
+static void handleConfigWrite(const BleEvents::Event &event)
+{
+    String bikeId = bikeIdOf(event.connHandle, event.data, event.length);
+    if (!bikeId.isEmpty())
+    {
+        BPRBLEServer::onConfigRequest(bikeId, event.data, event.length);
     }
-};
+}
 
-class ConfigCallbacks : public NimBLECharacteristicCallbacks
+void BPRBLEServer::poll()
 {
-    void onWrite(NimBLECharacteristic *pChar)
+    const BleEvents::Event *event;
+    while ((event = bleEvents.front()) != nullptr)
     {
-        std::string value = pChar->getValue();
-        if (value.length() > 0)
+        switch (event->type)
         {
-            DynamicJsonDocument doc(256);
-            DeserializationError error = deserializeJson(doc, value.c_str());
-
-            if (!error && doc["bike_id"])
-            {
-                String bikeId = doc["bike_id"];
-                BPRBLEServer::onConfigRequest(bikeId, String(value.c_str()));
-            }
+        case BleEvents::EVENT_CONNECT:
+            handleConnect(event->connHandle);
+            break;
+        case BleEvents::EVENT_DISCONNECT:
+            handleDisconnect(event->connHandle);
+            break;
+        case BleEvents::EVENT_DATA_WRITE:
+            handleDataWrite(*event);
+            break;
+        case BleEvents::EVENT_CONFIG_WRITE:
+            handleConfigWrite(*event);
+            break;
         }
+        bleEvents.pop();
     }
-};
+    flushOutbound();
+    expireTransfers();
+
+    static uint32_t reportedDrops = 0;
+    BleEvents::Stats stats = bleEvents.stats();
+    if (stats.dropped != reportedDrops)
+    {
+        Serial.printf("⚠️ BLE event queue dropped %lu events (high water %d/%d)\n",
+                      (unsigned long)(stats.dropped - reportedDrops), stats.highWater, (int)BleEvents::SLOT_COUNT);
+        reportedDrops = stats.dropped;
+    }
+}
+
+BPRBLEServer::EventStats BPRBLEServer::getEventStats()
+{
+    BleEvents::Stats stats = bleEvents.stats();
+    EventStats out;
+    out.highWater = stats.highWater;
+    out.capacity = BleEvents::SLOT_COUNT;
+    out.dropped = stats.dropped;
+    return out;
+}
+
+const BPRBLEServer::TransferStats &BPRBLEServer::getTransferStats()
+{
+    return transferStats;
+}
 
 bool BPRBLEServer::start()
 {
     Serial.println("🔵 Starting BLE Server");
 
     NimBLEDevice::init(BLE_DEVICE_NAME);
+    NimBLEDevice::setMTU(BleTransfer::MTU_MAX);
     NimBLEDevice::setPower(ESP_PWR_LVL_P3);
     pServer = NimBLEDevice::createServer();
     pServer->setCallbacks(new ServerCallbacks());
 
-    pService = pServer->createService(BLE_SERVICE_UUID);
-
-    // Data characteristic
-    pDataChar = pService->createCharacteristic(
-        BLE_CHAR_DATA_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE);
-    pDataChar->setCallbacks(new DataCallbacks());
-
-    // Config characteristic
-    pConfigChar = pService->createCharacteristic(
-        BLE_CHAR_CONFIG_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY);
-    pConfigChar->setCallbacks(new ConfigCallbacks());
-
-    pService->start();
+    // Data + config (data também leva os ACKs da transferência em blocos)
+    if (!registerService())
+    {
+        NimBLEDevice::deinit(false);
+        pServer = nullptr;
+        return false;
+    }
 
     NimBLEAdvertising *pAdvertising = NimBLEDevice::getAdvertising();
     pAdvertising->addServiceUUID(BLE_SERVICE_UUID);
@@ -161,10 +791,17 @@ void BPRBLEServer::stop()
         pServer->getAdvertising()->stop();
         NimBLEDevice::deinit(false);
         pServer = nullptr;
-        pService = nullptr;
-        pDataChar = nullptr;
-        pConfigChar = nullptr;
+        dataValueHandle = 0;
+        configValueHandle = 0;
         connectedBikes = 0;
+        // NimBLE parado: sem produtor, eventos de conexões mortas saem
+        bleEvents.clear();
+        for (uint8_t i = 0; i < MAX_BIKE_SESSIONS; i++) {
+            transfers[i].rx.release();
+            transfers[i].bikeId[0] = '\0';
+            transfers[i].connHandle = NO_CONNECTION;
+            releaseOutbound(outbound[i]);
+        }
         connectedDevices.clear();
     }
     Serial.println("🔚 BLE Server stopped");
@@ -185,19 +822,22 @@ bool BPRBLEServer::isBikeConnected(const String &bikeId)
     return false;
 }
 
-void BPRBLEServer::pushConfigToBike(const String &bikeId, const String &config)
+static uint16_t handleOf(const String &bikeId)
 {
-    if (!pConfigChar) return;
-    
-    // Encontrar handle da bike específica
-    uint16_t targetHandle = 0;
-    for (auto &pair : connectedDevices) {
+    for (auto &pair : BPRBLEServer::connectedDevices) {
         if (pair.second == bikeId) {
-            targetHandle = pair.first;
-            break;
+            return pair.first;
         }
     }
+    return 0;
+}
+
+void BPRBLEServer::pushConfigToBike(const String &bikeId, const String &config)
+{
+    if (!configValueHandle) return;
     
+    // Encontrar handle da bike específica
+    uint16_t targetHandle = handleOf(bikeId);
     if (targetHandle == 0) {
         Serial.printf("❌ Bike %s not connected, cannot send config\n", bikeId.c_str());
         return;
@@ -207,39 +847,54 @@ void BPRBLEServer::pushConfigToBike(const String &bikeId, const String &config)
     sendConfigToHandle(targetHandle, bikeId, config);
 }
 
-void BPRBLEServer::sendConfigToHandle(uint16_t handle, const String &bikeId, const String &config)
+bool BPRBLEServer::pushBikeConfig(const String &bikeId)
 {
-    if (!pConfigChar) return;
-    
-    // Incluir target no JSON para segurança extra
-    DynamicJsonDocument wrapper(1024);
-    wrapper["target_bike"] = bikeId;
-    wrapper["timestamp"] = millis();
+    if (!configValueHandle) return false;
     
-    // Parse config original
-    DynamicJsonDocument originalConfig(512);
-    if (deserializeJson(originalConfig, config) == DeserializationError::Ok) {
-        wrapper["config"] = originalConfig;
-    } else {
-        wrapper["config"] = config;
+    uint16_t targetHandle = handleOf(bikeId);
+    if (targetHandle == 0) {
+        Serial.printf("❌ Bike %s not connected, cannot send config\n", bikeId.c_str());
+        return false;
     }
     
-    String wrappedConfig;
-    serializeJson(wrapper, wrappedConfig);
-    
-    pConfigChar->setValue(wrappedConfig.c_str());
+    return sendCachedConfig(targetHandle, bikeId);
+}
+
+bool BPRBLEServer::sendCachedConfig(uint16_t handle, const String &bikeId)
+{
+    // Mesma versão já recusada por MTU e a conexão não cresceu: não reenfileirar
+    ConfigPushEntry &entry = cachedConfigEntry(bikeId);
+    uint16_t mtu = pServer->getPeerMTU(handle);
+    if (entry.delivery == PUSH_TOO_LARGE && mtu <= entry.refusedMtu) {
+        Serial.printf("⚠️ Config v%d for %s too large for MTU %d - not sent\n", entry.version, bikeId.c_str(), mtu);
+        return false;
+    }
+
+    OutboundQueue *queue = outboundFor(handle, false);
+    if (queue && queue->wire) {
+        const std::string &wire = cachedConfigWire(bikeId);
+        if (!wire.empty()) {
+            return notifyPayload(handle, bikeId, (const uint8_t *)wire.data(), wire.size(), OUTBOUND_CONFIG);
+        }
+    }
+    const String &payload = cachedConfigPayload(bikeId);
+    return notifyPayload(handle, bikeId, (const uint8_t *)payload.c_str(), payload.length(), OUTBOUND_CONFIG);
+}
+
+bool BPRBLEServer::sendConfigToHandle(uint16_t handle, const String &bikeId, const String &config)
+{
+    if (!configValueHandle) return false;
     
-    // Por enquanto usar broadcast com target (mais compatível)
-    pConfigChar->notify();
-    Serial.printf("📤 Config sent to %s (handle %d) with target filter\n", bikeId.c_str(), handle);
+    // Incluir target no JSON para segurança extra
+    String payload = wrapForBike(bikeId, config);
+    return notifyPayload(handle, bikeId, (const uint8_t *)payload.c_str(), payload.length(), OUTBOUND_COMMAND);
 }
 
 void BPRBLEServer::checkAndSendPendingConfig(const String &bikeId, uint16_t handle)
 {
     // Verificar se tem config pendente via bike_pairing
     if (BikeManager::hasConfigUpdate(bikeId)) {
-        String config = BikeManager::getConfigForBike(bikeId);
-        sendConfigToHandle(handle, bikeId, config);
+        if (!configValueHandle || !sendCachedConfig(handle, bikeId)) return;
         BikeManager::markConfigSent(bikeId);
         
         Serial.printf("⚡ Immediate config sent to %s on connection\n", bikeId.c_str());
@@ -0,0 +1,169 @@
+#include "ble_transfer.h"
+#include "crc32.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace BleTransfer {
+
+    static void putU16(uint8_t* p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+    }
+
+    static void putU32(uint8_t* p, uint32_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = (v >> 24) & 0xFF;
+    }
+
+    static uint16_t getU16(const uint8_t* p) {
+        return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+    }
+
+    static uint32_t getU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+               ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static void writeHeader(uint8_t* out, uint8_t type, uint16_t transferId) {
+        out[0] = FRAME_MAGIC;
+        out[1] = type;
+        putU16(out + 2, transferId);
+    }
+
+    size_t encodeStart(uint8_t* out, size_t capacity, uint16_t transferId, uint32_t total, uint32_t crc,
+                       const char* bikeId, size_t bikeIdLen) {
+        size_t length = HEADER_SIZE + 9 + bikeIdLen;
+        if (bikeIdLen > MAX_BIKE_ID || length > capacity) return 0;
+
+        writeHeader(out, FRAME_START, transferId);
+        putU32(out + HEADER_SIZE, total);
+        putU32(out + HEADER_SIZE + 4, crc);
+        out[HEADER_SIZE + 8] = (uint8_t)bikeIdLen;
+        memcpy(out + HEADER_SIZE + 9, bikeId, bikeIdLen);
+        return length;
+    }
+
+    size_t encodeData(uint8_t* out, size_t capacity, uint16_t transferId, uint32_t offset,
+                      const uint8_t* data, size_t length) {
+        if (DATA_HEADER_SIZE + length > capacity) return 0;
+
+        writeHeader(out, FRAME_DATA, transferId);
+        putU32(out + HEADER_SIZE, offset);
+        memcpy(out + DATA_HEADER_SIZE, data, length);
+        return DATA_HEADER_SIZE + length;
+    }
+
+    size_t encodeAck(uint8_t* out, size_t capacity, uint16_t transferId, uint32_t offset, uint8_t status) {
+        if (capacity < ACK_SIZE) return 0;
+
+        writeHeader(out, FRAME_ACK, transferId);
+        putU32(out + HEADER_SIZE, offset);
+        out[HEADER_SIZE + 4] = status;
+        return ACK_SIZE;
+    }
+
+    bool decode(const uint8_t* in, size_t length, Frame& frame) {
+        if (!isFrame(in, length)) return false;
+
+        memset(&frame, 0, sizeof(frame));
+        frame.type = in[1];
+        frame.transferId = getU16(in + 2);
+        const uint8_t* body = in + HEADER_SIZE;
+        size_t bodyLength = length - HEADER_SIZE;
+
+        switch (frame.type) {
+        case FRAME_START:
+            if (bodyLength < 9) return false;
+            frame.total = getU32(body);
+            frame.crc = getU32(body + 4);
+            frame.bikeIdLen = body[8];
+            if (frame.bikeIdLen > MAX_BIKE_ID || bodyLength < 9u + frame.bikeIdLen) return false;
+            frame.bikeId = (const char*)(body + 9);
+            return true;
+        case FRAME_DATA:
+            if (bodyLength < 4) return false;
+            frame.offset = getU32(body);
+            frame.data = body + 4;
+            frame.length = bodyLength - 4;
+            return true;
+        case FRAME_ACK:
+            if (bodyLength < 5) return false;
+            frame.offset = getU32(body);
+            frame.status = body[4];
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    Reassembler::Reassembler()
+        : buffer(nullptr), total(0), received(0), crc(0), id(0), chunksSinceAck(0), bikeIdLen(0) {}
+
+    Reassembler::~Reassembler() {
+        release();
+    }
+
+    void Reassembler::release() {
+        free(buffer);
+        buffer = nullptr;
+        total = received = crc = 0;
+        id = 0;
+        chunksSinceAck = 0;
+        bikeIdLen = 0;
+    }
+
+    Reassembler::Result Reassembler::start(const Frame& frame, bool& resumed) {
+        resumed = buffer && id == frame.transferId && total == frame.total && crc == frame.crc &&
+                  bikeIdLen == frame.bikeIdLen && memcmp(bikeId, frame.bikeId, bikeIdLen) == 0;
+        if (resumed) {
+            chunksSinceAck = 0;
+            return { ACK_CONTINUE, received, true };
+        }
+
+        release();
+        if (frame.total == 0 || frame.total > MAX_TRANSFER) return { ACK_REJECT, 0, true };
+
+        buffer = (uint8_t*)malloc(frame.total);
+        if (!buffer) return { ACK_REJECT, 0, true };
+
+        total = frame.total;
+        crc = frame.crc;
+        id = frame.transferId;
+        bikeIdLen = frame.bikeIdLen;
+        memcpy(bikeId, frame.bikeId, bikeIdLen);
+        return { ACK_CONTINUE, 0, true };
+    }
+
+    Reassembler::Result Reassembler::data(const Frame& frame) {
+        if (!buffer || frame.transferId != id) return { ACK_REJECT, 0, true };
+
+        // Bloco fora de ordem (perdido na fila ou reenvio): pedir a partir do contíguo
+        if (frame.offset != received) {
+            if (frame.offset < received) return { ACK_CONTINUE, received, false };
+            chunksSinceAck = 0;
+            return { ACK_CONTINUE, received, true };
+        }
+        if (frame.length == 0 || frame.length > total - received) {
+            chunksSinceAck = 0;
+            return { ACK_CONTINUE, received, true };
+        }
+
+        memcpy(buffer + received, frame.data, frame.length);
+        received += frame.length;
+
+        if (received == total) {
+            if (Crc32::compute(buffer, total) == crc) return { ACK_DONE, total, true };
+            received = 0;
+            chunksSinceAck = 0;
+            return { ACK_RESTART, 0, true };
+        }
+
+        if (++chunksSinceAck >= WINDOW_CHUNKS) {
+            chunksSinceAck = 0;
+            return { ACK_CONTINUE, received, true };
+        }
+        return { ACK_CONTINUE, received, false };
+    }
+}
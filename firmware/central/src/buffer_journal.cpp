@@ -0,0 +1,106 @@
+#include "buffer_journal.h"
+#include <string.h>
+
+namespace BufferJournal {
+
+    static void putU16(uint8_t* p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+    }
+
+    static void putU32(uint8_t* p, uint32_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = (v >> 24) & 0xFF;
+    }
+
+    static uint16_t getU16(const uint8_t* p) {
+        return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+    }
+
+    static uint32_t getU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+               ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    void writeHeader(uint8_t* out, uint8_t type, uint16_t length, uint32_t crc) {
+        out[0] = RECORD_MAGIC;
+        out[1] = type;
+        putU16(out + 2, length);
+        putU32(out + 4, crc);
+    }
+
+    bool parseHeader(const uint8_t* in, RecordHeader& header) {
+        if (in[0] != RECORD_MAGIC) return false;
+
+        header.type = in[1];
+        header.length = getU16(in + 2);
+        header.crc = getU32(in + 4);
+
+        if (header.type < RECORD_DATA || header.type > RECORD_TRIM) return false;
+        return header.length > 0 && header.length <= MAX_PAYLOAD;
+    }
+
+    size_t encodeData(uint8_t* out, size_t capacity, const DataRecord& record) {
+        size_t length = SEQ_SIZE + DATA_FIXED_SIZE + record.bikeIdLen + record.size;
+        if (record.bikeIdLen > MAX_BIKE_ID || length > capacity || length > MAX_PAYLOAD) {
+            return 0;
+        }
+
+        putU32(out, record.seq);
+        out += SEQ_SIZE;
+        putU32(out, record.timestamp);
+        putU32(out + 4, record.itemCrc);
+        out[8] = record.flags;
+        out[9] = record.bikeIdLen;
+        memcpy(out + DATA_FIXED_SIZE, record.bikeId, record.bikeIdLen);
+        memcpy(out + DATA_FIXED_SIZE + record.bikeIdLen, record.data, record.size);
+        return length;
+    }
+
+    bool decodeData(uint8_t type, const uint8_t* payload, size_t length, DataRecord& record) {
+        record.seq = 0;
+        if (type == RECORD_DATA_SEQ) {
+            if (length < SEQ_SIZE) return false;
+            record.seq = getU32(payload);
+            payload += SEQ_SIZE;
+            length -= SEQ_SIZE;
+        } else if (type != RECORD_DATA) {
+            return false;
+        }
+        if (length < DATA_FIXED_SIZE) return false;
+
+        record.timestamp = getU32(payload);
+        record.itemCrc = getU32(payload + 4);
+        record.flags = payload[8];
+        record.bikeIdLen = payload[9];
+        if (record.bikeIdLen > MAX_BIKE_ID || DATA_FIXED_SIZE + record.bikeIdLen > length) {
+            return false;
+        }
+
+        record.bikeId = (const char*)(payload + DATA_FIXED_SIZE);
+        record.data = payload + DATA_FIXED_SIZE + record.bikeIdLen;
+        record.size = length - DATA_FIXED_SIZE - record.bikeIdLen;
+        return true;
+    }
+
+    size_t encodeTrim(uint8_t* out, uint32_t through, uint32_t acked) {
+        putU32(out, through);
+        putU32(out + 4, acked);
+        return TRIM_SIZE;
+    }
+
+    bool decodeTrim(const uint8_t* payload, size_t length, uint32_t& through, uint32_t& acked) {
+        if (length != TRIM_SIZE) return false;
+        through = getU32(payload);
+        acked = getU32(payload + 4);
+        return true;
+    }
+
+    bool decodeTombstone(const uint8_t* payload, size_t length, uint16_t& count) {
+        if (length != 2) return false;
+        count = getU16(payload);
+        return true;
+    }
+}
@@ -1,19 +1,121 @@
 #include "buffer_manager.h"
 #include <LittleFS.h>
 #include <ArduinoJson.h>
-#include <CRC32.h>
 #include "constants.h"
 #include "config_manager.h"
+#include "buffer_journal.h"
+#include "payload_compressor.h"
+#include "base64_codec.h"
+#include "backup_archive.h"
+#include "crc32.h"
+#include "wire_format.h"
 
 extern ConfigManager configManager;
 
-BufferManager::BufferManager() : dataCount(0), lastSync(0) {}
+BufferManager::BufferManager() : arena(nullptr), arenaCapacity(0), arenaUsed(0), dataCount(0), lastSync(0),
+    uploadCount(0), uploadTimestamp(0), uploadFirstSeq(0), uploadLastSeq(0), uploadInFlight(false),
+    uploadSegmentDone(false), nextSeq(1), ackedSeq(0), cursorIndex(-1), cursorOffset(0), spillHead(0), spillTail(0),
+    spillRecords(0), spillBytes(0), uploadFromSpill(false), journalMode(true), journalSize(0),
+    journalFirstSeq(0), journalLastSeq(0), backupCount(0), nextBackupId(1) {}
 
 void BufferManager::begin()
 {
+    journalMode = configManager.getJournalEnabled();
+    allocateArena();
+    loadManifest();
     cleanupOldBackups();
-    loadBuffer();
-    Serial.printf("📥 DataBuffer initialized: %d items\n", dataCount);
+    loadBuffer();          // recupera ackedSeq antes de contar o que falta nos segmentos
+    scanSpillSegments();
+    Serial.printf("📥 DataBuffer initialized: %d items, %d/%d bytes (%s), seq %lu acked %lu\n",
+                  dataCount, arenaUsed, arenaCapacity, journalMode ? "journal" : "json",
+                  (unsigned long)nextSeq, (unsigned long)ackedSeq);
+    if (spillHead < spillTail) {
+        Serial.printf("   Spill: %lu segments, %lu items, %d bytes\n",
+                      (unsigned long)(spillTail - spillHead), (unsigned long)spillRecords, spillBytes);
+    }
+}
+
+void BufferManager::allocateArena()
+{
+    if (arena) return;
+
+    // Capacidade em bytes; nunca mais que metade do maior bloco livre (BLE/WiFi/JSON precisam do resto)
+    size_t wanted = (size_t)configManager.getBufferArenaKb() * 1024;
+    size_t limit = ESP.getMaxAllocHeap() / 2;
+    if (wanted > limit) wanted = limit;
+
+    while (wanted >= 1024 && !(arena = (uint8_t*)malloc(wanted))) {
+        wanted /= 2;
+    }
+    arenaCapacity = arena ? wanted : 0;
+
+    if (!arena) {
+        Serial.println("❌ Failed to allocate buffer arena");
+    }
+}
+
+void BufferManager::readRecord(size_t offset, RecordHeader& header) const
+{
+    memcpy(&header, arena + offset, sizeof(RecordHeader));
+}
+
+size_t BufferManager::recordSize(size_t offset) const
+{
+    RecordHeader header;
+    readRecord(offset, header);
+    return sizeof(RecordHeader) + header.size;
+}
+
+size_t BufferManager::offsetOf(int index)
+{
+    // Upload percorre os itens em ordem (duas vezes); evita caminhar do início a cada item
+    if (cursorIndex < 0 || index < cursorIndex) {
+        cursorIndex = 0;
+        cursorOffset = 0;
+    }
+    while (cursorIndex < index) {
+        cursorOffset += recordSize(cursorOffset);
+        cursorIndex++;
+    }
+    return cursorOffset;
+}
+
+size_t BufferManager::copyBikeId(const RecordHeader& header, char* out)
+{
+    size_t length = strnlen(header.bikeId, BIKE_ID_LENGTH);
+    memcpy(out, header.bikeId, length);
+    out[length] = '\0';
+    return length;
+}
+
+void BufferManager::noteSeq(uint32_t seq)
+{
+    if (seq >= nextSeq) nextSeq = seq + 1;
+}
+
+bool BufferManager::storeRecord(uint32_t seq, const char* bikeId, size_t bikeIdLen, uint32_t timestamp, uint32_t crc,
+                                uint8_t flags, const uint8_t* data, size_t size)
+{
+    if (dataCount >= MAX_BUFFER_SIZE || size > MAX_ITEM_SIZE ||
+        arenaUsed + sizeof(RecordHeader) + size > arenaCapacity) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.seq = seq;
+    header.timestamp = timestamp;
+    header.crc32 = crc;
+    header.size = size;
+    header.flags = flags;
+    memset(header.bikeId, 0, BIKE_ID_LENGTH);
+    memcpy(header.bikeId, bikeId, bikeIdLen > BIKE_ID_LENGTH ? BIKE_ID_LENGTH : bikeIdLen);
+
+    memcpy(arena + arenaUsed, &header, sizeof(header));
+    memcpy(arena + arenaUsed + sizeof(header), data, size);
+    arenaUsed += sizeof(header) + size;
+    dataCount++;
+    noteSeq(seq);
+    return true;
 }
 
 bool BufferManager::addBikeData(const String& bikeId, const String& jsonData)
@@ -27,16 +129,8 @@ bool BufferManager::addBikeData(const String& bikeId, const String& jsonData)
         return false;
     }
     
-    // Adicionar timestamp da central
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    getLocalTime(&timeinfo);
-    
-    char dateStr[64];
-    strftime(dateStr, sizeof(dateStr), "%Y-%m-%d %H:%M:%S UTC-3", &timeinfo);
-    
-    doc["central_receive_timestamp"] = now;
-    doc["central_receive_timestamp_human"] = dateStr;
+    // Adicionar timestamp da central (só epoch; forma legível fica com os consumidores)
+    doc["central_receive_timestamp"] = time(nullptr);
     
     // Serializar JSON modificado
     String modifiedJson;
@@ -48,42 +142,85 @@ bool BufferManager::addBikeData(const String& bikeId, const String& jsonData)
 
 bool BufferManager::addData(const String& bikeId, const uint8_t *data, size_t length)
 {
-    if (dataCount >= MAX_BUFFER_SIZE || length > 256)
-    {
-        return false;
-    }
-
-    // Comprimir se configurado
-    uint8_t* finalData = (uint8_t*)data;
+    // Comprimir se configurado (antes do limite do item: JSON maior que 256 bytes pode caber comprimido)
+    const uint8_t* finalData = data;
     size_t finalSize = length;
     bool compressed = false;
+    uint8_t packed[MAX_ITEM_SIZE];
     
     if (configManager.getCompressionEnabled() && length > configManager.getCompressionMinSize()) {
-        // TODO: Implementar compressão quando necessário
-        // finalData = compress(data, length, &finalSize);
-        // compressed = true;
+        size_t packedSize = PayloadCompressor::compress(data, length, packed, sizeof(packed));
+        if (packedSize > 0) {
+            finalData = packed;
+            finalSize = packedSize;
+            compressed = true;
+        }
+    }
+
+    return appendItem(bikeId, finalData, finalSize, compressed ? RECORD_COMPRESSED : 0, length);
+}
+
+struct WirePieceContext {
+    BufferManager* manager;
+    const String* bikeId;
+};
+
+bool BufferManager::appendWirePiece(const uint8_t* piece, size_t length, void* context)
+{
+    WirePieceContext& ctx = *(WirePieceContext*)context;
+    return ctx.manager->appendItem(*ctx.bikeId, piece, length, RECORD_WIRE, length);
+}
+
+bool BufferManager::addBikeMessage(const String& bikeId, const uint8_t* data, size_t length)
+{
+    // Horário de recebimento já vai no cabeçalho do item (vira
+    // central_receive_timestamp no upload): nada a reescrever aqui
+    if (length <= MAX_ITEM_SIZE) {
+        return appendItem(bikeId, data, length, RECORD_WIRE, length);
+    }
+
+    uint8_t piece[MAX_ITEM_SIZE];
+    WirePieceContext context = { this, &bikeId };
+    if (!WireFormat::split(data, length, piece, sizeof(piece), appendWirePiece, &context)) {
+        Serial.printf("❌ Could not split message from %s [%d bytes]\n", bikeId.c_str(), length);
+        return false;
+    }
+    return true;
+}
+
+bool BufferManager::appendItem(const String& bikeId, const uint8_t* finalData, size_t finalSize, uint8_t flags,
+                               size_t originalSize)
+{
+    if (finalSize > MAX_ITEM_SIZE)
+    {
+        Serial.printf("❌ Data too large for buffer item: %s [%d bytes]\n", bikeId.c_str(), finalSize);
+        return false;
     }
 
     // Calcular CRC32
-    CRC32 crc;
-    crc.update(finalData, finalSize);
-    uint32_t checksum = crc.finalize();
-
-    // Armazenar dados
-    buffer[dataCount].bikeId = bikeId;
-    buffer[dataCount].timestamp = time(nullptr);
-    buffer[dataCount].size = finalSize;
-    buffer[dataCount].crc32 = checksum;
-    buffer[dataCount].uploaded = false;
-    buffer[dataCount].confirmed = false;
-    buffer[dataCount].compressed = compressed;
-    memcpy(buffer[dataCount].data, finalData, finalSize);
-    dataCount++;
+    uint32_t checksum = Crc32::compute(finalData, finalSize);
 
-    Serial.printf("📦 Data added: %s [%d bytes, CRC:%08X]\n", bikeId.c_str(), finalSize, checksum);
+    // Armazenar dados no fim do arena; cheio -> arena inteiro desce para a flash
+    uint32_t timestamp = time(nullptr);
+    uint32_t seq = nextSeq;
+    if (!storeRecord(seq, bikeId.c_str(), bikeId.length(), timestamp, checksum, flags, finalData, finalSize) &&
+        !(spillHotTier() && storeRecord(seq, bikeId.c_str(), bikeId.length(), timestamp, checksum, flags, finalData, finalSize)))
+    {
+        Serial.printf("❌ Buffer full: %s [%d bytes, %d/%d used]\n", bikeId.c_str(), finalSize, arenaUsed, arenaCapacity);
+        return false;
+    }
+    size_t offset = arenaUsed - sizeof(RecordHeader) - finalSize;
+
+    if (flags & RECORD_COMPRESSED) {
+        Serial.printf("📦 Data added: %s [%d→%d bytes, CRC:%08X]\n", bikeId.c_str(), originalSize, finalSize, checksum);
+    } else {
+        Serial.printf("📦 Data added: %s [%d bytes, CRC:%08X]\n", bikeId.c_str(), finalSize, checksum);
+    }
 
-    // Auto-save periodicamente
-    if (dataCount % 5 == 0) {
+    // Journal: um registro por inserção; JSON: auto-save periódico
+    if (journalMode) {
+        appendJournalData(offset);
+    } else if (dataCount % 5 == 0) {
         saveBuffer();
     }
 
@@ -92,79 +229,272 @@ bool BufferManager::addData(const String& bikeId, const uint8_t *data, size_t le
 
 bool BufferManager::needsSync()
 {
-    int threshold = (MAX_BUFFER_SIZE * 80) / 100; // 80% do buffer
+    // Ocupação real dos dois tiers (RAM + flash) contra a capacidade total
+    size_t used = arenaUsed + spillBytes;
+    size_t threshold = ((arenaCapacity + spillCapacity()) * configManager.getBufferSyncThreshold()) / 100;
     uint32_t syncInterval = configManager.getConfig().intervals.sync_sec * 1000; // sec -> ms
+    bool hasData = dataCount > 0 || spillHead < spillTail;
     
-    return dataCount >= threshold || 
-           (dataCount > 0 && (millis() - lastSync) > syncInterval);
+    return (hasData && used >= threshold) || 
+           (hasData && (millis() - lastSync) > syncInterval);
 }
 
 bool BufferManager::isCriticallyFull()
 {
-    int criticalThreshold = (MAX_BUFFER_SIZE * 95) / 100; // 95% do buffer
-    return dataCount >= criticalThreshold;
+    // Crítico só quando a flash também está quase cheia (próximo spill vai descartar dados)
+    size_t used = arenaUsed + spillBytes;
+    size_t criticalThreshold = ((arenaCapacity + spillCapacity()) * 95) / 100;
+    return spillHead < spillTail && used >= criticalThreshold;
 }
 
-bool BufferManager::getDataForUpload(DynamicJsonDocument &doc)
+static void printJsonString(Print& out, const char* value, size_t length = SIZE_MAX)
 {
-    if (dataCount == 0) {
-        return false;
+    out.write('"');
+    for (const char* p = value; length-- > 0 && *p; p++) {
+        if (*p == '"' || *p == '\\') out.write('\\');
+        if ((uint8_t)*p >= 0x20) out.write((uint8_t)*p);
     }
+    out.write('"');
+}
 
-    doc["timestamp"] = time(nullptr);
-    doc["base_id"] = configManager.getBaseId();
-    doc["data_count"] = dataCount;
+int BufferManager::beginUpload()
+{
+    // Congela a janela: as duas passadas (tamanho e envio) precisam gerar os mesmos bytes
+    uploadTimestamp = time(nullptr);
+    cursorIndex = -1;
+    uploadFromSpill = false;
+    uploadInFlight = false;
+    uploadCount = 0;
+    if (uploadFile) uploadFile.close();
 
-    JsonArray dataArray = doc.createNestedArray("data");
+    uint16_t windowSize = configManager.getConfig().limits.batch_size;
+    if (windowSize == 0) windowSize = UPLOAD_WINDOW_DEFAULT;
 
-    for (int i = 0; i < dataCount; i++)
-    {
-        JsonObject item = dataArray.createNestedObject();
-        item["bike_id"] = buffer[i].bikeId;
-        item["ts"] = buffer[i].timestamp;
-        item["size"] = buffer[i].size;
-        item["crc32"] = String(buffer[i].crc32, HEX);
-        item["compressed"] = buffer[i].compressed;
-
-        String hexData = "";
-        for (size_t j = 0; j < buffer[i].size; j++)
-        {
-            char hex[3];
-            sprintf(hex, "%02X", buffer[i].data[j]);
-            hexData += hex;
+    // Mais antigo primeiro: segmentos da flash antes do tier quente
+    while (spillHead < spillTail) {
+        char path[32];
+        spillPath(spillHead, path);
+        uploadFile = LittleFS.open(path, "r");
+        if (uploadFile) {
+            // Retomada: registros <= ackedSeq já foram confirmados numa janela anterior
+            uint8_t payload[BufferJournal::MAX_PAYLOAD];
+            BufferJournal::DataRecord record;
+            uploadSegmentDone = true;
+            while (nextWindowRecord(record, payload)) {
+                if (uploadCount == windowSize) {
+                    uploadSegmentDone = false;
+                    break;
+                }
+                if (uploadCount == 0) uploadFirstSeq = record.seq;
+                uploadLastSeq = record.seq;
+                uploadCount++;
+            }
+            if (uploadCount > 0) {
+                uploadFile.seek(0);
+                uploadFromSpill = true;
+                uploadInFlight = true;
+                return uploadCount;
+            }
         }
-        item["data"] = hexData;
-        
-        // Marcar como enviado
-        buffer[i].uploaded = true;
+        // Segmento ilegível ou já todo confirmado: nada a enviar
+        Serial.printf("⚠️ Discarding drained spill segment: %s\n", path);
+        releaseSpillSegment(true);
     }
 
-    return true;
+    if (dataCount == 0) return 0;
+
+    uploadCount = dataCount < windowSize ? dataCount : windowSize;
+    RecordHeader header;
+    readRecord(0, header);
+    uploadFirstSeq = header.seq;
+    readRecord(offsetOf(uploadCount - 1), header);
+    uploadLastSeq = header.seq;
+    uploadInFlight = true;
+    return uploadCount;
+}
+
+void BufferManager::writeUploadHeader(Print& out)
+{
+    // Chave = primeiro seq da janela: reenvio da mesma janela sobrescreve o mesmo nó
+    out.printf("{\"%010lu\":{\"timestamp\":%lu,\"base_id\":", (unsigned long)uploadFirstSeq, (unsigned long)uploadTimestamp);
+    printJsonString(out, configManager.getConfig().base_id);
+    out.printf(",\"first_seq\":%lu,\"last_seq\":%lu,\"data_count\":%u,\"encoding\":\"base64\",\"data\":[",
+               (unsigned long)uploadFirstSeq, (unsigned long)uploadLastSeq, uploadCount);
+}
+
+void BufferManager::writeUploadItem(int index, Print& out)
+{
+    BufferJournal::DataRecord record;
+
+    if (uploadFromSpill) {
+        // Leitura sequencial do segmento; voltar ao início só na segunda passada
+        uint8_t payload[BufferJournal::MAX_PAYLOAD];
+        if (index <= cursorIndex) {
+            uploadFile.seek(0);
+            cursorIndex = -1;
+        }
+        while (cursorIndex < index && nextWindowRecord(record, payload)) {
+            cursorIndex++;
+        }
+        if (cursorIndex == index) writeUploadRecord(index, record, out);
+        return;
+    }
+
+    size_t offset = offsetOf(index);
+    RecordHeader item;
+    readRecord(offset, item);
+
+    record.seq = item.seq;
+    record.timestamp = item.timestamp;
+    record.itemCrc = item.crc32;
+    record.flags = item.flags;
+    record.bikeId = (const char*)(arena + offset + offsetof(RecordHeader, bikeId));
+    record.bikeIdLen = strnlen(record.bikeId, BIKE_ID_LENGTH);
+    record.data = arena + offset + sizeof(RecordHeader);
+    record.size = item.size;
+    writeUploadRecord(index, record, out);
+}
+
+void BufferManager::writeUploadRecord(int index, const BufferJournal::DataRecord& record, Print& out)
+{
+    const uint8_t* data = record.data;
+    size_t size = record.size;
+    uint32_t crc = record.itemCrc;
+
+    // Item binário: a borda do Firebase continua recebendo JSON (mesmo
+    // "data" em base64 de antes); as duas passadas geram os mesmos bytes.
+    // Sem JSON (mensagem inválida): sobe o TLV cru com "wire":true, nada se perde
+    static char wireJson[WIRE_JSON_MAX];
+    bool rawWire = false;
+    if (record.flags & RECORD_WIRE) {
+        size_t jsonSize = WireFormat::toJson(record.data, record.size, record.timestamp, wireJson, sizeof(wireJson));
+        if (jsonSize > 0) {
+            data = (const uint8_t*)wireJson;
+            size = jsonSize;
+            crc = Crc32::compute(data, size);
+        } else {
+            rawWire = true;
+            Serial.printf("⚠️ Upload: wire item seq %lu not renderable - sending raw\n", (unsigned long)record.seq);
+        }
+    }
+
+    if (index > 0) out.write(',');
+    out.printf("{\"seq\":%lu,\"bike_id\":", (unsigned long)record.seq);
+    printJsonString(out, record.bikeId, record.bikeIdLen);
+    out.printf(",\"ts\":%lu,\"size\":%u,\"crc32\":\"%x\",\"compressed\":%s,",
+               (unsigned long)record.timestamp, (unsigned)size, (unsigned)crc,
+               (record.flags & RECORD_COMPRESSED) ? "true" : "false");
+    if (rawWire) out.print("\"wire\":true,");
+    out.print("\"data\":\"");
+
+    // Base64 em blocos múltiplos de 3 bytes: concatenados dão o mesmo texto
+    char encoded[Base64Codec::encodedLength(MAX_ITEM_SIZE)];
+    for (size_t offset = 0; offset < size; offset += MAX_ITEM_SIZE - MAX_ITEM_SIZE % 3) {
+        size_t part = size - offset;
+        if (part > MAX_ITEM_SIZE - MAX_ITEM_SIZE % 3) part = MAX_ITEM_SIZE - MAX_ITEM_SIZE % 3;
+        out.write((const uint8_t*)encoded, Base64Codec::encode(data + offset, part, encoded));
+    }
+    out.print("\"}");
+}
+
+void BufferManager::writeUploadFooter(Print& out)
+{
+    out.print("]}}");
 }
 
 void BufferManager::markAsConfirmed()
 {
-    // Criar backup antes de limpar
-    createBackup();
-    
-    // Limpar dados confirmados
-    dataCount = 0;
+    if (!uploadInFlight) return;
+    uploadInFlight = false;
+
+    // Avança o high-water mark primeiro; só então libera a janela confirmada
+    if (uploadLastSeq > ackedSeq) ackedSeq = uploadLastSeq;
     lastSync = millis();
-    saveBuffer();
+
+    if (uploadFromSpill) {
+        spillRecords = spillRecords > uploadCount ? spillRecords - uploadCount : 0;
+        if (uploadSegmentDone) {
+            // Segmento todo confirmado: vira backup por rename, sem copiar
+            releaseSpillSegment(true);
+        } else {
+            uploadFile.close();
+            uploadFromSpill = false;
+        }
+        if (journalMode) {
+            appendJournalTrim(0);
+        } else {
+            saveBuffer();
+        }
+        Serial.printf("✅ Spill window %lu-%lu confirmed (%lu segments left)\n",
+                      (unsigned long)uploadFirstSeq, (unsigned long)uploadLastSeq,
+                      (unsigned long)(spillTail - spillHead));
+        return;
+    }
+
+    // Libera só até o fim da janela; registros que chegaram durante o upload ficam.
+    // Journal: os registros confirmados continuam no segmento, que vira backup na rotação.
+    if (journalMode) {
+        appendJournalTrim(ackedSeq);
+    } else {
+        createBackup();
+    }
+    releaseThrough(ackedSeq);
+    if (!journalMode) {
+        saveBuffer();
+    }
     
-    Serial.println("✅ Buffer cleared after confirmed upload");
+    Serial.printf("✅ Window %lu-%lu confirmed, %d items left\n",
+                  (unsigned long)uploadFirstSeq, (unsigned long)uploadLastSeq, dataCount);
 }
 
 void BufferManager::rollbackUpload()
 {
-    // Marcar dados como não enviados em caso de falha
-    for (int i = 0; i < dataCount; i++) {
-        buffer[i].uploaded = false;
+    // Nada a desfazer: o high-water mark não andou, a próxima tentativa recomeça desta janela
+    uploadInFlight = false;
+    if (uploadFromSpill) {
+        uploadFile.close();
+        uploadFromSpill = false;
     }
-    Serial.println("⚠️ Upload failed - data marked as pending");
+    Serial.printf("⚠️ Upload failed - window %lu-%lu kept as pending\n",
+                  (unsigned long)uploadFirstSeq, (unsigned long)uploadLastSeq);
 }
 
 void BufferManager::loadBuffer()
+{
+    dataCount = 0;
+    arenaUsed = 0;
+    lastSync = 0;
+    nextSeq = 1;
+    ackedSeq = 0;
+
+    if (!journalMode) {
+        loadJsonBuffer();
+        return;
+    }
+
+    // Compactação interrompida entre o remove e o rename
+    if (!LittleFS.exists(BUFFER_JOURNAL_FILE) && LittleFS.exists(BUFFER_JOURNAL_TMP_FILE)) {
+        LittleFS.rename(BUFFER_JOURNAL_TMP_FILE, BUFFER_JOURNAL_FILE);
+    }
+
+    if (LittleFS.exists(BUFFER_JOURNAL_FILE)) {
+        // Cauda corrompida (ex: queda de energia no meio da escrita) -> reescrever só o que é válido
+        if (!replayJournal()) {
+            compactJournal();
+        }
+        return;
+    }
+
+    // Migração: buffer antigo em JSON vira o primeiro segmento do journal
+    if (LittleFS.exists(BUFFER_FILE)) {
+        loadJsonBuffer();
+        compactJournal();
+        LittleFS.remove(BUFFER_FILE);
+        Serial.printf("🔄 Buffer migrated from JSON to journal: %d items\n", dataCount);
+    }
+}
+
+void BufferManager::loadJsonBuffer()
 {
     if (!LittleFS.exists(BUFFER_FILE)) {
         dataCount = 0;
@@ -175,69 +505,88 @@ void BufferManager::loadBuffer()
     File file = LittleFS.open(BUFFER_FILE, "r");
     if (!file) return;
 
-    DynamicJsonDocument doc(8192);
+    DynamicJsonDocument doc(file.size() * 2 + 1024);
     if (deserializeJson(doc, file) != DeserializationError::Ok) {
         file.close();
         return;
     }
     file.close();
 
-    dataCount = doc["data_count"] | 0;
     lastSync = doc["last_sync"] | 0;
+    ackedSeq = doc["acked_seq"] | 0;
+    noteSeq(doc["next_seq"] | 0);
+    noteSeq(ackedSeq);
 
     JsonArray dataArray = doc["buffer"];
-    int loadedCount = 0;
+    bool hexEncoded = strcmp(doc["encoding"] | "hex", "base64") != 0;
+    uint8_t data[MAX_ITEM_SIZE];
 
     for (JsonObject item : dataArray) {
-        if (loadedCount >= MAX_BUFFER_SIZE) break;
-
-        buffer[loadedCount].bikeId = item["bike_id"] | "unknown";
-        buffer[loadedCount].timestamp = item["ts"];
-        buffer[loadedCount].size = item["size"];
-        buffer[loadedCount].crc32 = strtoul(item["crc32"] | "0", NULL, 16);
-        buffer[loadedCount].uploaded = item["uploaded"] | false;
-        buffer[loadedCount].confirmed = item["confirmed"] | false;
-        buffer[loadedCount].compressed = item["compressed"] | false;
-
-        String hexData = item["data"];
-        size_t dataSize = hexData.length() / 2;
-
-        for (size_t i = 0; i < dataSize && i < 256; i++) {
-            String byteString = hexData.substring(i * 2, i * 2 + 2);
-            buffer[loadedCount].data[i] = strtol(byteString.c_str(), NULL, 16);
+        const char* bikeId = item["bike_id"] | "unknown";
+        size_t size = item["size"];
+
+        const char* encoded = item["data"] | "";
+        size_t encodedLength = strlen(encoded);
+        size_t decoded = hexEncoded
+            ? Base64Codec::decodeHex(encoded, encodedLength, data, sizeof(data))
+            : Base64Codec::decode(encoded, encodedLength, data, sizeof(data));
+
+        if (decoded == 0 || decoded != size) {
+            Serial.printf("⚠️ Skipping undecodable buffer item from %s\n", bikeId);
+            continue;
         }
 
-        loadedCount++;
-    }
+        uint32_t crc = strtoul(item["crc32"] | "0", NULL, 16);
+        if (Crc32::compute(data, size) != crc) {
+            Serial.printf("⚠️ Skipping buffer item with bad CRC from %s\n", bikeId);
+            continue;
+        }
+
+        // Arquivos antigos não têm seq: numerar na ordem em que aparecem
+        uint32_t seq = item["seq"] | 0;
+        if (seq == 0) seq = nextSeq;
+        uint8_t flags = (item["compressed"] | false) ? RECORD_COMPRESSED : 0;
+        if (item["wire"] | false) flags |= RECORD_WIRE;
 
-    dataCount = loadedCount;
+        if (!storeRecord(seq, bikeId, strlen(bikeId), item["ts"], crc, flags, data, size)) {
+            Serial.println("⚠️ Buffer arena full, dropping remaining JSON items");
+            break;
+        }
+    }
 }
 
 void BufferManager::saveBuffer()
 {
-    DynamicJsonDocument doc(8192);
+    // Base64 cresce 4/3 + chaves/metadados por item
+    DynamicJsonDocument doc(1024 + arenaUsed * 2 + dataCount * 192);
 
     doc["data_count"] = dataCount;
     doc["last_sync"] = lastSync;
+    doc["acked_seq"] = ackedSeq;
+    doc["next_seq"] = nextSeq;
+    doc["encoding"] = "base64";
 
     JsonArray dataArray = doc.createNestedArray("buffer");
-    for (int i = 0; i < dataCount; i++) {
+    for (size_t offset = 0; offset < arenaUsed; offset += recordSize(offset)) {
+        RecordHeader header;
+        readRecord(offset, header);
+
+        // char* (não const) -> ArduinoJson copia para o documento
+        char bikeId[BIKE_ID_LENGTH + 1];
+        copyBikeId(header, bikeId);
+
         JsonObject item = dataArray.createNestedObject();
-        item["bike_id"] = buffer[i].bikeId;
-        item["ts"] = buffer[i].timestamp;
-        item["size"] = buffer[i].size;
-        item["crc32"] = String(buffer[i].crc32, HEX);
-        item["uploaded"] = buffer[i].uploaded;
-        item["confirmed"] = buffer[i].confirmed;
-        item["compressed"] = buffer[i].compressed;
-
-        String hexData = "";
-        for (size_t j = 0; j < buffer[i].size; j++) {
-            char hex[3];
-            sprintf(hex, "%02X", buffer[i].data[j]);
-            hexData += hex;
-        }
-        item["data"] = hexData;
+        item["seq"] = header.seq;
+        item["bike_id"] = bikeId;
+        item["ts"] = header.timestamp;
+        item["size"] = header.size;
+        item["crc32"] = String(header.crc32, HEX);
+        item["compressed"] = (header.flags & RECORD_COMPRESSED) != 0;
+        if (header.flags & RECORD_WIRE) item["wire"] = true;
+
+        char encoded[Base64Codec::encodedLength(MAX_ITEM_SIZE) + 1];
+        encoded[Base64Codec::encode(arena + offset + sizeof(RecordHeader), header.size, encoded)] = '\0';
+        item["data"] = encoded;
     }
 
     File file = LittleFS.open(BUFFER_FILE, "w");
@@ -247,73 +596,688 @@ void BufferManager::saveBuffer()
     }
 }
 
+size_t BufferManager::encodeJournalItem(size_t offset, uint8_t* payload)
+{
+    RecordHeader item;
+    readRecord(offset, item);
+
+    BufferJournal::DataRecord record;
+    record.seq = item.seq;
+    record.timestamp = item.timestamp;
+    record.itemCrc = item.crc32;
+    record.flags = item.flags & BufferJournal::FLAG_MASK;
+    record.bikeId = (const char*)(arena + offset + offsetof(RecordHeader, bikeId));
+    record.bikeIdLen = strnlen(record.bikeId, BIKE_ID_LENGTH);
+    record.data = arena + offset + sizeof(RecordHeader);
+    record.size = item.size;
+
+    return BufferJournal::encodeData(payload, BufferJournal::MAX_PAYLOAD, record);
+}
+
+size_t BufferManager::writeJournalRecord(File& file, uint8_t type, const uint8_t* payload, size_t length)
+{
+    uint8_t header[BufferJournal::HEADER_SIZE];
+    BufferJournal::writeHeader(header, type, length, Crc32::compute(payload, length));
+
+    size_t written = file.write(header, sizeof(header));
+    written += file.write(payload, length);
+    return written;
+}
+
+bool BufferManager::appendJournalData(size_t offset)
+{
+    uint8_t payload[BufferJournal::MAX_PAYLOAD];
+    size_t length = encodeJournalItem(offset, payload);
+    if (length == 0) return false;
+
+    RecordHeader item;
+    readRecord(offset, item);
+    noteJournalSeq(item.seq);
+    return appendJournalRecord(BufferJournal::RECORD_DATA_SEQ, payload, length);
+}
+
+void BufferManager::noteJournalSeq(uint32_t seq)
+{
+    if (journalFirstSeq == 0 || seq < journalFirstSeq) journalFirstSeq = seq;
+    if (seq > journalLastSeq) journalLastSeq = seq;
+}
+
+bool BufferManager::appendJournalTrim(uint32_t through)
+{
+    // Leva o high-water mark atual junto: é assim que ackedSeq sobrevive a um reboot
+    uint8_t payload[BufferJournal::TRIM_SIZE];
+    size_t length = BufferJournal::encodeTrim(payload, through, ackedSeq);
+    return appendJournalRecord(BufferJournal::RECORD_TRIM, payload, length);
+}
+
+bool BufferManager::appendJournalRecord(uint8_t type, const uint8_t* payload, size_t length)
+{
+    File file = LittleFS.open(BUFFER_JOURNAL_FILE, "a");
+    if (!file) {
+        Serial.println("❌ Failed to open buffer journal");
+        return false;
+    }
+
+    size_t written = writeJournalRecord(file, type, payload, length);
+    file.close();
+    journalSize += written;
+
+    if (written != BufferJournal::HEADER_SIZE + length) {
+        Serial.println("❌ Short write on buffer journal");
+        return false;
+    }
+
+    // Compactar só quando o segmento enche
+    if (journalSize >= JOURNAL_SEGMENT_SIZE) {
+        compactJournal();
+    }
+    return true;
+}
+
+bool BufferManager::replayJournal()
+{
+    File file = LittleFS.open(BUFFER_JOURNAL_FILE, "r");
+    if (!file) return false;
+
+    uint8_t header[BufferJournal::HEADER_SIZE];
+    uint8_t payload[BufferJournal::MAX_PAYLOAD];
+    bool clean = true;
+    size_t offset = 0;
+    int corrupt = 0;
+
+    while (file.available()) {
+        BufferJournal::RecordHeader h;
+        if (file.read(header, sizeof(header)) != sizeof(header) ||
+            !BufferJournal::parseHeader(header, h) ||
+            file.read(payload, h.length) != h.length) {
+            clean = false;
+            break;
+        }
+
+        if (Crc32::compute(payload, h.length) != h.crc) {
+            clean = false;
+            break;
+        }
+        offset += sizeof(header) + h.length;
+
+        if (h.type == BufferJournal::RECORD_TRIM) {
+            uint32_t through, acked;
+            if (BufferJournal::decodeTrim(payload, h.length, through, acked)) {
+                if (acked > ackedSeq) ackedSeq = acked;
+                noteSeq(ackedSeq);
+                releaseThrough(through);
+            }
+            continue;
+        }
+
+        if (h.type == BufferJournal::RECORD_TOMBSTONE) {
+            uint16_t count;
+            if (BufferJournal::decodeTombstone(payload, h.length, count)) {
+                dropOldest(count);
+            }
+            continue;
+        }
+
+        BufferJournal::DataRecord record;
+        if (!BufferJournal::decodeData(h.type, payload, h.length, record) || record.size > MAX_ITEM_SIZE) {
+            continue;
+        }
+        // Journal legado não tem seq: numerar na ordem de inserção
+        if (record.seq == 0) record.seq = nextSeq;
+        noteJournalSeq(record.seq);
+        if (record.seq <= ackedSeq) continue;
+        if (Crc32::compute(record.data, record.size) != record.itemCrc) {
+            Serial.printf("⚠️ Journal replay: CRC mismatch on seq %lu, skipping\n", (unsigned long)record.seq);
+            corrupt++;
+            continue;
+        }
+        if (!storeRecord(record.seq, record.bikeId, record.bikeIdLen, record.timestamp, record.itemCrc,
+                         record.flags & BufferJournal::FLAG_MASK, record.data, record.size)) {
+            Serial.println("⚠️ Journal replay: buffer full, dropping record");
+        }
+    }
+
+    file.close();
+    journalSize = offset;
+
+    Serial.printf("📜 Journal replayed: %d items, %d bytes%s\n",
+                  dataCount, offset, clean ? "" : " (corrupt tail discarded)");
+    if (corrupt > 0) {
+        Serial.printf("⚠️ %d corrupt records skipped\n", corrupt);
+    }
+    return clean;
+}
+
+void BufferManager::compactJournal()
+{
+    File tmp = LittleFS.open(BUFFER_JOURNAL_TMP_FILE, "w");
+    if (!tmp) {
+        Serial.println("❌ Failed to create journal compaction file");
+        return;
+    }
+
+    // Segmento novo começa pelo high-water mark, depois só os registros vivos
+    uint8_t payload[BufferJournal::MAX_PAYLOAD];
+    size_t written = writeJournalRecord(tmp, BufferJournal::RECORD_TRIM, payload,
+                                        BufferJournal::encodeTrim(payload, 0, ackedSeq));
+    for (size_t offset = 0; offset < arenaUsed; offset += recordSize(offset)) {
+        size_t length = encodeJournalItem(offset, payload);
+        if (length > 0) {
+            written += writeJournalRecord(tmp, BufferJournal::RECORD_DATA_SEQ, payload, length);
+        }
+    }
+    tmp.close();
+
+    // Troca atômica; se o rename falhar, o .tmp é recuperado no próximo boot.
+    // O segmento antigo (com os registros já confirmados) vira o backup: só um rename.
+    if (!configManager.getBackupEnabled() || !LittleFS.exists(BUFFER_JOURNAL_FILE) ||
+        !registerBackup(BUFFER_JOURNAL_FILE, BackupManifest::KIND_JOURNAL, journalFirstSeq, journalLastSeq)) {
+        LittleFS.remove(BUFFER_JOURNAL_FILE);
+    }
+    LittleFS.rename(BUFFER_JOURNAL_TMP_FILE, BUFFER_JOURNAL_FILE);
+    journalSize = written;
+
+    // Novo segmento contém só os registros vivos
+    journalFirstSeq = 0;
+    journalLastSeq = 0;
+    for (size_t offset = 0; offset < arenaUsed; offset += recordSize(offset)) {
+        RecordHeader header;
+        readRecord(offset, header);
+        noteJournalSeq(header.seq);
+    }
+
+    Serial.printf("🗜️ Journal compacted: %d live items, %d bytes\n", dataCount, written);
+}
+
+void BufferManager::dropOldest(uint16_t count)
+{
+    if (count >= dataCount) {
+        dataCount = 0;
+        arenaUsed = 0;
+        return;
+    }
+
+    // Registros são contíguos: um memmove desloca o restante para o início
+    size_t offset = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        offset += recordSize(offset);
+    }
+    memmove(arena, arena + offset, arenaUsed - offset);
+    arenaUsed -= offset;
+    dataCount -= count;
+    cursorIndex = -1;
+}
+
+void BufferManager::releaseThrough(uint32_t seq)
+{
+    // Arena em ordem de seq: conta o prefixo <= seq
+    uint16_t count = 0;
+    for (size_t offset = 0; offset < arenaUsed; offset += recordSize(offset)) {
+        RecordHeader header;
+        readRecord(offset, header);
+        if (header.seq > seq) break;
+        count++;
+    }
+    if (count > 0) dropOldest(count);
+}
+
+void BufferManager::spillPath(uint32_t id, char* out)
+{
+    sprintf(out, "/spill_%08lu.seg", (unsigned long)id);
+}
+
+bool BufferManager::readSegmentRecord(File& file, BufferJournal::DataRecord& record, uint8_t* payload)
+{
+    uint8_t header[BufferJournal::HEADER_SIZE];
+    BufferJournal::RecordHeader h;
+
+    while (file.read(header, sizeof(header)) == sizeof(header) &&
+           BufferJournal::parseHeader(header, h) &&
+           file.read(payload, h.length) == h.length) {
+        if (Crc32::compute(payload, h.length) != h.crc) return false;
+
+        // Item corrompido é pulado (não enviado); contagem e janela usam a mesma leitura
+        if (BufferJournal::decodeData(h.type, payload, h.length, record) && record.size <= MAX_ITEM_SIZE &&
+            Crc32::compute(record.data, record.size) == record.itemCrc) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BufferManager::nextWindowRecord(BufferJournal::DataRecord& record, uint8_t* payload)
+{
+    while (readSegmentRecord(uploadFile, record, payload)) {
+        if (record.seq > ackedSeq) return true;
+    }
+    return false;
+}
+
+uint16_t BufferManager::countSegmentRecords(File& file, uint32_t afterSeq, uint32_t* minSeq, uint32_t* maxSeq)
+{
+    uint8_t payload[BufferJournal::MAX_PAYLOAD];
+    BufferJournal::DataRecord record;
+    uint16_t count = 0;
+
+    file.seek(0);
+    while (readSegmentRecord(file, record, payload)) {
+        if (record.seq > afterSeq) count++;
+        if (minSeq && (*minSeq == 0 || record.seq < *minSeq)) *minSeq = record.seq;
+        if (maxSeq && record.seq > *maxSeq) *maxSeq = record.seq;
+    }
+    file.seek(0);
+    return count;
+}
+
+void BufferManager::scanSpillSegments()
+{
+    spillHead = UINT32_MAX;
+    spillTail = 0;
+    spillRecords = 0;
+    spillBytes = 0;
+
+    File root = LittleFS.open("/");
+    File file = root.openNextFile();
+
+    while (file) {
+        String fileName = file.name();
+        if (fileName.startsWith("spill_")) {
+            if (fileName.endsWith(".seg")) {
+                uint32_t id = strtoul(fileName.c_str() + 6, NULL, 10);
+                if (id < spillHead) spillHead = id;
+                if (id + 1 > spillTail) spillTail = id + 1;
+                uint32_t maxSeq = 0;
+                spillRecords += countSegmentRecords(file, ackedSeq, nullptr, &maxSeq);
+                spillBytes += file.size();
+                noteSeq(maxSeq);
+            } else {
+                // Spill interrompido antes do rename: os registros ainda estão no journal
+                file.close();
+                LittleFS.remove("/" + fileName);
+            }
+        }
+        file = root.openNextFile();
+    }
+
+    if (spillHead > spillTail) spillHead = spillTail;
+}
+
+size_t BufferManager::spillCapacity()
+{
+    // Limite pela config (segmentos) e pelo espaço livre acima da reserva mínima
+    size_t byConfig = (size_t)configManager.getBufferMaxSize() * arenaCapacity;
+    size_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+    size_t reserve = (size_t)configManager.getStorageMinFreeKB() * 1024;
+    size_t byFlash = spillBytes + (freeBytes > reserve ? freeBytes - reserve : 0);
+
+    return byConfig < byFlash ? byConfig : byFlash;
+}
+
+bool BufferManager::spillHotTier()
+{
+    if (dataCount == 0 || !arena) return false;
+
+    // Flash cheia: backups (já confirmados) saem antes de qualquer dado pendente
+    while (backupCount > 0 && spillBytes + arenaUsed > spillCapacity()) {
+        removeBackup(0);
+    }
+    saveManifest();
+
+    // Ainda cheia: descartar o segmento mais antigo (dados novos têm prioridade)
+    while (spillHead < spillTail && !uploadFile &&
+           (spillTail - spillHead >= (uint32_t)configManager.getBufferMaxSize() ||
+            spillBytes + arenaUsed > spillCapacity())) {
+        Serial.println("⚠️ Spill tier full - dropping oldest segment");
+        releaseSpillSegment(false);
+    }
+    if (spillBytes + arenaUsed > spillCapacity()) {
+        Serial.println("❌ No flash space to spill buffer");
+        return false;
+    }
+
+    char path[32];
+    char tmpPath[32];
+    spillPath(spillTail, path);
+    sprintf(tmpPath, "/spill_%08lu.tmp", (unsigned long)spillTail);
+
+    File file = LittleFS.open(tmpPath, "w");
+    if (!file) {
+        Serial.println("❌ Failed to create spill segment");
+        return false;
+    }
+
+    uint8_t payload[BufferJournal::MAX_PAYLOAD];
+    size_t written = 0;
+    for (size_t offset = 0; offset < arenaUsed; offset += recordSize(offset)) {
+        size_t length = encodeJournalItem(offset, payload);
+        if (length > 0) {
+            written += writeJournalRecord(file, BufferJournal::RECORD_DATA_SEQ, payload, length);
+        }
+    }
+    file.close();
+
+    // Segmento só passa a existir completo; queda antes disso deixa os dados no journal
+    if (!LittleFS.rename(tmpPath, path)) {
+        LittleFS.remove(tmpPath);
+        Serial.println("❌ Failed to commit spill segment");
+        return false;
+    }
+
+    Serial.printf("💽 Buffer spilled to flash: %s [%d items, %d bytes]\n", path, dataCount, written);
+    spillTail++;
+    spillRecords += dataCount;
+    spillBytes += written;
+
+    // Todos os registros do arena agora vivem no segmento. Esvaziar antes do trim:
+    // o append pode compactar o journal, e a compactação regrava o arena inteiro
+    // (registros duplicados no segmento e no journal depois de um reboot)
+    dataCount = 0;
+    arenaUsed = 0;
+    cursorIndex = -1;
+    if (journalMode) {
+        appendJournalTrim(nextSeq - 1);
+    } else {
+        saveBuffer();
+    }
+    return true;
+}
+
+void BufferManager::releaseSpillSegment(bool keepBackup)
+{
+    char path[32];
+    spillPath(spillHead, path);
+
+    size_t size = 0;
+    uint16_t records = 0;
+    uint32_t firstSeq = 0;
+    uint32_t lastSeq = 0;
+    if (uploadFile) {
+        size = uploadFile.size();
+        records = countSegmentRecords(uploadFile, ackedSeq, &firstSeq, &lastSeq);
+        uploadFile.close();
+    } else {
+        File file = LittleFS.open(path, "r");
+        if (file) {
+            size = file.size();
+            records = countSegmentRecords(file, ackedSeq, &firstSeq, &lastSeq);
+            file.close();
+        }
+    }
+    uploadFromSpill = false;
+
+    if (!keepBackup || !configManager.getBackupEnabled() || size == 0 ||
+        !registerBackup(path, BackupManifest::KIND_JOURNAL, firstSeq, lastSeq)) {
+        LittleFS.remove(path);
+    }
+
+    spillHead++;
+    spillBytes = spillBytes > size ? spillBytes - size : 0;
+    spillRecords = spillRecords > records ? spillRecords - records : 0;
+}
+
 void BufferManager::createBackup()
 {
-    if (dataCount == 0) return;
+    // Só o modo JSON copia; no journal o backup é a rotação do segmento (compactJournal)
+    if (dataCount == 0 || !configManager.getBackupEnabled()) return;
 
-    char backupFile[64];
-    sprintf(backupFile, "/backup_%lu.json", time(nullptr));
+    RecordHeader first, last;
+    readRecord(0, first);
+    readRecord(offsetOf(dataCount - 1), last);
+    registerBackup(BUFFER_FILE, BackupManifest::KIND_JSON, first.seq, last.seq);
+}
 
-    File source = LittleFS.open(BUFFER_FILE, "r");
-    File backup = LittleFS.open(backupFile, "w");
-    
-    if (source && backup) {
-        while (source.available()) {
-            backup.write(source.read());
+void BufferManager::loadManifest()
+{
+    backupCount = 0;
+    nextBackupId = 1;
+
+    File file = LittleFS.open(BACKUP_MANIFEST_FILE, "r");
+    if (!file) {
+        // Primeiro boot com índice: adotar os backups nomeados por timestamp
+        importLegacyBackups();
+        return;
+    }
+
+    uint8_t data[BackupManifest::MAX_FILE_SIZE];
+    size_t length = file.read(data, sizeof(data));
+    file.close();
+
+    int count = BackupManifest::decode(data, length, backups, BackupManifest::MAX_ENTRIES);
+    if (count < 0) {
+        Serial.println("⚠️ Backup manifest corrupt - rebuilding");
+        importLegacyBackups();
+        return;
+    }
+
+    backupCount = count;
+    for (int i = 0; i < backupCount; i++) {
+        if (backups[i].id >= nextBackupId) nextBackupId = backups[i].id + 1;
+    }
+}
+
+void BufferManager::saveManifest()
+{
+    uint8_t data[BackupManifest::MAX_FILE_SIZE];
+    size_t length = BackupManifest::encode(backups, backupCount, data);
+
+    File file = LittleFS.open(BACKUP_MANIFEST_TMP_FILE, "w");
+    if (!file) return;
+    size_t written = file.write(data, length);
+    file.close();
+
+    if (written == length) {
+        LittleFS.remove(BACKUP_MANIFEST_FILE);
+        LittleFS.rename(BACKUP_MANIFEST_TMP_FILE, BACKUP_MANIFEST_FILE);
+    }
+}
+
+void BufferManager::importLegacyBackups()
+{
+    // Única listagem do diretório: renomeia backup_<ts>[_<n>].<ext> para o esquema por id
+    File root = LittleFS.open("/");
+    File file = root.openNextFile();
+
+    while (file && backupCount < BackupManifest::MAX_ENTRIES) {
+        String fileName = file.name();
+        size_t size = file.size();
+        file.close();
+
+        if (fileName.startsWith("backup_")) {
+            BackupManifest::Entry& entry = backups[backupCount];
+            entry.id = nextBackupId++;
+            entry.timestamp = fileName.substring(7).toInt();
+            entry.size = size;
+            entry.firstSeq = 0;
+            entry.lastSeq = 0;
+            entry.kind = fileName.endsWith(".bpa") ? (BackupManifest::KIND_JOURNAL | BackupManifest::KIND_ARCHIVED)
+                       : fileName.endsWith(".json") ? BackupManifest::KIND_JSON
+                       : BackupManifest::KIND_JOURNAL;
+
+            char path[48];
+            BackupManifest::path(entry, path);
+            if (LittleFS.rename("/" + fileName, String(path))) backupCount++;
         }
-        Serial.printf("💾 Backup created: %s\n", backupFile);
+        file = root.openNextFile();
     }
-    
-    if (source) source.close();
-    if (backup) backup.close();
+
+    saveManifest();
+    if (backupCount > 0) {
+        Serial.printf("📇 Backup manifest rebuilt: %d backups\n", backupCount);
+    }
+}
+
+bool BufferManager::registerBackup(const char* source, uint8_t kind, uint32_t firstSeq, uint32_t lastSeq)
+{
+    if (backupCount >= BackupManifest::MAX_ENTRIES) {
+        removeBackup(0);
+    }
+
+    BackupManifest::Entry& entry = backups[backupCount];
+    entry.id = nextBackupId++;
+    entry.timestamp = time(nullptr);
+    entry.size = 0;
+    entry.firstSeq = firstSeq;
+    entry.lastSeq = lastSeq;
+    entry.kind = kind;
+
+    char path[48];
+    BackupManifest::path(entry, path);
+
+    if (kind == BackupManifest::KIND_JSON) {
+        // JSON continua em uso depois do backup: cópia em blocos
+        File input = LittleFS.open(source, "r");
+        File output = LittleFS.open(path, "w");
+        if (input && output) {
+            uint8_t block[512];
+            size_t length;
+            while ((length = input.read(block, sizeof(block))) > 0) {
+                entry.size += output.write(block, length);
+            }
+        }
+        if (input) input.close();
+        if (output) output.close();
+        if (entry.size == 0) {
+            LittleFS.remove(path);
+            return false;
+        }
+    } else {
+        // Segmento imutável: o backup é o próprio arquivo
+        File input = LittleFS.open(source, "r");
+        if (!input) return false;
+        entry.size = input.size();
+        input.close();
+        if (!LittleFS.rename(source, path)) return false;
+    }
+
+    backupCount++;
+    saveManifest();
+    Serial.printf("💾 Backup created: %s [seq %lu-%lu, %lu bytes]\n", path,
+                  (unsigned long)firstSeq, (unsigned long)lastSeq, (unsigned long)entry.size);
+    return true;
+}
+
+void BufferManager::removeBackup(uint8_t index)
+{
+    if (index >= backupCount) return;
+
+    char path[48];
+    BackupManifest::path(backups[index], path);
+    LittleFS.remove(path);
+    Serial.printf("🗑️ Backup removed: %s\n", path);
+
+    for (uint8_t i = index + 1; i < backupCount; i++) {
+        backups[i - 1] = backups[i];
+    }
+    backupCount--;
+}
+
+bool BufferManager::archiveBackup(uint8_t index)
+{
+    BackupManifest::Entry& entry = backups[index];
+    char path[48];
+    char archivePath[48];
+    BackupManifest::path(entry, path);
+
+    BackupManifest::Entry archived = entry;
+    archived.kind |= BackupManifest::KIND_ARCHIVED;
+    BackupManifest::path(archived, archivePath);
+
+    File source = LittleFS.open(path, "r");
+    if (!source) {
+        // Arquivo sumiu (queda entre o índice e o rename): esquecer a entrada
+        removeBackup(index);
+        saveManifest();
+        return false;
+    }
+
+    File archive = LittleFS.open(archivePath, "w");
+    if (!archive) {
+        source.close();
+        return false;
+    }
+
+    static uint8_t raw[BackupArchive::BLOCK_SIZE];
+    static uint8_t block[BackupArchive::MAX_BLOCK];
+    uint8_t fileHeader[BackupArchive::FILE_HEADER_SIZE];
+    BackupArchive::writeFileHeader(fileHeader);
+
+    size_t sourceSize = source.size();
+    size_t written = archive.write(fileHeader, sizeof(fileHeader));
+    size_t expected = sizeof(fileHeader);
+    size_t length;
+
+    while ((length = source.read(raw, sizeof(raw))) > 0) {
+        size_t blockSize = BackupArchive::encodeBlock(raw, length, Crc32::compute(raw, length), block);
+        written += archive.write(block, blockSize);
+        expected += blockSize;
+    }
+    source.close();
+    archive.close();
+
+    // Falha de escrita (flash cheia): mantém o original
+    if (written != expected) {
+        LittleFS.remove(archivePath);
+        return false;
+    }
+
+    LittleFS.remove(path);
+    archived.size = written;
+    entry = archived;
+    saveManifest();
+    Serial.printf("🗜️ Backup archived: %s [%d→%d bytes]\n", archivePath, sourceSize, written);
+    return true;
+}
+
+void BufferManager::archiveBackups()
+{
+    // Um backup cru por chamada: o custo fica fora do caminho de confirmação
+    for (uint8_t i = 0; i < backupCount; i++) {
+        if (!(backups[i].kind & BackupManifest::KIND_ARCHIVED)) {
+            archiveBackup(i);
+            break;
+        }
+    }
+    cleanupOldBackups();
 }
 
 void BufferManager::cleanupOldBackups()
 {
-    uint32_t retentionHours = configManager.getBackupRetentionHours();
-    uint32_t cutoffTime = time(nullptr) - (retentionHours * 3600);
+    uint32_t now = time(nullptr);
+    uint32_t retention = configManager.getBackupRetentionHours() * 3600;
+    bool changed = false;
     
     // Se pouco espaço, ser mais agressivo na limpeza
     if (!hasEnoughSpace()) {
         Serial.println("⚠️ Low storage - aggressive cleanup mode");
-        cutoffTime = time(nullptr) - (retentionHours * 1800); // Metade do tempo
+        retention = retention * configManager.getAggressiveCleanupMultiplier();
     }
     
-    File root = LittleFS.open("/");
-    File file = root.openNextFile();
-    
-    while (file) {
-        String fileName = file.name();
-        if (fileName.startsWith("backup_")) {
-            // Extrair timestamp do nome do arquivo
-            int underscorePos = fileName.indexOf('_');
-            int dotPos = fileName.indexOf('.');
-            if (underscorePos > 0 && dotPos > underscorePos) {
-                String timestampStr = fileName.substring(underscorePos + 1, dotPos);
-                uint32_t fileTime = timestampStr.toInt();
-                
-                if (fileTime < cutoffTime) {
-                    LittleFS.remove("/" + fileName);
-                    Serial.printf("🗑️ Old backup removed: %s\n", fileName.c_str());
-                }
-            }
+    // Idade: o índice está em ordem de criação; sem NTP o relógio não serve de referência
+    if (now > retention) {
+        while (backupCount > 0 && backups[0].timestamp < now - retention) {
+            removeBackup(0);
+            changed = true;
         }
-        file = root.openNextFile();
     }
+
+    // Espaço: abaixo de storage.min_free_kb, descartar do mais antigo até voltar ao mínimo
+    while (backupCount > 0 && !hasEnoughSpace()) {
+        removeBackup(0);
+        changed = true;
+    }
+
+    if (changed) saveManifest();
 }
 
 int BufferManager::getDataCount()
 {
-    return dataCount;
+    return dataCount + spillRecords;
 }
 
 int BufferManager::getPendingCount()
 {
-    int pending = 0;
-    for (int i = 0; i < dataCount; i++) {
-        if (!buffer[i].uploaded) pending++;
-    }
-    return pending;
+    // Tudo que não está na janela em voo
+    return getDataCount() - (uploadInFlight ? uploadCount : 0);
 }
 
 void BufferManager::printStorageInfo()
@@ -329,26 +1293,26 @@ void BufferManager::printStorageInfo()
     
     // Listar arquivos principais
     Serial.printf("📄 Main Files:\n");
-    printFileSize(BUFFER_FILE);
-    printFileSize(BIKE_REGISTRY_FILE);
+    printFileSize(journalMode ? BUFFER_JOURNAL_FILE : BUFFER_FILE);
+    Serial.printf("   Hot tier: %d items, %d/%d bytes\n", dataCount, arenaUsed, arenaCapacity);
+    Serial.printf("   Spill tier: %lu segments, %lu items, %d/%d bytes\n",
+                  (unsigned long)(spillTail - spillHead), (unsigned long)spillRecords, spillBytes, spillCapacity());
+    printFileSize(BIKE_INDEX_FILE);
     printFileSize("/central_config.json");
     
-    // Contar backups
-    int backupCount = 0;
+    // Backups pelo índice, sem listar o diretório
     size_t backupSize = 0;
-    File root = LittleFS.open("/");
-    File file = root.openNextFile();
-    
-    while (file) {
-        String fileName = file.name();
-        if (fileName.startsWith("backup_")) {
-            backupCount++;
-            backupSize += file.size();
-        }
-        file = root.openNextFile();
+    int archivedCount = 0;
+    for (uint8_t i = 0; i < backupCount; i++) {
+        backupSize += backups[i].size;
+        if (backups[i].kind & BackupManifest::KIND_ARCHIVED) archivedCount++;
     }
     
-    Serial.printf("💾 Backups: %d files, %d KB\n", backupCount, backupSize / 1024);
+    Serial.printf("💾 Backups: %d files (%d archived), %d KB\n", backupCount, archivedCount, backupSize / 1024);
+    if (backupCount > 0) {
+        Serial.printf("   Seq range: %lu-%lu, oldest %lu\n", (unsigned long)backups[0].firstSeq,
+                      (unsigned long)backups[backupCount - 1].lastSeq, (unsigned long)backups[0].timestamp);
+    }
     
     // Alerta se pouco espaço
     if (freeBytes < 10240) { // < 10KB
@@ -372,5 +1336,5 @@ void BufferManager::printFileSize(const String& filePath)
 bool BufferManager::hasEnoughSpace()
 {
     size_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
-    return freeBytes > 20480; // Mínimo 20KB livres
+    return freeBytes > (size_t)configManager.getStorageMinFreeKB() * 1024;
 }
\ No newline at end of file
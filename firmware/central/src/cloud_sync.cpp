@@ -7,6 +7,9 @@
 #include "buffer_manager.h"
 #include "led_controller.h"
 #include "bike_manager.h"
+#include "ble_server.h"
+#include "time_format.h"
+#include "upload_stream.h"
 
 extern ConfigManager configManager;
 extern BufferManager bufferManager;
@@ -14,6 +17,8 @@ extern LEDController ledController;
 extern SystemState currentState;
 extern bool firstSync;
 
+typedef UploadStream<BufferManager> BufferUploadStream;
+
 // Static members
 bool CloudSync::syncInProgress = false;
 SyncResult CloudSync::currentResult = SyncResult::SUCCESS;
@@ -189,38 +194,72 @@ bool CloudSync::downloadBikeData()
 
 bool CloudSync::uploadBufferData()
 {
-    DynamicJsonDocument doc(4096);
+    int windows = 0;
+    int items = 0;
+
+    // Uma janela por PATCH; cada confirmação avança o high-water mark, então uma
+    // falha no meio retoma da janela que falhou na próxima sync
+    while (windows < MAX_UPLOAD_WINDOWS_PER_SYNC)
+    {
+        int count = bufferManager.beginUpload();
+        if (count == 0)
+            break;
+
+        if (!uploadBufferWindow(count))
+            return false;
+
+        windows++;
+        items += count;
+    }
 
     // Early return se não há dados
-    if (!bufferManager.getDataForUpload(doc))
+    if (windows == 0)
     {
         Serial.println("📝 No buffer data to upload");
         return true; // Não ter dados não é erro
     }
 
+    Serial.printf("📤 Buffer upload: %d windows, %d items (%d still pending)\n",
+                  windows, items, bufferManager.getPendingCount());
+
+    // Backups novos saíram das janelas confirmadas; compactar fora do caminho crítico
+    bufferManager.archiveBackups();
+    return true;
+}
+
+bool CloudSync::uploadBufferWindow(int count)
+{
     HTTPClient http;
     String url = configManager.getBufferDataUrl();
 
     http.begin(url);
     http.addHeader("Content-Type", "application/json");
 
-    String jsonString;
-    serializeJson(doc, jsonString);
+    // Content-Length vem de uma passada de contagem; o corpo sai direto no socket
+    BufferUploadStream body(bufferManager, count);
+    size_t bodySize = body.size();
+    if (body.hasFailed())
+    {
+        http.end();
+        bufferManager.rollbackUpload();
+        return false;
+    }
 
-    int httpCode = http.PATCH(jsonString);
+    int httpCode = http.sendRequest("PATCH", &body, bodySize);
 
-    // Early return se falhar
-    if (httpCode != HTTP_CODE_OK)
+    // Early return se falhar (inclusive corpo interrompido no meio)
+    if (httpCode != HTTP_CODE_OK || body.hasFailed())
     {
         Serial.printf("❌ Buffer upload failed: HTTP %d\n", httpCode);
         Serial.printf("   URL: %s\n", url.c_str());
         http.end();
+        bufferManager.rollbackUpload();
         return false;
     }
 
     // Sucesso
     bufferManager.markAsConfirmed();
-    Serial.printf("📤 Buffer data uploaded: %d bytes\n", jsonString.length());
+    Serial.printf("📤 Buffer window uploaded: %d items, %d bytes\n", count, bodySize);
     Serial.printf("   URL: /bases/%s/data\n", configManager.getConfig().base_id);
     http.end();
     return true;
@@ -232,20 +271,26 @@ bool CloudSync::uploadHeartbeat()
 
     String url = configManager.getHeartbeatUrl();
 
-    // Obter timestamp e formato legível
+    // Payload só com epoch; a forma legível vai para o log serial
     time_t now = time(nullptr);
-    struct tm timeinfo;
-    getLocalTime(&timeinfo);
-
-    char dateStr[64];
-    strftime(dateStr, sizeof(dateStr), "%Y-%m-%d %H:%M:%S UTC-3", &timeinfo);
+    char dateStr[TimeFormat::HUMAN_SIZE];
+    TimeFormat::human(now, dateStr, sizeof(dateStr));
 
     DynamicJsonDocument doc(512);
     doc["timestamp"] = now;
-    doc["timestamp_human"] = dateStr;
+    if (configManager.getHumanTimestamps())
+    {
+        doc["timestamp_human"] = dateStr;
+    }
     doc["bikes_connected"] = BikeManager::getConnectedCount();
     doc["heap"] = ESP.getFreeHeap();
     doc["uptime"] = millis() / 1000;
+    BPRBLEServer::EventStats ble = BPRBLEServer::getEventStats();
+    doc["ble_queue_high_water"] = ble.highWater;
+    doc["ble_events_dropped"] = ble.dropped;
+    const BPRBLEServer::TransferStats& transfers = BPRBLEServer::getTransferStats();
+    doc["ble_transfers"] = transfers.completed;
+    doc["ble_throughput_bps"] = transfers.millis ? (uint32_t)((uint64_t)transfers.bytes * 1000 / transfers.millis) : 0;
 
     http.begin(url);
     http.addHeader("Content-Type", "application/json");
@@ -310,34 +355,41 @@ bool CloudSync::uploadWiFiConfig()
 bool CloudSync::uploadBikeData()
 {
     DynamicJsonDocument doc(4096);
+    String url = configManager.getBikeRegistryUrl();
+    int fields = 0;
 
-    // Early return se não há atualizações
-    if (!BikeManager::uploadToFirebase(doc))
+    // Cada PATCH leva o que couber no documento; repetir até zerar os campos sujos
+    for (int batch = 0; batch < MAX_BIKE_DELTA_BATCHES && BikeManager::uploadToFirebase(doc); batch++)
     {
-        Serial.println("📝 No bike data updates to send");
-        return true;
-    }
+        HTTPClient http;
+        http.begin(url);
+        http.addHeader("Content-Type", "application/json");
 
-    HTTPClient http;
-    String url = configManager.getBikeRegistryUrl();
+        String jsonString;
+        serializeJson(doc, jsonString);
 
-    http.begin(url);
-    http.addHeader("Content-Type", "application/json");
+        int httpCode = http.PATCH(jsonString);
+        http.end();
 
-    String jsonString;
-    serializeJson(doc, jsonString);
+        // Early return se falhar: os campos continuam sujos
+        if (httpCode != HTTP_CODE_OK)
+        {
+            BikeManager::rollbackUpload();
+            Serial.printf("❌ Failed to upload bike data: HTTP %d\n", httpCode);
+            return false;
+        }
 
-    int httpCode = http.PATCH(jsonString);
-    http.end();
+        BikeManager::confirmUpload();
+        fields += doc.size();
+    }
 
-    // Early return se falhar
-    if (httpCode != HTTP_CODE_OK)
+    if (fields == 0)
     {
-        Serial.printf("❌ Failed to upload bike data: HTTP %d\n", httpCode);
-        return false;
+        Serial.println("📝 No bike data updates to send");
+        return true;
     }
 
     // Sucesso
-    Serial.printf("📤 Bike data uploaded: %d bikes\n", doc.size());
+    Serial.printf("📤 Bike data uploaded: %d fields\n", fields);
     return true;
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "constants.h"
 #include "config_manager.h"
 #include "led_controller.h"
+#include "bike_manager.h"
+#include "time_format.h"
 #include <HTTPClient.h>
 
 extern ConfigManager configManager;
@@ -79,6 +81,7 @@ void ConfigAP::update()
                 // Config inicial falhou - restart necessário
                 Serial.printf("⏰ Timeout CONFIG_AP inicial (%d min) - Reiniciando...\n",
                              configManager.getConfig().timeouts.config_ap_min);
+                BikeManager::flush();
                 ESP.restart();
             } else {
                 // Fallback - voltar para operação normal
@@ -280,6 +283,7 @@ void ConfigAP::setupWebServer()
             html += "<p>Aguarde alguns segundos e verifique o monitor serial.</p></div></body></html>";
             server.send(200, "text/html", html);
             delay(2000);
+            BikeManager::flush();
             ESP.restart();
         } else {
             Serial.println("❌ Erro ao salvar configuração!");
@@ -299,13 +303,35 @@ void ConfigAP::setupWebServer()
         uint32_t timeoutMs = configManager.getConfig().timeouts.config_ap_min * 60000;
         uint32_t remaining = (elapsed < timeoutMs) ? (timeoutMs - elapsed) : 0;
         
-        DynamicJsonDocument doc(512);
+        DynamicJsonDocument doc(8192);
         doc["status"] = "config_mode";
         doc["uptime_ms"] = millis();
         doc["config_time_remaining_ms"] = remaining;
         doc["heap_free"] = ESP.getFreeHeap();
         doc["base_id"] = configManager.getConfig().base_id;
         
+        // Firmware guarda só epoch: a forma legível é montada aqui
+        char dateStr[TimeFormat::HUMAN_SIZE];
+        time_t now = time(nullptr);
+        TimeFormat::human(now, dateStr, sizeof(dateStr));
+        doc["time"] = now;
+        doc["time_human"] = dateStr;
+        
+        JsonArray bikes = doc.createNestedArray("bikes");
+        BikeManager::populateHeartbeatData(bikes);
+        for (JsonObject bike : bikes) {
+            uint32_t lastSeen = bike["last_seen"] | 0;
+            uint32_t firstSeen = bike["first_seen"] | 0;
+            if (lastSeen) {
+                TimeFormat::human(lastSeen, dateStr, sizeof(dateStr));
+                bike["last_seen_human"] = dateStr;
+            }
+            if (firstSeen) {
+                TimeFormat::human(firstSeen, dateStr, sizeof(dateStr));
+                bike["first_seen_human"] = dateStr;
+            }
+        }
+        
         String response;
         serializeJson(doc, response);
         server.send(200, "application/json", response); });
@@ -395,6 +421,7 @@ void ConfigAP::setupWebServer()
             html += "<p>Aguarde alguns segundos e verifique o monitor serial.</p></div></body></html>";
             server.send(200, "text/html", html);
             delay(2000);
+            BikeManager::flush();
             ESP.restart();
         } else {
             Serial.println("❌ Erro ao salvar configuração JSON!");
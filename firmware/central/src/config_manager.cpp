@@ -38,7 +38,7 @@ ConfigManager::ConfigManager() {
     config.led.bike_left_ms = 800;
     
     config.limits.max_bikes = MAX_BIKES;
-    config.limits.batch_size = MAX_BUFFER_SIZE;
+    config.limits.batch_size = UPLOAD_WINDOW_DEFAULT;
     
     config.fallback.max_failures = MAX_SYNC_FAILURES;
     config.fallback.timeout_min = SYNC_FAILURE_TIMEOUT_MS / 60000;
@@ -48,6 +48,8 @@ ConfigManager::ConfigManager() {
     config.buffer.sync_threshold_percent = 80;
     config.buffer.auto_save_interval = 5;
     config.buffer.max_item_size = 256;
+    config.buffer.journal_enabled = true;
+    config.buffer.arena_kb = BUFFER_ARENA_KB_DEFAULT;
     
     // Compression defaults
     config.compression.enabled = false;
@@ -61,6 +63,9 @@ ConfigManager::ConfigManager() {
     // Backup defaults
     config.backup.enabled = true;
     config.backup.retention_hours = 24;
+    
+    // Compat defaults: só epoch, a forma legível é montada nos consumidores
+    config.compat.human_timestamps = false;
 }
 
 bool ConfigManager::loadConfig() {
@@ -126,6 +131,8 @@ bool ConfigManager::loadConfig() {
     if (doc["buffer"]["sync_threshold_percent"]) config.buffer.sync_threshold_percent = doc["buffer"]["sync_threshold_percent"];
     if (doc["buffer"]["auto_save_interval"]) config.buffer.auto_save_interval = doc["buffer"]["auto_save_interval"];
     if (doc["buffer"]["max_item_size"]) config.buffer.max_item_size = doc["buffer"]["max_item_size"];
+    if (!doc["buffer"]["journal_enabled"].isNull()) config.buffer.journal_enabled = doc["buffer"]["journal_enabled"];
+    if (doc["buffer"]["arena_kb"]) config.buffer.arena_kb = doc["buffer"]["arena_kb"];
     
     // Compression config
     if (doc["compression"]["enabled"]) config.compression.enabled = doc["compression"]["enabled"];
@@ -140,6 +147,9 @@ bool ConfigManager::loadConfig() {
     if (doc["backup"]["enabled"]) config.backup.enabled = doc["backup"]["enabled"];
     if (doc["backup"]["retention_hours"]) config.backup.retention_hours = doc["backup"]["retention_hours"];
     
+    // Compat config
+    if (!doc["compat"]["human_timestamps"].isNull()) config.compat.human_timestamps = doc["compat"]["human_timestamps"];
+    
     Serial.printf("✅ Config carregada do arquivo:\n");
     Serial.printf("   Base ID: %s\n", config.base_id);
     Serial.printf("   WiFi: %s\n", config.wifi.ssid);
@@ -191,6 +201,8 @@ bool ConfigManager::saveConfig() {
     doc["buffer"]["sync_threshold_percent"] = config.buffer.sync_threshold_percent;
     doc["buffer"]["auto_save_interval"] = config.buffer.auto_save_interval;
     doc["buffer"]["max_item_size"] = config.buffer.max_item_size;
+    doc["buffer"]["journal_enabled"] = config.buffer.journal_enabled;
+    doc["buffer"]["arena_kb"] = config.buffer.arena_kb;
     
     doc["compression"]["enabled"] = config.compression.enabled;
     doc["compression"]["min_size_bytes"] = config.compression.min_size_bytes;
@@ -202,6 +214,8 @@ bool ConfigManager::saveConfig() {
     doc["backup"]["enabled"] = config.backup.enabled;
     doc["backup"]["retention_hours"] = config.backup.retention_hours;
     
+    doc["compat"]["human_timestamps"] = config.compat.human_timestamps;
+    
     File file = LittleFS.open(CONFIG_FILE, "w");
     if (!file) {
         Serial.println("❌ Failed to create config file");
@@ -270,6 +284,8 @@ void ConfigManager::updateFromFirebase(const DynamicJsonDocument& firebaseConfig
     if (firebaseConfig["buffer"]["sync_threshold_percent"]) config.buffer.sync_threshold_percent = firebaseConfig["buffer"]["sync_threshold_percent"];
     if (firebaseConfig["buffer"]["auto_save_interval"]) config.buffer.auto_save_interval = firebaseConfig["buffer"]["auto_save_interval"];
     if (firebaseConfig["buffer"]["max_item_size"]) config.buffer.max_item_size = firebaseConfig["buffer"]["max_item_size"];
+    if (!firebaseConfig["buffer"]["journal_enabled"].isNull()) config.buffer.journal_enabled = firebaseConfig["buffer"]["journal_enabled"];
+    if (firebaseConfig["buffer"]["arena_kb"]) config.buffer.arena_kb = firebaseConfig["buffer"]["arena_kb"];
     
     // Compression config
     if (firebaseConfig["compression"]["enabled"]) config.compression.enabled = firebaseConfig["compression"]["enabled"];
@@ -284,6 +300,9 @@ void ConfigManager::updateFromFirebase(const DynamicJsonDocument& firebaseConfig
     if (firebaseConfig["backup"]["enabled"]) config.backup.enabled = firebaseConfig["backup"]["enabled"];
     if (firebaseConfig["backup"]["retention_hours"]) config.backup.retention_hours = firebaseConfig["backup"]["retention_hours"];
     
+    // Compat config
+    if (!firebaseConfig["compat"]["human_timestamps"].isNull()) config.compat.human_timestamps = firebaseConfig["compat"]["human_timestamps"];
+    
     saveConfig();
     Serial.println("🔄 Config atualizada e salva localmente");
     Serial.printf("   Sync interval: %d segundos\n", config.intervals.sync_sec);
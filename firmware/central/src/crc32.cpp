@@ -0,0 +1,74 @@
+#include "crc32.h"
+
+#ifdef ESP_PLATFORM
+#include <esp_rom_crc.h>
+#endif
+
+namespace Crc32 {
+
+#ifdef ESP_PLATFORM
+
+    const char* const ENGINE = "rom";
+
+    uint32_t update(uint32_t crc, const void* data, size_t length) {
+        // A rotina da ROM já inverte entrada e saída (semântica do zlib)
+        return esp_rom_crc32_le(crc, (const uint8_t*)data, length);
+    }
+
+#else
+
+    const char* const ENGINE = "slice8";
+
+    static const uint32_t POLYNOMIAL = 0xEDB88320;
+
+    // 8 tabelas de 256 entradas (8 KB): só no host, o ESP32 usa a ROM
+    static uint32_t tables[8][256];
+    static bool tablesReady = false;
+
+    static void buildTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1)));
+            }
+            tables[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int t = 1; t < 8; t++) {
+                tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+            }
+        }
+        tablesReady = true;
+    }
+
+    static uint32_t getU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+               ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    uint32_t update(uint32_t crc, const void* data, size_t length) {
+        if (!tablesReady) buildTables();
+
+        const uint8_t* p = (const uint8_t*)data;
+        crc = ~crc;
+
+        // 8 bytes por iteração, um lookup independente por byte
+        while (length >= 8) {
+            uint32_t low = getU32(p) ^ crc;
+            uint32_t high = getU32(p + 4);
+            crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^
+                  tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24] ^
+                  tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^
+                  tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+            p += 8;
+            length -= 8;
+        }
+
+        while (length--) {
+            crc = (crc >> 8) ^ tables[0][(crc ^ *p++) & 0xFF];
+        }
+        return ~crc;
+    }
+
+#endif
+}
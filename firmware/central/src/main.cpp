@@ -7,6 +7,8 @@
 #include "cloud_sync.h"
 #include "led_controller.h"
 #include "buffer_manager.h"
+#include "bike_manager.h"
+#include "ble_server.h"
 #include "self_check.h"
 #include "sync_monitor.h"
 
@@ -58,6 +60,7 @@ void setup()
     // Inicializar módulos
     bool configLoaded = configManager.loadConfig();
     bufferManager.begin();
+    BikeManager::init();
     ledController.begin();
     ledController.bootPattern();
 
@@ -85,6 +88,7 @@ void loop()
 
     // Atualizar módulos
     ledController.update();
+    BikeManager::update();
 
     // Verificar se precisa sync urgente (buffer crítico)
     if (currentState == STATE_BIKE_PAIRING && bufferManager.isCriticallyFull())
@@ -147,6 +151,9 @@ void changeState(SystemState newState)
 
     Serial.printf("🔄 %s -> %s\n", getStateName(currentState), getStateName(newState));
 
+    // Registro de bikes pendente vai para a flash antes de trocar de estado
+    BikeManager::flush();
+
     // Exit current state
     switch (currentState)
     {
@@ -221,6 +228,20 @@ void printStatus()
         Serial.printf("🚲 Bikes conectadas: %d | 💾 Heap: %d bytes\n",
                       bikes, ESP.getFreeHeap());
 
+        const BikeManager::WriteStats &writes = BikeManager::getWriteStats();
+        Serial.printf("📝 Bike data: %lu gravações, %lu KB, %lu evitadas\n",
+                      (unsigned long)writes.flushes, (unsigned long)(writes.bytesWritten / 1024),
+                      (unsigned long)writes.flushesAvoided);
+
+        BPRBLEServer::EventStats ble = BPRBLEServer::getEventStats();
+        Serial.printf("📨 Fila BLE: pico %d/%d, %lu descartados\n",
+                      ble.highWater, ble.capacity, (unsigned long)ble.dropped);
+        const BPRBLEServer::TransferStats& transfers = BPRBLEServer::getTransferStats();
+        Serial.printf("📶 Transferências: %lu (%lu retomadas, %lu CRC), %lu B/s\n",
+                      (unsigned long)transfers.completed, (unsigned long)transfers.resumed,
+                      (unsigned long)transfers.crcFailures,
+                      (unsigned long)(transfers.millis ? (uint64_t)transfers.bytes * 1000 / transfers.millis : 0));
+
         // Mostrar informações de sincronização
         if (currentState == STATE_BIKE_PAIRING)
         {
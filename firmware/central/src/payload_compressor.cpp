@@ -0,0 +1,131 @@
+#include "payload_compressor.h"
+#include <string.h>
+
+namespace PayloadCompressor {
+
+    // Dicionário estático: trechos mais frequentes ficam no fim (distâncias menores).
+    // Manter idêntico a DICTIONARY em shared/utils/payloadCompressor.js
+    static const char DICTIONARY[] =
+        "\"heartbeat\",\"uptime_sec\":\"heap_free\":\"total_bikes\":\"bikes_connected_now\":"
+        "\"bikes_allowed\":\"bikes_pending\":\"bikes_with_recent_contact\":"
+        "{\"id\":\"bpr-\",\"status\":\"allowed\",\"last_seen\":\"battery_last\":\"heap_last\":"
+        "\"seconds_since_contact\":\"is_recent\":false,\"visit_count\":\"first_seen\":"
+        "\"pending\"\"blocked\"\"unknown\"true}]}"
+        "{\"scans\":[{\"ts\":\"bssid\":\"\",\"rssi\":-"
+        "\"type\":\"status\",\"bike_id\":\"bpr-\",\"battery\":\"records\":\"heap\":"
+        "\"timestamp\":17\",\"central_receive_timestamp\":17"
+        ",\"central_receive_timestamp_human\":\"202 UTC-3\"}";
+
+    static const size_t DICT_SIZE = sizeof(DICTIONARY) - 1;
+    static const size_t MAX_INPUT = 1024;
+    static const size_t MIN_MATCH = 3;
+    static const size_t MAX_MATCH = 34;
+    static const size_t MAX_DISTANCE = 1024;
+    static const size_t MAX_LITERALS = 128;
+
+    // Janela de trabalho: dicionário + entrada, para comparar com memcmp contíguo
+    static uint8_t window[DICT_SIZE + MAX_INPUT];
+
+    static bool flushLiterals(const uint8_t* literals, size_t count, uint8_t* output, size_t& pos, size_t capacity) {
+        while (count > 0) {
+            size_t chunk = count > MAX_LITERALS ? MAX_LITERALS : count;
+            if (pos + 1 + chunk > capacity) return false;
+
+            output[pos++] = (uint8_t)(chunk - 1);
+            memcpy(output + pos, literals, chunk);
+            pos += chunk;
+            literals += chunk;
+            count -= chunk;
+        }
+        return true;
+    }
+
+    size_t compress(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+        if (length == 0 || length > MAX_INPUT || capacity < 2) return 0;
+
+        memcpy(window, DICTIONARY, DICT_SIZE);
+        memcpy(window + DICT_SIZE, input, length);
+        const size_t end = DICT_SIZE + length;
+
+        size_t pos = 0;
+        output[pos++] = FORMAT_VERSION;
+
+        size_t literalStart = DICT_SIZE;
+        size_t i = DICT_SIZE;
+
+        while (i < end) {
+            size_t bestLen = 0;
+            size_t bestDist = 0;
+            size_t maxLen = end - i < MAX_MATCH ? end - i : MAX_MATCH;
+            size_t first = i > MAX_DISTANCE ? i - MAX_DISTANCE : 0;
+
+            // Busca exaustiva da mais próxima para a mais distante (entrada <= 1 KB)
+            if (maxLen >= MIN_MATCH) {
+                for (size_t j = i; j-- > first;) {
+                    if (window[j] != window[i] || window[j + bestLen] != window[i + bestLen]) continue;
+
+                    size_t len = 1;
+                    while (len < maxLen && window[j + len] == window[i + len]) len++;
+
+                    if (len > bestLen) {
+                        bestLen = len;
+                        bestDist = i - j;
+                        if (len == maxLen) break;
+                    }
+                }
+            }
+
+            if (bestLen < MIN_MATCH) {
+                i++;
+                continue;
+            }
+
+            if (!flushLiterals(window + literalStart, i - literalStart, output, pos, capacity)) return 0;
+            if (pos + 2 > capacity) return 0;
+
+            size_t code = bestDist - 1;
+            output[pos++] = 0x80 | (uint8_t)((bestLen - MIN_MATCH) << 2) | (uint8_t)(code >> 8);
+            output[pos++] = (uint8_t)(code & 0xFF);
+
+            i += bestLen;
+            literalStart = i;
+        }
+
+        if (!flushLiterals(window + literalStart, end - literalStart, output, pos, capacity)) return 0;
+
+        return pos < length ? pos : 0;
+    }
+
+    size_t decompress(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+        if (length < 1 || input[0] != FORMAT_VERSION) return 0;
+
+        size_t in = 1;
+        size_t out = 0;
+
+        while (in < length) {
+            uint8_t token = input[in++];
+
+            if ((token & 0x80) == 0) {
+                size_t count = (size_t)token + 1;
+                if (in + count > length || out + count > capacity) return 0;
+                memcpy(output + out, input + in, count);
+                in += count;
+                out += count;
+                continue;
+            }
+
+            if (in >= length) return 0;
+            size_t len = ((token >> 2) & 0x1F) + MIN_MATCH;
+            size_t dist = ((((size_t)token & 0x03) << 8) | input[in++]) + 1;
+            if (dist > DICT_SIZE + out || out + len > capacity) return 0;
+
+            // Cópia byte a byte: a origem pode sobrepor o destino ou estar no dicionário
+            for (size_t k = 0; k < len; k++, out++) {
+                size_t src = DICT_SIZE + out - dist;
+                output[out] = src < DICT_SIZE ? (uint8_t)DICTIONARY[src] : output[src - DICT_SIZE];
+            }
+        }
+
+        return out;
+    }
+}
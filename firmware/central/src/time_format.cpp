@@ -0,0 +1,12 @@
+#include "time_format.h"
+#include <time.h>
+
+namespace TimeFormat {
+
+    size_t human(uint32_t epoch, char* out, size_t size) {
+        time_t t = epoch;
+        struct tm timeinfo;
+        localtime_r(&t, &timeinfo);
+        return strftime(out, size, "%Y-%m-%d %H:%M:%S UTC-3", &timeinfo);
+    }
+}
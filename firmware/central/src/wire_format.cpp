@@ -0,0 +1,375 @@
+#include "wire_format.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace WireFormat {
+
+    static const Field STATUS_FIELDS[] = {
+        { TAG_BIKE_ID, KIND_STRING, "bike_id" },
+        { TAG_BATTERY_MV, KIND_MILLIVOLTS, "battery" },
+        { TAG_BATTERY_PCT, KIND_U8, "battery_pct" },
+        { TAG_RECORDS, KIND_U16, "records" },
+        { TAG_HEAP, KIND_U32, "heap" },
+        { TAG_TIMESTAMP, KIND_U32, "timestamp" },
+    };
+
+    static const Field WIFI_SCAN_FIELDS[] = {
+        { TAG_BIKE_ID, KIND_STRING, "bike_id" },
+        { TAG_SCAN, KIND_SCAN, "scans" },
+    };
+
+    static const Field CONFIG_REQUEST_FIELDS[] = {
+        { TAG_BIKE_ID, KIND_STRING, "bike_id" },
+    };
+
+    static const Field CONFIG_RECEIVED_FIELDS[] = {
+        { TAG_BIKE_ID, KIND_STRING, "bike_id" },
+        { TAG_STATUS, KIND_U8, "status" },
+        { TAG_VERSION, KIND_U16, "version" },
+    };
+
+    static const Field DATA_REQUEST_FIELDS[] = {
+        { TAG_BIKE_ID, KIND_STRING, "bike_id" },
+    };
+
+    // Chaves relativas ao objeto "config" do Firebase
+    static const Field CONFIG_PUSH_FIELDS[] = {
+        { TAG_BIKE_ID, KIND_STRING, "bike_id" },
+        { TAG_ERROR, KIND_STRING, "error" },
+        { TAG_VERSION, KIND_U16, "version" },
+        { TAG_BIKE_NAME, KIND_STRING, "bike_name" },
+        { TAG_DEV_MODE, KIND_BOOL, "dev_mode" },
+        { TAG_SCAN_INTERVAL_SEC, KIND_U32, "wifi.scan_interval_sec" },
+        { TAG_SCAN_TIMEOUT_MS, KIND_U32, "wifi.scan_timeout_ms" },
+        { TAG_BASE_NAME, KIND_STRING, "ble.base_name" },
+        { TAG_BLE_SCAN_SEC, KIND_U32, "ble.scan_time_sec" },
+        { TAG_DEEP_SLEEP_SEC, KIND_U32, "power.deep_sleep_duration_sec" },
+        { TAG_CRITICAL_MV, KIND_MILLIVOLTS, "battery.critical_voltage" },
+        { TAG_LOW_MV, KIND_MILLIVOLTS, "battery.low_voltage" },
+    };
+
+#define FIELDS(table) (count = sizeof(table) / sizeof(table[0]), table)
+
+    const Field* fieldsOf(uint8_t type, size_t& count) {
+        switch (type) {
+        case MSG_STATUS: return FIELDS(STATUS_FIELDS);
+        case MSG_WIFI_SCANS: return FIELDS(WIFI_SCAN_FIELDS);
+        case MSG_CONFIG_REQUEST: return FIELDS(CONFIG_REQUEST_FIELDS);
+        case MSG_CONFIG_RECEIVED: return FIELDS(CONFIG_RECEIVED_FIELDS);
+        case MSG_DATA_REQUEST: return FIELDS(DATA_REQUEST_FIELDS);
+        case MSG_CONFIG_PUSH: return FIELDS(CONFIG_PUSH_FIELDS);
+        default:
+            count = 0;
+            return nullptr;
+        }
+    }
+
+#undef FIELDS
+
+    const Field* fieldOf(uint8_t type, uint8_t tag) {
+        size_t count;
+        const Field* fields = fieldsOf(type, count);
+        for (size_t i = 0; i < count; i++) {
+            if (fields[i].tag == tag) return &fields[i];
+        }
+        return nullptr;
+    }
+
+    const char* typeName(uint8_t type) {
+        switch (type) {
+        case MSG_STATUS: return "status";
+        case MSG_WIFI_SCANS: return "wifi_scans";
+        case MSG_CONFIG_REQUEST: return "config_request";
+        case MSG_CONFIG_RECEIVED: return "config_received";
+        case MSG_DATA_REQUEST: return "data_request";
+        case MSG_CONFIG_PUSH: return "config_push";
+        default: return "unknown";
+        }
+    }
+
+    static void putLE(uint8_t* p, uint32_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) p[i] = (value >> (8 * i)) & 0xFF;
+    }
+
+    static uint32_t getLE(const uint8_t* p, size_t bytes) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < bytes; i++) value |= (uint32_t)p[i] << (8 * i);
+        return value;
+    }
+
+    // Writer
+
+    Writer::Writer(uint8_t* out, size_t capacity, uint8_t type)
+        : out(out), capacity(capacity), used(HEADER_SIZE), overflow(capacity < HEADER_SIZE) {
+        if (overflow) return;
+        out[0] = MAGIC;
+        out[1] = VERSION;
+        out[2] = type;
+    }
+
+    uint8_t* Writer::reserve(uint8_t tag, size_t length) {
+        if (overflow || length > MAX_FIELD || used + FIELD_HEADER_SIZE + length > capacity) {
+            overflow = true;
+            return nullptr;
+        }
+        out[used] = tag;
+        out[used + 1] = (uint8_t)length;
+        uint8_t* value = out + used + FIELD_HEADER_SIZE;
+        used += FIELD_HEADER_SIZE + length;
+        return value;
+    }
+
+    void Writer::putU8(uint8_t tag, uint8_t value) {
+        uint8_t* p = reserve(tag, 1);
+        if (p) p[0] = value;
+    }
+
+    void Writer::putU16(uint8_t tag, uint16_t value) {
+        uint8_t* p = reserve(tag, 2);
+        if (p) putLE(p, value, 2);
+    }
+
+    void Writer::putU32(uint8_t tag, uint32_t value) {
+        uint8_t* p = reserve(tag, 4);
+        if (p) putLE(p, value, 4);
+    }
+
+    void Writer::putString(uint8_t tag, const char* value, size_t length) {
+        putRaw(tag, (const uint8_t*)value, length);
+    }
+
+    void Writer::putString(uint8_t tag, const char* value) {
+        putRaw(tag, (const uint8_t*)value, strlen(value));
+    }
+
+    void Writer::putScan(const Scan& scan) {
+        uint8_t* p = reserve(TAG_SCAN, SCAN_SIZE);
+        if (!p) return;
+        putLE(p, scan.timestamp, 4);
+        memcpy(p + 4, scan.bssid, 6);
+        p[10] = (uint8_t)scan.rssi;
+    }
+
+    void Writer::putRaw(uint8_t tag, const uint8_t* value, size_t length) {
+        uint8_t* p = reserve(tag, length);
+        if (p && length > 0) memcpy(p, value, length);
+    }
+
+    // Reader
+
+    Reader::Reader(const uint8_t* in, size_t length)
+        : in(in), length(length), cursor(HEADER_SIZE), truncated(false), messageType(0), messageVersion(0),
+          fieldTag(0), fieldSize(0), fieldValue(nullptr) {
+        // Versão 0 não existe; versões futuras só acrescentam tags (puladas)
+        ok = isMessage(in, length) && in[1] >= 1;
+        if (ok) {
+            messageVersion = in[1];
+            messageType = in[2];
+        }
+    }
+
+    bool Reader::next() {
+        if (!ok || cursor >= length) return false;
+        if (cursor + FIELD_HEADER_SIZE > length || cursor + FIELD_HEADER_SIZE + in[cursor + 1] > length) {
+            truncated = true;
+            return false;
+        }
+        fieldTag = in[cursor];
+        fieldSize = in[cursor + 1];
+        fieldValue = in + cursor + FIELD_HEADER_SIZE;
+        cursor += FIELD_HEADER_SIZE + fieldSize;
+        return true;
+    }
+
+    void Reader::rewind() {
+        cursor = HEADER_SIZE;
+        truncated = false;
+    }
+
+    uint32_t Reader::asUint() const {
+        return getLE(fieldValue, fieldSize > 4 ? 4 : fieldSize);
+    }
+
+    bool Reader::asScan(Scan& scan) const {
+        if (fieldSize < SCAN_SIZE) return false;
+        scan.timestamp = getLE(fieldValue, 4);
+        memcpy(scan.bssid, fieldValue + 4, 6);
+        scan.rssi = (int8_t)fieldValue[10];
+        return true;
+    }
+
+    bool findString(const uint8_t* in, size_t length, uint8_t tag, const char*& value, size_t& valueLength) {
+        Reader reader(in, length);
+        while (reader.next()) {
+            if (reader.tag() != tag) continue;
+            value = (const char*)reader.value();
+            valueLength = reader.size();
+            return true;
+        }
+        return false;
+    }
+
+    bool findUint(const uint8_t* in, size_t length, uint8_t tag, uint32_t& value) {
+        Reader reader(in, length);
+        while (reader.next()) {
+            if (reader.tag() != tag) continue;
+            value = reader.asUint();
+            return true;
+        }
+        return false;
+    }
+
+    // Split
+
+    static bool isRepeated(uint8_t type, uint8_t tag) {
+        const Field* field = fieldOf(type, tag);
+        return field && field->kind == KIND_SCAN;
+    }
+
+    bool split(const uint8_t* in, size_t length, uint8_t* piece, size_t maxSize, PieceSink sink, void* context) {
+        Reader reader(in, length);
+        if (!reader.valid()) return false;
+
+        // Cabeçalho + campos únicos vão em todo pedaço
+        Writer prefix(piece, maxSize, reader.type());
+        while (reader.next()) {
+            if (!isRepeated(reader.type(), reader.tag())) prefix.putRaw(reader.tag(), reader.value(), reader.size());
+        }
+        if (reader.error()) return false;
+        size_t prefixLength = prefix.length();
+        if (prefixLength == 0) return false;
+
+        size_t used = prefixLength;
+        reader.rewind();
+        while (reader.next()) {
+            if (!isRepeated(reader.type(), reader.tag())) continue;
+
+            size_t fieldLength = FIELD_HEADER_SIZE + reader.size();
+            if (prefixLength + fieldLength > maxSize) return false;
+            if (used + fieldLength > maxSize) {
+                if (!sink(piece, used, context)) return false;
+                used = prefixLength;
+            }
+            piece[used] = reader.tag();
+            piece[used + 1] = reader.size();
+            memcpy(piece + used + FIELD_HEADER_SIZE, reader.value(), reader.size());
+            used += fieldLength;
+        }
+
+        // Último pedaço (ou o único, se não há campos repetidos)
+        return sink(piece, used, context);
+    }
+
+    // JSON
+
+    struct JsonOut {
+        char* out;
+        size_t capacity;
+        size_t used;
+        bool overflow;
+
+        void append(const char* text, size_t length) {
+            if (overflow || used + length >= capacity) {
+                overflow = true;
+                return;
+            }
+            memcpy(out + used, text, length);
+            used += length;
+        }
+
+        void append(const char* text) { append(text, strlen(text)); }
+
+        void printf(const char* format, uint32_t a) {
+            char tmp[16];
+            int length = snprintf(tmp, sizeof(tmp), format, (unsigned long)a);
+            append(tmp, length > 0 ? (size_t)length : 0);
+        }
+
+        void string(const char* value, size_t length) {
+            append("\"", 1);
+            for (size_t i = 0; i < length; i++) {
+                char c = value[i];
+                if (c == '"' || c == '\\') append("\\", 1);
+                if ((uint8_t)c >= 0x20) append(&c, 1);
+            }
+            append("\"", 1);
+        }
+    };
+
+    size_t toJson(const uint8_t* in, size_t length, uint32_t receivedAt, char* out, size_t capacity) {
+        Reader reader(in, length);
+        if (!reader.valid() || capacity == 0) return 0;
+
+        JsonOut json = { out, capacity, 0, false };
+        json.append("{\"type\":");
+        const char* name = typeName(reader.type());
+        json.string(name, strlen(name));
+
+        // Repetidos (scans) saem agrupados num array depois dos campos únicos
+        bool hasScans = false;
+        while (reader.next()) {
+            const Field* field = fieldOf(reader.type(), reader.tag());
+            if (!field) continue;
+            if (field->kind == KIND_SCAN) {
+                hasScans = true;
+                continue;
+            }
+
+            json.append(",");
+            json.string(field->key, strlen(field->key));
+            json.append(":");
+            switch (field->kind) {
+            case KIND_STRING:
+                json.string((const char*)reader.value(), reader.size());
+                break;
+            case KIND_BOOL:
+                json.append(reader.asUint() ? "true" : "false");
+                break;
+            case KIND_MILLIVOLTS: {
+                uint32_t mv = reader.asUint();
+                json.printf("%lu", mv / 1000);
+                json.printf(".%03lu", mv % 1000);
+                break;
+            }
+            default:
+                json.printf("%lu", reader.asUint());
+                break;
+            }
+        }
+        if (reader.error()) return 0;
+
+        if (hasScans) {
+            json.append(",\"scans\":[");
+            bool first = true;
+            reader.rewind();
+            Scan scan;
+            while (reader.next()) {
+                if (reader.tag() != TAG_SCAN || !reader.asScan(scan)) continue;
+                char bssid[18];
+                snprintf(bssid, sizeof(bssid), "%02X:%02X:%02X:%02X:%02X:%02X",
+                         scan.bssid[0], scan.bssid[1], scan.bssid[2], scan.bssid[3], scan.bssid[4], scan.bssid[5]);
+                json.append(first ? "{\"ts\":" : ",{\"ts\":");
+                json.printf("%lu", scan.timestamp);
+                json.append(",\"bssid\":\"");
+                json.append(bssid, 17);
+                json.append("\",\"rssi\":");
+                char rssi[8];
+                int rssiLength = snprintf(rssi, sizeof(rssi), "%d", scan.rssi);
+                json.append(rssi, rssiLength > 0 ? (size_t)rssiLength : 0);
+                json.append("}");
+                first = false;
+            }
+            json.append("]");
+        }
+
+        if (receivedAt) {
+            json.append(",\"central_receive_timestamp\":");
+            json.printf("%lu", receivedAt);
+        }
+        json.append("}");
+
+        if (json.overflow) return 0;
+        out[json.used] = '\0';
+        return json.used;
+    }
+}
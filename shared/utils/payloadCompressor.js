@@ -0,0 +1,52 @@
+// Descompressor dos payloads gravados pela central (itens do buffer com "compressed": true).
+// Espelho de firmware/central/src/payload_compressor.cpp - o DICTIONARY precisa ser
+// idêntico byte a byte ao do firmware.
+
+const FORMAT_VERSION = 1;
+
+const DICTIONARY = Buffer.from(
+  '"heartbeat","uptime_sec":"heap_free":"total_bikes":"bikes_connected_now":' +
+  '"bikes_allowed":"bikes_pending":"bikes_with_recent_contact":' +
+  '{"id":"bpr-","status":"allowed","last_seen":"battery_last":"heap_last":' +
+  '"seconds_since_contact":"is_recent":false,"visit_count":"first_seen":' +
+  '"pending""blocked""unknown"true}]}' +
+  '{"scans":[{"ts":"bssid":"","rssi":-' +
+  '"type":"status","bike_id":"bpr-","battery":"records":"heap":' +
+  '"timestamp":17","central_receive_timestamp":17' +
+  ',"central_receive_timestamp_human":"202 UTC-3"}',
+  'latin1'
+);
+
+function decompress(input) {
+  if (input.length < 1 || input[0] !== FORMAT_VERSION) {
+    throw new Error(`Unsupported payload format: ${input[0]}`);
+  }
+
+  const output = [];
+  let i = 1;
+
+  while (i < input.length) {
+    const token = input[i++];
+
+    if ((token & 0x80) === 0) {
+      const count = token + 1;
+      if (i + count > input.length) throw new Error('Truncated literal run');
+      for (let k = 0; k < count; k++) output.push(input[i++]);
+      continue;
+    }
+
+    if (i >= input.length) throw new Error('Truncated match');
+    const len = ((token >> 2) & 0x1f) + 3;
+    const dist = (((token & 0x03) << 8) | input[i++]) + 1;
+    if (dist > DICTIONARY.length + output.length) throw new Error('Match before window start');
+
+    for (let k = 0; k < len; k++) {
+      const src = DICTIONARY.length + output.length - dist;
+      output.push(src < DICTIONARY.length ? DICTIONARY[src] : output[src - DICTIONARY.length]);
+    }
+  }
+
+  return Buffer.from(output);
+}
+
+module.exports = { decompress, FORMAT_VERSION };
@@ -0,0 +1,37 @@
+// Forma legível dos timestamps da central.
+// O firmware guarda e envia só epoch (segundos); os campos *_human só saem
+// com compat.human_timestamps ligado. Consumidores formatam aqui.
+// Mesmo formato de firmware/central/src/time_format.cpp.
+
+const TIMEZONE_OFFSET_SEC = -3 * 3600; // UTC-3, igual a TIMEZONE_OFFSET do firmware
+const MIN_SYNCED_EPOCH = 1577836800;    // 2020-01-01: abaixo disso o relógio não tinha NTP
+
+function formatEpoch(epochSec) {
+  if (typeof epochSec !== 'number' || !Number.isFinite(epochSec) || epochSec < MIN_SYNCED_EPOCH) return null;
+
+  const d = new Date((epochSec + TIMEZONE_OFFSET_SEC) * 1000);
+  const pad = (n) => String(n).padStart(2, '0');
+  return `${d.getUTCFullYear()}-${pad(d.getUTCMonth() + 1)}-${pad(d.getUTCDate())} ` +
+    `${pad(d.getUTCHours())}:${pad(d.getUTCMinutes())}:${pad(d.getUTCSeconds())} UTC-3`;
+}
+
+// Prefere o epoch; registros antigos ainda podem trazer só `<campo>_human`
+function humanTime(obj, field) {
+  if (!obj) return null;
+  return formatEpoch(obj[field]) || obj[`${field}_human`] || null;
+}
+
+// Adiciona `<campo>_human` aos campos de tempo conhecidos (para exibição/debug)
+const TIME_FIELDS = ['timestamp', 'central_receive_timestamp', 'first_seen', 'last_visit', 'last_seen'];
+
+function withHumanTimes(obj) {
+  if (!obj || typeof obj !== 'object') return obj;
+  const out = { ...obj };
+  for (const field of TIME_FIELDS) {
+    const human = humanTime(obj, field);
+    if (human) out[`${field}_human`] = human;
+  }
+  return out;
+}
+
+module.exports = { formatEpoch, humanTime, withHumanTimes };
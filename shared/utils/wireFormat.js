@@ -0,0 +1,95 @@
+// Decodificador das mensagens binárias bike <-> central (itens do upload com "wire": true).
+// Espelho de firmware/central/src/wire_format.cpp - as tabelas de campos precisam ser
+// iguais às do firmware. A central só sobe o TLV cru quando não conseguiu gerar o JSON
+// (mensagem truncada/malformada), então aqui o decode é tolerante: devolve o que leu.
+
+const MAGIC = 0xb9;
+const HEADER_SIZE = 3;
+const SCAN_SIZE = 11;
+
+const TYPES = {
+  1: 'status',
+  2: 'wifi_scans',
+  3: 'config_request',
+  4: 'config_received',
+  5: 'data_request',
+  6: 'config_push',
+};
+
+// tag -> [tipo, chave JSON]
+const FIELDS = {
+  1: {
+    1: ['string', 'bike_id'], 3: ['millivolts', 'battery'], 4: ['uint', 'battery_pct'],
+    5: ['uint', 'records'], 6: ['uint', 'heap'], 2: ['uint', 'timestamp'],
+  },
+  2: { 1: ['string', 'bike_id'], 7: ['scan', 'scans'] },
+  3: { 1: ['string', 'bike_id'] },
+  4: { 1: ['string', 'bike_id'], 8: ['uint', 'status'], 9: ['uint', 'version'] },
+  5: { 1: ['string', 'bike_id'] },
+  6: {
+    1: ['string', 'bike_id'], 19: ['string', 'error'], 9: ['uint', 'version'],
+    10: ['string', 'bike_name'], 11: ['bool', 'dev_mode'],
+    12: ['uint', 'wifi.scan_interval_sec'], 13: ['uint', 'wifi.scan_timeout_ms'],
+    14: ['string', 'ble.base_name'], 15: ['uint', 'ble.scan_time_sec'],
+    16: ['uint', 'power.deep_sleep_duration_sec'],
+    17: ['millivolts', 'battery.critical_voltage'], 18: ['millivolts', 'battery.low_voltage'],
+  },
+};
+
+function readUint(value) {
+  let result = 0;
+  for (let i = value.length - 1; i >= 0; i--) result = result * 256 + value[i];
+  return result;
+}
+
+function readScan(value) {
+  const bssid = Array.from(value.subarray(4, 10), (b) => b.toString(16).toUpperCase().padStart(2, '0'));
+  return { ts: value.readUInt32LE(0), bssid: bssid.join(':'), rssi: value.readInt8(10) };
+}
+
+function isWireMessage(buffer) {
+  return buffer.length >= HEADER_SIZE && buffer[0] === MAGIC;
+}
+
+// Mesmo objeto que WireFormat::toJson gera na central; `receivedAt` = ts do item
+function wireToObject(buffer, receivedAt = 0) {
+  if (!isWireMessage(buffer)) throw new Error('Not a wire message');
+
+  const type = buffer[2];
+  const fields = FIELDS[type] || {};
+  const result = { type: TYPES[type] || 'unknown' };
+  const scans = [];
+
+  let cursor = HEADER_SIZE;
+  while (cursor < buffer.length) {
+    if (cursor + 2 > buffer.length || cursor + 2 + buffer[cursor + 1] > buffer.length) {
+      result.truncated = true;
+      break;
+    }
+    const tag = buffer[cursor];
+    const value = buffer.subarray(cursor + 2, cursor + 2 + buffer[cursor + 1]);
+    cursor += 2 + value.length;
+
+    const field = fields[tag];
+    if (!field) continue;
+    const [kind, key] = field;
+    if (kind === 'scan') {
+      if (value.length >= SCAN_SIZE) scans.push(readScan(value));
+      continue;
+    }
+
+    let decoded;
+    if (kind === 'string') decoded = value.toString('utf8');
+    else if (kind === 'bool') decoded = readUint(value) !== 0;
+    else if (kind === 'millivolts') decoded = readUint(value) / 1000;
+    else decoded = readUint(value);
+
+    result[key] = decoded;
+  }
+
+  if (scans.length > 0) result.scans = scans;
+  if (receivedAt) result.central_receive_timestamp = receivedAt;
+  return result;
+}
+
+module.exports = { wireToObject, isWireMessage, MAGIC };